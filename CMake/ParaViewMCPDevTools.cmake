@@ -3,6 +3,7 @@ include_guard(GLOBAL)
 option(PARAVIEW_MCP_ENABLE_WARNINGS "Enable compiler warnings for ParaView MCP targets" ON)
 option(PARAVIEW_MCP_ENABLE_CLANG_TIDY "Run clang-tidy during C++ compilation" OFF)
 option(PARAVIEW_MCP_ENABLE_IWYU "Run include-what-you-use during C++ compilation" OFF)
+option(PARAVIEW_MCP_ENABLE_BENCHMARKS "Build the protocol benchmark suite (needs BUILD_TESTING)" OFF)
 
 function(paraview_mcp_get_clang_tidy_extra_args output_var)
   set(_paraview_mcp_extra_args)
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QByteArray>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QString>
@@ -13,12 +14,42 @@ public:
   virtual void shutdown() = 0;
 
   [[nodiscard]] virtual bool isReady() const = 0;
+  // Sessions are per-client Python namespaces; every later call runs in the
+  // one selected last. resetSession() starts the selected session over and
+  // clears the shared history only if no other session is open.
+  virtual bool selectSession(quint64 sessionId, QString* error = nullptr) = 0;
+  virtual bool closeSession(quint64 sessionId, QString* error = nullptr) = 0;
   virtual bool resetSession(QString* error = nullptr) = 0;
   virtual bool
   executePython(const QString& code, QJsonObject* result, QString* error = nullptr) = 0;
-  virtual bool inspectPipeline(QJsonObject* result, QString* error = nullptr) = 0;
+  // Safe to call from any thread. Asks the script executePython() is running
+  // to stop; it then returns a result with "cancelled" set. Returns false when
+  // no script is running.
+  virtual bool interrupt() = 0;
+  // Returns the helper's JSON object text unparsed so it can be spliced into
+  // the response envelope as-is. The result carries a "version"; when
+  // ifVersion names the current one it is only {"not_modified": true, ...}.
+  virtual bool
+  inspectPipeline(const QString& ifVersion, QByteArray* resultJson, QString* error = nullptr) = 0;
   virtual bool
   captureScreenshot(int width, int height, QJsonObject* result, QString* error = nullptr) = 0;
+  virtual bool captureScreenshotBinary(int width,
+                                       int height,
+                                       QJsonObject* result,
+                                       QByteArray* imageData,
+                                       QString* error = nullptr) = 0;
   virtual bool getHistory(QJsonArray* result, QString* error = nullptr) = 0;
+  // What changed in the history since the last call, as {"keep": n,
+  // "append": [...]}; see ParaViewMCPHistoryDelta.
+  virtual bool historyDelta(QJsonObject* result, QString* error = nullptr) = 0;
   virtual bool restoreSnapshot(int entryId, QJsonObject* result, QString* error = nullptr) = 0;
+  // While deferred, Render() calls from scripts only note their view; turning
+  // deferral off renders each noted view once.
+  virtual bool setRendersDeferred(bool deferred, QString* error = nullptr) = 0;
+  // While enabled, calls into the helper are timed. takeTimings() returns the
+  // milliseconds per phase summed since the last take ("gil_ms", "call_ms",
+  // "convert_ms" and the helper's own, such as "snapshot_ms" and "exec_ms")
+  // and starts over.
+  virtual void setTimingsEnabled(bool enabled) = 0;
+  virtual QJsonObject takeTimings() = 0;
 };
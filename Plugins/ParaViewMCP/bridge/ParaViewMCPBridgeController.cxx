@@ -2,8 +2,7 @@
 
 #include "ParaViewMCPPopup.h"
 
-#include <QJsonArray>
-#include <QJsonDocument>
+#include <QJsonObject>
 
 ParaViewMCPBridgeController& ParaViewMCPBridgeController::instance()
 {
@@ -26,7 +25,11 @@ ParaViewMCPBridgeController::ParaViewMCPBridgeController(QObject* parent)
   QObject::connect(&this->SocketBridge,
                    &ParaViewMCPSocketBridge::historyChanged,
                    this,
-                   &ParaViewMCPBridgeController::setHistory);
+                   &ParaViewMCPBridgeController::applyHistoryDelta);
+  QObject::connect(&this->SocketBridge,
+                   &ParaViewMCPSocketBridge::latencyChanged,
+                   this,
+                   &ParaViewMCPBridgeController::latencyChanged);
 }
 
 void ParaViewMCPBridgeController::initialize()
@@ -135,11 +138,16 @@ QString ParaViewMCPBridgeController::lastLog() const
   return this->LastLog;
 }
 
-QString ParaViewMCPBridgeController::lastHistory() const
+QList<QJsonObject> ParaViewMCPBridgeController::lastHistory() const
 {
   return this->LastHistory;
 }
 
+ParaViewMCP::LatencyStats ParaViewMCPBridgeController::latencyStats() const
+{
+  return this->SocketBridge.latencyStats();
+}
+
 void ParaViewMCPBridgeController::restoreSnapshot(int entryId)
 {
   QJsonObject result;
@@ -151,10 +159,12 @@ void ParaViewMCPBridgeController::restoreSnapshot(int entryId)
     return;
   }
 
-  QJsonArray historyArray;
-  if (this->PythonBridge.getHistory(&historyArray, nullptr))
+  QJsonObject delta;
+  ParaViewMCPHistoryDelta historyDelta;
+  if (this->PythonBridge.historyDelta(&delta, nullptr) &&
+      ParaViewMCPHistoryDelta::fromJson(delta, &historyDelta))
   {
-    this->setHistory(QString::fromUtf8(QJsonDocument(historyArray).toJson(QJsonDocument::Compact)));
+    this->applyHistoryDelta(historyDelta);
   }
 }
 
@@ -205,8 +215,12 @@ void ParaViewMCPBridgeController::setLog(const QString& message)
   emit this->logChanged(message);
 }
 
-void ParaViewMCPBridgeController::setHistory(const QString& historyJson)
+void ParaViewMCPBridgeController::applyHistoryDelta(const ParaViewMCPHistoryDelta& delta)
 {
-  this->LastHistory = historyJson;
-  emit this->historyChanged(historyJson);
+  if (!delta.changes(this->LastHistory))
+  {
+    return;
+  }
+  delta.applyTo(this->LastHistory);
+  emit this->historyChanged(delta);
 }
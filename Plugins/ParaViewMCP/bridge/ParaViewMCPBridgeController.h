@@ -5,6 +5,8 @@
 #include "ParaViewMCPServerConfig.h"
 #include "ParaViewMCPPythonBridge.h"
 
+#include <QJsonObject>
+#include <QList>
 #include <QObject>
 #include <QPointer>
 #include <QString>
@@ -43,7 +45,8 @@ public:
   bool hasClient() const;
   QString lastStatus() const;
   QString lastLog() const;
-  QString lastHistory() const;
+  QList<QJsonObject> lastHistory() const;
+  ParaViewMCP::LatencyStats latencyStats() const;
   ServerState serverState() const;
   void restoreSnapshot(int entryId);
 
@@ -51,14 +54,15 @@ signals:
   void statusChanged(const QString& status);
   void logChanged(const QString& message);
   void serverStateChanged(ServerState state);
-  void historyChanged(const QString& historyJson);
+  void historyChanged(const ParaViewMCPHistoryDelta& delta);
+  void latencyChanged(const ParaViewMCP::LatencyStats& stats);
 
 private:
   explicit ParaViewMCPBridgeController(QObject* parent = nullptr);
 
   void setStatus(const QString& status);
   void setLog(const QString& message);
-  void setHistory(const QString& historyJson);
+  void applyHistoryDelta(const ParaViewMCPHistoryDelta& delta);
   void updateServerState();
 
   bool Initialized = false;
@@ -67,7 +71,7 @@ private:
   ServerState CurrentState = ServerState::Stopped;
   QString LastStatus;
   QString LastLog;
-  QString LastHistory;
+  QList<QJsonObject> LastHistory;
   ParaViewMCPPythonBridge PythonBridge;
   ParaViewMCPRequestHandler RequestHandler;
   ParaViewMCPSocketBridge SocketBridge;
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "ParaViewMCPProtocol.h"
+
+#include <QList>
+
+#include <algorithm>
+
+// Heartbeat bookkeeping for one connection: which heartbeats are awaiting an
+// answer, since when the client has been silent and the round trips of the
+// last SampleCount that were answered.
+//
+// A heartbeat is not given up on when the next one goes out, so a client
+// whose round trip is longer than the interval still counts as alive. An
+// answer also settles every heartbeat sent before it.
+class ParaViewMCPHeartbeat
+{
+public:
+  static constexpr int SampleCount = 128;
+
+  // Starts timing a new heartbeat and returns its id.
+  quint64 beat()
+  {
+    if (this->Outstanding.size() == SampleCount)
+    {
+      this->Outstanding.removeFirst();
+    }
+    this->Outstanding.append(Beat{++this->LastId, ParaViewMCP::monotonicNs()});
+    return this->LastId;
+  }
+
+  // Records the round trip if id answers a heartbeat still out; returns
+  // false for settled or unknown ids.
+  bool acknowledge(quint64 id)
+  {
+    qsizetype index = 0;
+    while (index < this->Outstanding.size() && this->Outstanding.at(index).Id != id)
+    {
+      ++index;
+    }
+    if (id == 0 || index == this->Outstanding.size())
+    {
+      return false;
+    }
+
+    const double roundTripMs =
+      ParaViewMCP::timingMs(ParaViewMCP::monotonicNs() - this->Outstanding.at(index).SentNs);
+    if (this->RoundTrips.size() == SampleCount)
+    {
+      this->RoundTrips.removeFirst();
+    }
+    this->RoundTrips.append(roundTripMs);
+    this->Outstanding.remove(0, index + 1);
+    return true;
+  }
+
+  // How long the oldest unanswered heartbeat has been out; 0 when none is.
+  [[nodiscard]] qint64 unansweredMs() const
+  {
+    if (this->Outstanding.isEmpty())
+    {
+      return 0;
+    }
+    return (ParaViewMCP::monotonicNs() - this->Outstanding.first().SentNs) / 1000000;
+  }
+
+  // Gives up on the heartbeats still out without counting them against the
+  // client, e.g. while its answers cannot be read.
+  void forgive()
+  {
+    this->Outstanding.clear();
+  }
+
+  // Oldest first.
+  [[nodiscard]] const QList<double>& roundTrips() const
+  {
+    return this->RoundTrips;
+  }
+
+  void clear()
+  {
+    *this = ParaViewMCPHeartbeat();
+  }
+
+  // Nearest-rank percentiles over samples; LastMs is the newest one.
+  static ParaViewMCP::LatencyStats summarize(const QList<double>& samples)
+  {
+    ParaViewMCP::LatencyStats stats;
+    stats.Samples = static_cast<int>(samples.size());
+    if (samples.isEmpty())
+    {
+      return stats;
+    }
+
+    QList<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    const auto percentile = [&sorted](int percent)
+    {
+      const qsizetype rank = (sorted.size() * percent + 99) / 100;
+      return sorted.at(qMax<qsizetype>(rank, 1) - 1);
+    };
+    stats.LastMs = samples.last();
+    stats.P50Ms = percentile(50);
+    stats.P90Ms = percentile(90);
+    stats.P99Ms = percentile(99);
+    return stats;
+  }
+
+private:
+  struct Beat
+  {
+    quint64 Id;
+    qint64 SentNs;
+  };
+
+  QList<Beat> Outstanding;
+  QList<double> RoundTrips;
+  quint64 LastId = 0;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QMetaType>
+#include <QString>
+
+#include <algorithm>
+
+// A change to the execution history as the Python helper reports it: keep the
+// first Keep entries, drop the rest and append Appended. Commands add one
+// entry at a time, so applying a delta costs the same however long the
+// history has grown. A restored snapshot or a reset shows up as a smaller Keep.
+struct ParaViewMCPHistoryDelta
+{
+  int Keep = 0;
+  QList<QJsonObject> Appended;
+
+  // The delta that empties the history.
+  static ParaViewMCPHistoryDelta cleared()
+  {
+    return ParaViewMCPHistoryDelta();
+  }
+
+  // The delta that replaces whatever the receiver holds with history.
+  static ParaViewMCPHistoryDelta replacing(const QList<QJsonObject>& history)
+  {
+    ParaViewMCPHistoryDelta delta;
+    delta.Appended = history;
+    return delta;
+  }
+
+  // Reads the helper's {"keep": n, "append": [...]} object.
+  static bool
+  fromJson(const QJsonObject& object, ParaViewMCPHistoryDelta* delta, QString* error = nullptr)
+  {
+    const QJsonValue keep = object.value(QStringLiteral("keep"));
+    const QJsonValue append = object.value(QStringLiteral("append"));
+    if (!keep.isDouble() || keep.toInt(-1) < 0 || !append.isArray())
+    {
+      if (error != nullptr)
+      {
+        *error = QStringLiteral("history_delta returned an invalid delta");
+      }
+      return false;
+    }
+
+    delta->Keep = keep.toInt();
+    delta->Appended.clear();
+    const QJsonArray entries = append.toArray();
+    delta->Appended.reserve(entries.size());
+    for (const QJsonValue& entry : entries)
+    {
+      delta->Appended.push_back(entry.toObject());
+    }
+    return true;
+  }
+
+  [[nodiscard]] bool changes(const QList<QJsonObject>& history) const
+  {
+    return this->Keep < history.size() || !this->Appended.isEmpty();
+  }
+
+  void applyTo(QList<QJsonObject>& history) const
+  {
+    const int keep = std::min(this->Keep, static_cast<int>(history.size()));
+    history.erase(history.begin() + keep, history.end());
+    history.append(this->Appended);
+  }
+};
+
+Q_DECLARE_METATYPE(ParaViewMCPHistoryDelta)
@@ -0,0 +1,806 @@
+#include "ParaViewMCPNetworkWorker.h"
+
+#include <QJsonArray>
+#include <QList>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutexLocker>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+namespace
+{
+  // Replies built on the network thread never wait for the GUI thread; their
+  // queue_ms is the time spent on earlier messages from the same read.
+  void addLocalTimings(ParaViewMCPRequestHandler::Result& result,
+                       const ParaViewMCP::WireOptions& wire,
+                       const ParaViewMCP::ReceiveTiming& received,
+                       qint64 startedNs)
+  {
+    if (!wire.Timings)
+    {
+      return;
+    }
+    result.Response.insert(
+      QStringLiteral("timings"),
+      QJsonObject{
+        {"decode_ms", ParaViewMCP::timingMs(received.DecodeNs)},
+        {"queue_ms", ParaViewMCP::timingMs(startedNs - received.DecodedAtNs)},
+        {"handler_ms", ParaViewMCP::timingMs(ParaViewMCP::monotonicNs() - startedNs)},
+      });
+  }
+} // namespace
+
+ParaViewMCPNetworkWorker::ParaViewMCPNetworkWorker(QObject* parent) : QObject(parent) {}
+
+void ParaViewMCPNetworkWorker::setInterruptHandler(InterruptHandler handler)
+{
+  this->Interrupt = std::move(handler);
+}
+
+void ParaViewMCPNetworkWorker::setStatusHandler(StatusHandler handler)
+{
+  this->Status = std::move(handler);
+}
+
+bool ParaViewMCPNetworkWorker::listen(const ParaViewMCPServerConfig& config,
+                                      const QHostAddress& address,
+                                      QString* error)
+{
+  QString listenError;
+  const bool listening = config.usesLocalSocket()
+                           ? this->listenLocal(config.SocketPath.trimmed(), &listenError)
+                           : this->listenTcp(address, config.Port, &listenError);
+  if (!listening)
+  {
+    if (error != nullptr)
+    {
+      *error = listenError;
+    }
+    return false;
+  }
+
+  this->Config = config;
+  if (this->HeartbeatTimer == nullptr)
+  {
+    this->HeartbeatTimer = new QTimer(this);
+    QObject::connect(this->HeartbeatTimer,
+                     &QTimer::timeout,
+                     this,
+                     &ParaViewMCPNetworkWorker::sendHeartbeats);
+  }
+  if (config.HeartbeatIntervalMs > 0)
+  {
+    this->HeartbeatTimer->start(config.HeartbeatIntervalMs);
+  }
+  return true;
+}
+
+bool ParaViewMCPNetworkWorker::listenTcp(const QHostAddress& address, quint16 port, QString* error)
+{
+  if (this->Server == nullptr)
+  {
+    this->Server = new QTcpServer(this);
+    QObject::connect(
+      this->Server, &QTcpServer::newConnection, this, &ParaViewMCPNetworkWorker::onNewConnection);
+  }
+
+  if (!this->Server->listen(address, port))
+  {
+    *error = this->Server->errorString();
+    return false;
+  }
+  return true;
+}
+
+bool ParaViewMCPNetworkWorker::listenLocal(const QString& path, QString* error)
+{
+  if (this->LocalServer == nullptr)
+  {
+    this->LocalServer = new QLocalServer(this);
+    QObject::connect(this->LocalServer,
+                     &QLocalServer::newConnection,
+                     this,
+                     &ParaViewMCPNetworkWorker::onNewLocalConnection);
+  }
+
+  // The socket file's permissions stand in for the network auth token: only
+  // the user running ParaView can connect.
+  this->LocalServer->setSocketOptions(QLocalServer::UserAccessOption);
+  if (this->LocalServer->listen(path))
+  {
+    return true;
+  }
+
+  // A ParaView that crashed leaves its socket file behind. Reclaim it only if
+  // nothing answers on it, so a second running instance is never hijacked.
+  if (this->LocalServer->serverError() == QAbstractSocket::AddressInUseError)
+  {
+    QLocalSocket probe;
+    probe.connectToServer(path);
+    if (!probe.waitForConnected(100))
+    {
+      QLocalServer::removeServer(path);
+      if (this->LocalServer->listen(path))
+      {
+        return true;
+      }
+    }
+    probe.abort();
+  }
+
+  *error = this->LocalServer->errorString();
+  return false;
+}
+
+quint64 ParaViewMCPNetworkWorker::close()
+{
+  if (this->Server != nullptr && this->Server->isListening())
+  {
+    this->Server->close();
+  }
+  if (this->LocalServer != nullptr && this->LocalServer->isListening())
+  {
+    this->LocalServer->close();
+  }
+  if (this->HeartbeatTimer != nullptr)
+  {
+    this->HeartbeatTimer->stop();
+  }
+  while (!this->Sessions.empty())
+  {
+    this->closeClientSocket(this->Sessions.begin()->first, true, false);
+  }
+  return this->LastConnectionId;
+}
+
+quint16 ParaViewMCPNetworkWorker::serverPort() const
+{
+  return this->Server != nullptr ? this->Server->serverPort() : 0;
+}
+
+QString ParaViewMCPNetworkWorker::socketPath() const
+{
+  return this->LocalServer != nullptr && this->LocalServer->isListening()
+           ? this->LocalServer->fullServerName()
+           : QString();
+}
+
+ParaViewMCP::OutboundStats ParaViewMCPNetworkWorker::outboundStats() const
+{
+  const QMutexLocker locker(&this->StatsMutex);
+  return this->Outbound;
+}
+
+ParaViewMCP::LatencyStats ParaViewMCPNetworkWorker::latencyStats() const
+{
+  const QMutexLocker locker(&this->StatsMutex);
+  return this->Latency;
+}
+
+void ParaViewMCPNetworkWorker::onNewConnection()
+{
+  if (this->Server == nullptr)
+  {
+    return;
+  }
+
+  while (this->Server->hasPendingConnections())
+  {
+    QTcpSocket* socket = this->Server->nextPendingConnection();
+    if (socket == nullptr)
+    {
+      continue;
+    }
+    ParaViewMCPNetworkWorker::tuneSocket(socket, this->Config);
+    if (!this->acceptClient(socket))
+    {
+      continue;
+    }
+
+    QObject::connect(socket,
+                     &QTcpSocket::disconnected,
+                     this,
+                     [this, socket]() { this->closeClientSocket(socket, true); });
+    QObject::connect(socket,
+                     &QTcpSocket::errorOccurred,
+                     this,
+                     [this, socket]() { emit this->logChanged(socket->errorString()); });
+    emit this->logChanged(
+      QStringLiteral("Client connected from %1").arg(socket->peerAddress().toString()));
+  }
+}
+
+void ParaViewMCPNetworkWorker::onNewLocalConnection()
+{
+  if (this->LocalServer == nullptr)
+  {
+    return;
+  }
+
+  while (this->LocalServer->hasPendingConnections())
+  {
+    QLocalSocket* socket = this->LocalServer->nextPendingConnection();
+    if (socket == nullptr || !this->acceptClient(socket))
+    {
+      continue;
+    }
+
+    QObject::connect(socket,
+                     &QLocalSocket::disconnected,
+                     this,
+                     [this, socket]() { this->closeClientSocket(socket, true); });
+    QObject::connect(socket,
+                     &QLocalSocket::errorOccurred,
+                     this,
+                     [this, socket]() { emit this->logChanged(socket->errorString()); });
+    emit this->logChanged(QStringLiteral("Client connected on %1").arg(this->socketPath()));
+  }
+}
+
+// Shared by both transports: turns the socket away when every session slot is
+// taken, otherwise gives it a session of its own. Returns false if rejected.
+bool ParaViewMCPNetworkWorker::acceptClient(QIODevice* socket)
+{
+  if (static_cast<qsizetype>(this->Sessions.size()) >= qMax(1, this->Config.MaxSessions))
+  {
+    const auto result = ParaViewMCPRequestHandler::busyResult();
+    ParaViewMCPOutboundQueue outbound;
+    ParaViewMCPNetworkWorker::sendMessage(outbound, result.Response);
+    outbound.drain(socket);
+    ParaViewMCPNetworkWorker::flushSocket(socket);
+    ParaViewMCPNetworkWorker::disconnectSocket(socket);
+    socket->deleteLater();
+    return false;
+  }
+
+  // Only a peer on this machine can map the shared region, so it is never
+  // offered to a remote TCP client.
+  const auto* tcpSocket = qobject_cast<QTcpSocket*>(socket);
+  const bool sameHost = tcpSocket == nullptr || tcpSocket->peerAddress().isLoopback();
+  auto session = std::make_unique<ParaViewMCPSession>();
+  session->attach(socket,
+                  ++this->LastConnectionId,
+                  this->Config.MaxFrameBytes,
+                  sameHost && this->Config.SharedMemoryBytes > 0);
+  session->outbound().setWatermarks(this->Config.OutboundHighWatermark,
+                                    this->Config.OutboundHighWatermark / 4);
+  const quint64 connectionId = session->id();
+  const ParaViewMCP::WireOptions wire = session->wireOptions();
+  this->Sessions[socket] = std::move(session);
+  QObject::connect(
+    socket, &QIODevice::readyRead, this, [this, socket]() { this->onSocketReadyRead(socket); });
+  QObject::connect(socket,
+                   &QIODevice::bytesWritten,
+                   this,
+                   [this, socket]()
+                   {
+                     const auto entry = this->Sessions.find(socket);
+                     if (entry != this->Sessions.end())
+                     {
+                       this->pumpOutbound(*entry->second);
+                     }
+                   });
+  emit this->clientAttached(connectionId, wire);
+  return true;
+}
+
+void ParaViewMCPNetworkWorker::onSocketReadyRead(QIODevice* socket)
+{
+  const auto found = this->Sessions.find(socket);
+  if (found == this->Sessions.end())
+  {
+    return;
+  }
+  ParaViewMCPSession& session = *found->second;
+  // Left in the socket until this client has taken its replies; with the
+  // socket's read buffer capped, TCP flow control then slows the client down.
+  if (session.outbound().isPaused())
+  {
+    return;
+  }
+
+  session.buffer().readFrom(socket);
+
+  QList<QJsonObject> messages;
+  QList<ParaViewMCP::ReceiveTiming> timings;
+  QString parseError;
+  if (!ParaViewMCP::tryExtractMessages(session.buffer(),
+                                       messages,
+                                       &parseError,
+                                       session.wireOptions(),
+                                       &session.compressionStats(),
+                                       &timings))
+  {
+    this->sendToClient(
+      session,
+      ParaViewMCPRequestHandler::protocolError(QStringLiteral("PROTOCOL_ERROR"), parseError));
+    return;
+  }
+  for (qsizetype index = 0; index < messages.size(); ++index)
+  {
+    const QJsonObject& message = messages.at(index);
+    const ParaViewMCP::ReceiveTiming& received = timings.at(index);
+    if (session.handshakeComplete() && session.wireOptions().Heartbeat &&
+        message.value(QStringLiteral("type")).toString() == QStringLiteral("heartbeat_ack"))
+    {
+      const auto heartbeatId =
+        static_cast<quint64>(message.value(QStringLiteral("heartbeat_id")).toDouble());
+      if (session.heartbeat().acknowledge(heartbeatId))
+      {
+        this->LastRoundTripMs = session.heartbeat().roundTrips().last();
+        this->updateLatencyStats();
+      }
+      continue;
+    }
+
+    // A ping needs nothing from ParaView, so once the handshake is done it is
+    // answered here even while the GUI thread is busy running Python.
+    if (session.handshakeComplete() &&
+        message.value(QStringLiteral("type")).toString() == QStringLiteral("ping"))
+    {
+      const qint64 startedNs = ParaViewMCP::monotonicNs();
+      ParaViewMCPRequestHandler::Result result = ParaViewMCPRequestHandler::pingResult(
+        message.value(QStringLiteral("request_id")).toString());
+      addLocalTimings(result, session.wireOptions(), received, startedNs);
+      this->sendToClient(session, result);
+      continue;
+    }
+
+    if (session.handshakeComplete() &&
+        message.value(QStringLiteral("type")).toString() == QStringLiteral("status"))
+    {
+      const qint64 startedNs = ParaViewMCP::monotonicNs();
+      ParaViewMCPRequestHandler::Result result = ParaViewMCPRequestHandler::statusResult(
+        message.value(QStringLiteral("request_id")).toString(), this->statusFor(session));
+      addLocalTimings(result, session.wireOptions(), received, startedNs);
+      this->sendToClient(session, result);
+      continue;
+    }
+
+    // The GUI thread may be stuck in the very request being cancelled, so the
+    // running one is interrupted from here. Anything else is still queued
+    // over there, behind whatever was sent before the cancel.
+    if (session.handshakeComplete() &&
+        message.value(QStringLiteral("type")).toString() == QStringLiteral("cancel"))
+    {
+      const QString requestId = message.value(QStringLiteral("request_id")).toString();
+      const QString targetId = message.value(QStringLiteral("params"))
+                                 .toObject()
+                                 .value(QStringLiteral("request_id"))
+                                 .toString();
+      if (!targetId.isEmpty() && this->Interrupt && this->Interrupt(session.id(), targetId))
+      {
+        this->sendToClient(session,
+                           ParaViewMCPRequestHandler::cancelResult(requestId, targetId, true));
+        continue;
+      }
+      session.beginRequest();
+      emit this->cancelRequested(session.id(), message);
+      continue;
+    }
+    session.beginRequest();
+    emit this->requestReceived(session.id(), message, received);
+  }
+}
+
+ParaViewMCPSession* ParaViewMCPNetworkWorker::sessionFor(quint64 connectionId) const
+{
+  for (const auto& entry : this->Sessions)
+  {
+    if (entry.second->id() == connectionId)
+    {
+      return entry.second.get();
+    }
+  }
+  return nullptr;
+}
+
+void ParaViewMCPNetworkWorker::sendResult(quint64 connectionId,
+                                          ParaViewMCPRequestHandler::Result result)
+{
+  // The client this answers may have disconnected while the GUI thread was
+  // working on it; ids are never reused, so nobody else sees the reply.
+  ParaViewMCPSession* session = this->sessionFor(connectionId);
+  if (session == nullptr)
+  {
+    return;
+  }
+
+  session->endRequest();
+  if (result.HandshakeCompleted && result.NegotiatedWire.SharedMemory)
+  {
+    this->openSharedRegion(*session, result);
+  }
+  this->sendToClient(*session, result);
+}
+
+void ParaViewMCPNetworkWorker::dropClient(quint64 connectionId)
+{
+  ParaViewMCPSession* session = this->sessionFor(connectionId);
+  if (session != nullptr)
+  {
+    this->closeClientSocket(session->socket(), false, false);
+  }
+}
+
+QJsonObject ParaViewMCPNetworkWorker::statusFor(const ParaViewMCPSession& session) const
+{
+  QJsonObject status = this->Status ? this->Status(session.id()) : QJsonObject();
+  status.insert(QStringLiteral("sessions"), static_cast<int>(this->Sessions.size()));
+  status.insert(QStringLiteral("pending"), session.inFlight());
+
+  const ParaViewMCP::OutboundStats outbound = this->outboundStats();
+  status.insert(QStringLiteral("outbound"),
+                QJsonObject{
+                  {"queued_bytes", outbound.QueuedBytes},
+                  {"peak_queued_bytes", outbound.PeakQueuedBytes},
+                  {"pauses", static_cast<qint64>(outbound.Pauses)},
+                  {"paused_connections", outbound.PausedConnections},
+                });
+  const ParaViewMCP::CompressionStats& compression = session.compressionStats();
+  status.insert(QStringLiteral("compression"),
+                QJsonObject{
+                  {"frames", static_cast<qint64>(compression.Frames)},
+                  {"bytes_before", static_cast<qint64>(compression.BytesBefore)},
+                  {"bytes_after", static_cast<qint64>(compression.BytesAfter)},
+                  {"bytes_saved", compression.bytesSaved()},
+                });
+  const ParaViewMCP::LatencyStats latency = this->latencyStats();
+  status.insert(QStringLiteral("latency"),
+                QJsonObject{
+                  {"samples", latency.Samples},
+                  {"last_ms", latency.LastMs},
+                  {"p50_ms", latency.P50Ms},
+                  {"p90_ms", latency.P90Ms},
+                  {"p99_ms", latency.P99Ms},
+                });
+  return status;
+}
+
+// Maps a fresh region for the client that just agreed to one and tells it
+// where to find it. If that fails the connection carries on inline.
+void ParaViewMCPNetworkWorker::openSharedRegion(ParaViewMCPSession& session,
+                                                ParaViewMCPRequestHandler::Result& result)
+{
+  ParaViewMCPSharedRegion& region = session.sharedRegion();
+  QString regionError;
+  if (!region.open(this->Config.SharedMemoryBytes, &regionError))
+  {
+    result.NegotiatedWire.SharedMemory = false;
+    emit this->logChanged(regionError);
+    return;
+  }
+
+  QJsonObject reply = result.Response.value(QStringLiteral("result")).toObject();
+  QJsonArray capabilities = reply.value(QStringLiteral("capabilities")).toArray();
+  capabilities.append(ParaViewMCP::sharedMemoryCapability());
+  reply.insert(QStringLiteral("capabilities"), capabilities);
+  reply.insert(QStringLiteral("shared_memory"),
+               QJsonObject{
+                 {"path", region.path()},
+                 {"size", region.size()},
+                 {"threshold", static_cast<qint64>(ParaViewMCP::SharedMemoryThreshold)},
+               });
+  result.Response.insert(QStringLiteral("result"), reply);
+}
+
+void ParaViewMCPNetworkWorker::sendToClient(ParaViewMCPSession& session,
+                                            const ParaViewMCPRequestHandler::Result& result)
+{
+  if (!result.Response.isEmpty())
+  {
+    ParaViewMCPNetworkWorker::sendMessage(session.outbound(),
+                                          result.Response,
+                                          result.RawResult,
+                                          result.Attachments,
+                                          session.wireOptions(),
+                                          &session.compressionStats(),
+                                          session.activeSharedRegion());
+    this->pumpOutbound(session);
+  }
+
+  if (result.HandshakeCompleted)
+  {
+    session.setHandshakeComplete(true);
+    session.setWireOptions(result.NegotiatedWire);
+  }
+
+  // Destroys the session; nothing may use it after this.
+  if (result.CloseConnection)
+  {
+    this->closeClientSocket(session.socket(), result.ResetSession);
+  }
+}
+
+// Hands queued frames to the socket as it makes room and pauses or resumes
+// reading this client's requests when its backlog crosses a watermark.
+void ParaViewMCPNetworkWorker::pumpOutbound(ParaViewMCPSession& session)
+{
+  ParaViewMCPOutboundQueue& outbound = session.outbound();
+  QIODevice* socket = session.socket();
+  const bool wasPaused = outbound.isPaused();
+  outbound.pump(socket);
+  if (outbound.isPaused() != wasPaused)
+  {
+    ParaViewMCPNetworkWorker::throttleReads(socket, outbound.isPaused());
+    if (outbound.isPaused())
+    {
+      ++this->OutboundPauses;
+      emit this->logChanged(
+        QStringLiteral("Client %1 is not reading its replies; holding its requests")
+          .arg(session.id()));
+    }
+    else
+    {
+      // Requests that arrived meanwhile are waiting in the socket without a
+      // new readyRead() to announce them. Queued, so a caller still walking
+      // this session's messages is not re-entered.
+      QMetaObject::invokeMethod(
+        this, [this, socket]() { this->onSocketReadyRead(socket); }, Qt::QueuedConnection);
+    }
+  }
+  this->updateOutboundStats();
+}
+
+void ParaViewMCPNetworkWorker::updateOutboundStats()
+{
+  ParaViewMCP::OutboundStats stats;
+  for (const auto& entry : this->Sessions)
+  {
+    const ParaViewMCPOutboundQueue& outbound = entry.second->outbound();
+    stats.QueuedBytes += outbound.outstandingBytes(entry.first);
+    stats.PausedConnections += outbound.isPaused() ? 1 : 0;
+  }
+  stats.Pauses = this->OutboundPauses;
+
+  const QMutexLocker locker(&this->StatsMutex);
+  stats.PeakQueuedBytes = qMax(this->Outbound.PeakQueuedBytes, stats.QueuedBytes);
+  this->Outbound = stats;
+}
+
+void ParaViewMCPNetworkWorker::sendHeartbeats()
+{
+  // Closing a client erases it from the table, so silent ones are collected
+  // first and dropped afterwards.
+  QList<QIODevice*> silent;
+  for (const auto& entry : this->Sessions)
+  {
+    ParaViewMCPSession& session = *entry.second;
+    if (!session.handshakeComplete() || !session.wireOptions().Heartbeat)
+    {
+      continue;
+    }
+    // A paused client is not being read, so its answers could not arrive; it
+    // is left alone until it has caught up.
+    if (session.outbound().isPaused())
+    {
+      session.heartbeat().forgive();
+      continue;
+    }
+    if (this->Config.HeartbeatTimeoutMs > 0 &&
+        session.heartbeat().unansweredMs() >= this->Config.HeartbeatTimeoutMs)
+    {
+      silent.push_back(entry.first);
+      continue;
+    }
+
+    const quint64 heartbeatId = session.heartbeat().beat();
+    ParaViewMCPNetworkWorker::sendMessage(session.outbound(),
+                                          QJsonObject{
+                                            {"type", QStringLiteral("heartbeat")},
+                                            {"heartbeat_id", static_cast<qint64>(heartbeatId)},
+                                          },
+                                          QByteArray(),
+                                          {},
+                                          session.wireOptions(),
+                                          &session.compressionStats());
+    this->pumpOutbound(session);
+  }
+
+  for (QIODevice* socket : silent)
+  {
+    emit this->logChanged(
+      QStringLiteral("Client %1 stopped answering heartbeats; disconnecting it")
+        .arg(this->Sessions.at(socket)->id()));
+    this->closeClientSocket(socket, true);
+  }
+}
+
+void ParaViewMCPNetworkWorker::updateLatencyStats()
+{
+  QList<double> samples;
+  for (const auto& entry : this->Sessions)
+  {
+    samples.append(entry.second->heartbeat().roundTrips());
+  }
+  ParaViewMCP::LatencyStats stats = ParaViewMCPHeartbeat::summarize(samples);
+  stats.LastMs = stats.Samples > 0 ? this->LastRoundTripMs : 0.0;
+
+  {
+    const QMutexLocker locker(&this->StatsMutex);
+    this->Latency = stats;
+  }
+  emit this->latencyChanged(stats);
+}
+
+void ParaViewMCPNetworkWorker::flushSocket(QIODevice* socket)
+{
+  // QIODevice has no flush(); both socket types provide their own.
+  if (auto* tcpSocket = qobject_cast<QTcpSocket*>(socket))
+  {
+    tcpSocket->flush();
+  }
+  else if (auto* localSocket = qobject_cast<QLocalSocket*>(socket))
+  {
+    localSocket->flush();
+  }
+}
+
+void ParaViewMCPNetworkWorker::disconnectSocket(QIODevice* socket)
+{
+  if (auto* tcpSocket = qobject_cast<QTcpSocket*>(socket))
+  {
+    tcpSocket->disconnectFromHost();
+  }
+  else if (auto* localSocket = qobject_cast<QLocalSocket*>(socket))
+  {
+    localSocket->disconnectFromServer();
+  }
+}
+
+// A paused socket keeps at most this much unread input in memory, enough for
+// a few pipelined requests; the rest stays with the kernel.
+void ParaViewMCPNetworkWorker::throttleReads(QIODevice* socket, bool paused)
+{
+  const qint64 readBufferBytes = paused ? 64 * 1024 : 0;
+  if (auto* tcpSocket = qobject_cast<QTcpSocket*>(socket))
+  {
+    tcpSocket->setReadBufferSize(readBufferBytes);
+  }
+  else if (auto* localSocket = qobject_cast<QLocalSocket*>(socket))
+  {
+    localSocket->setReadBufferSize(readBufferBytes);
+  }
+}
+
+void ParaViewMCPNetworkWorker::tuneSocket(QTcpSocket* socket, const ParaViewMCPServerConfig& config)
+{
+  if (!config.LowLatency)
+  {
+    return;
+  }
+  socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+  socket->setSocketOption(QAbstractSocket::KeepAliveOption, 1);
+  // QTcpServer offers no hook before listen(), so the buffers are sized on the
+  // accepted socket. The receive buffer then only takes effect after the
+  // handshake: it bounds what the kernel holds for us but cannot widen the
+  // window scale already agreed in the SYN.
+  if (config.SocketBufferBytes > 0)
+  {
+    socket->setSocketOption(QAbstractSocket::SendBufferSizeSocketOption, config.SocketBufferBytes);
+    socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption,
+                            config.SocketBufferBytes);
+  }
+}
+
+void ParaViewMCPNetworkWorker::sendMessage(ParaViewMCPOutboundQueue& outbound,
+                                           const QJsonObject& message,
+                                           const QByteArray& rawResult,
+                                           const QList<ParaViewMCP::Attachment>& attachments,
+                                           const ParaViewMCP::WireOptions& wire,
+                                           ParaViewMCP::CompressionStats* stats,
+                                           ParaViewMCPSharedRegion* region)
+{
+  // With a shared region, large attachments are written into it once and
+  // their descriptors carry a ring position instead of a frame following the
+  // envelope. Whatever does not fit right now is sent inline as usual.
+  QJsonObject envelope = message;
+  QList<ParaViewMCP::Attachment> inlineAttachments;
+  QJsonArray descriptors = envelope.value(QStringLiteral("attachments")).toArray();
+  for (qsizetype index = 0; index < attachments.size(); ++index)
+  {
+    const ParaViewMCP::Attachment& attachment = attachments.at(index);
+    const qint64 position =
+      region != nullptr && attachment.Data.size() >= ParaViewMCP::SharedMemoryThreshold
+        ? region->write(attachment.Data)
+        : -1;
+    if (position < 0)
+    {
+      inlineAttachments.push_back(attachment);
+      continue;
+    }
+    QJsonObject descriptor = descriptors.at(index).toObject();
+    descriptor.insert(QStringLiteral("position"), position);
+    descriptors.replace(index, descriptor);
+  }
+  if (inlineAttachments.size() != attachments.size())
+  {
+    envelope.insert(QStringLiteral("attachments"), descriptors);
+  }
+
+  // A large envelope goes the same way and is replaced on the wire by a small
+  // frame pointing at it. Only inline envelopes are compressed; attachments
+  // such as PNG screenshots are already deflated and would not shrink further.
+  quint32 flags = 0;
+  QByteArray payload = ParaViewMCP::serializeMessage(envelope, rawResult, wire, &flags);
+  const qint64 position = region != nullptr && payload.size() >= ParaViewMCP::SharedMemoryThreshold
+                            ? region->write(payload)
+                            : -1;
+  if (position >= 0)
+  {
+    const QJsonObject pointer{
+      {"request_id", message.value(QStringLiteral("request_id"))},
+      {"shared_payload",
+       QJsonObject{
+         {"position", position},
+         {"length", static_cast<qint64>(payload.size())},
+         {"flags", static_cast<qint64>(flags)},
+       }},
+    };
+    flags = 0;
+    payload = ParaViewMCP::serializeMessage(pointer, wire, &flags);
+  }
+  else
+  {
+    payload = ParaViewMCP::compressPayload(payload, wire, &flags, stats);
+  }
+
+  bool fits = ParaViewMCP::canSendPayload(payload.size(), wire);
+  for (const ParaViewMCP::Attachment& attachment : inlineAttachments)
+  {
+    fits = fits && ParaViewMCP::canSendPayload(attachment.Data.size(), wire);
+  }
+
+  // Decide before writing anything so an oversized response is replaced by an
+  // error instead of leaving a half-written frame sequence on the wire.
+  if (!fits)
+  {
+    const auto tooLarge = ParaViewMCPRequestHandler::responseTooLarge(
+      message.value(QStringLiteral("request_id")).toString());
+    outbound.enqueue(ParaViewMCP::serializeMessage(tooLarge.Response), 0, wire.MaxFrameBytes);
+    return;
+  }
+
+  outbound.enqueue(payload, flags, wire.MaxFrameBytes);
+  for (const ParaViewMCP::Attachment& attachment : inlineAttachments)
+  {
+    outbound.enqueue(attachment.Data, ParaViewMCP::FrameFlagBinary, wire.MaxFrameBytes);
+  }
+}
+
+// announce is false when the GUI thread asked for the close itself and will
+// do the session cleanup without waiting for clientDetached().
+void ParaViewMCPNetworkWorker::closeClientSocket(QIODevice* socket,
+                                                 bool resetSession,
+                                                 bool announce)
+{
+  const auto found = this->Sessions.find(socket);
+  if (found == this->Sessions.end())
+  {
+    return;
+  }
+  const quint64 connectionId = found->second->id();
+  // Whatever is still queued (e.g. a final error) goes to the socket first.
+  if (socket->isWritable())
+  {
+    found->second->outbound().drain(socket);
+  }
+  // Erasing closes the session's shared region along with it.
+  this->Sessions.erase(found);
+  this->updateOutboundStats();
+  this->updateLatencyStats();
+
+  QObject::disconnect(socket, nullptr, this, nullptr);
+  // Responses are written from the event loop; push out whatever the socket
+  // still holds before it is torn down.
+  ParaViewMCPNetworkWorker::flushSocket(socket);
+  socket->close();
+  socket->deleteLater();
+
+  if (announce)
+  {
+    emit this->clientDetached(connectionId, resetSession);
+  }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "ParaViewMCPProtocol.h"
+#include "ParaViewMCPRequestHandler.h"
+#include "ParaViewMCPServerConfig.h"
+#include "ParaViewMCPSession.h"
+
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QMetaType>
+#include <QMutex>
+#include <QObject>
+
+#include <functional>
+#include <map>
+#include <memory>
+
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+
+// The listening servers, the connected sockets and their framing. Lives on the
+// bridge's network thread so reading, writing and answering pings never wait
+// for Python; every other request is handed to the GUI thread through
+// requestReceived() and its result comes back through sendResult().
+//
+// Each accepted client gets its own session and a new connection id, up to
+// the configured MaxSessions. Results carry the id of the connection they
+// answer and are dropped if that client is already gone.
+//
+// Clients that negotiated 'heartbeat' are sent one every HeartbeatIntervalMs.
+// Their answers give the round-trip times reported by latencyStats(), and a
+// client that leaves one unanswered for HeartbeatTimeoutMs is disconnected.
+//
+// Control messages are answered here so they stay quick while Python runs:
+// 'ping', 'status', and a 'cancel' the interrupt handler can act on. Other
+// cancels are handed over through cancelRequested() to be looked for in the
+// client's queue.
+class ParaViewMCPNetworkWorker : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit ParaViewMCPNetworkWorker(QObject* parent = nullptr);
+
+  bool listen(const ParaViewMCPServerConfig& config,
+              const QHostAddress& address,
+              QString* error = nullptr);
+  // Stops listening and drops every client without announcing it. Returns
+  // the last connection id handed out: every connection up to it is now
+  // closed, including any whose clientAttached() has not been delivered yet.
+  quint64 close();
+
+  [[nodiscard]] quint16 serverPort() const;
+  [[nodiscard]] QString socketPath() const;
+  // Safe to call from any thread.
+  [[nodiscard]] ParaViewMCP::OutboundStats outboundStats() const;
+  // Safe to call from any thread.
+  [[nodiscard]] ParaViewMCP::LatencyStats latencyStats() const;
+
+  // Called on the network thread with a connection id and the request id a
+  // 'cancel' names; returns true if it stopped that request. Set before the
+  // worker is moved to its thread.
+  using InterruptHandler = std::function<bool(quint64, const QString&)>;
+  void setInterruptHandler(InterruptHandler handler);
+  // Called on the network thread for 'status' with the asking connection's
+  // id; returns what the GUI thread is doing. Set before the worker is moved
+  // to its thread.
+  using StatusHandler = std::function<QJsonObject(quint64)>;
+  void setStatusHandler(StatusHandler handler);
+
+  void sendResult(quint64 connectionId, ParaViewMCPRequestHandler::Result result);
+  // Closes the connection without announcing it; used when a newer
+  // connection has taken over its session.
+  void dropClient(quint64 connectionId);
+
+signals:
+  void logChanged(const QString& message);
+  void clientAttached(quint64 connectionId, const ParaViewMCP::WireOptions& wire);
+  void clientDetached(quint64 connectionId, bool resetSession);
+  void requestReceived(quint64 connectionId,
+                       const QJsonObject& message,
+                       const ParaViewMCP::ReceiveTiming& received);
+  void cancelRequested(quint64 connectionId, const QJsonObject& message);
+  void latencyChanged(const ParaViewMCP::LatencyStats& stats);
+
+private:
+  bool listenTcp(const QHostAddress& address, quint16 port, QString* error);
+  bool listenLocal(const QString& path, QString* error);
+  void onNewConnection();
+  void onNewLocalConnection();
+  bool acceptClient(QIODevice* socket);
+  void onSocketReadyRead(QIODevice* socket);
+  ParaViewMCPSession* sessionFor(quint64 connectionId) const;
+  QJsonObject statusFor(const ParaViewMCPSession& session) const;
+  void openSharedRegion(ParaViewMCPSession& session, ParaViewMCPRequestHandler::Result& result);
+  void sendToClient(ParaViewMCPSession& session, const ParaViewMCPRequestHandler::Result& result);
+  void pumpOutbound(ParaViewMCPSession& session);
+  void updateOutboundStats();
+  void sendHeartbeats();
+  void updateLatencyStats();
+  static void flushSocket(QIODevice* socket);
+  static void disconnectSocket(QIODevice* socket);
+  static void throttleReads(QIODevice* socket, bool paused);
+  static void tuneSocket(QTcpSocket* socket, const ParaViewMCPServerConfig& config);
+  static void sendMessage(ParaViewMCPOutboundQueue& outbound,
+                          const QJsonObject& message,
+                          const QByteArray& rawResult = QByteArray(),
+                          const QList<ParaViewMCP::Attachment>& attachments = {},
+                          const ParaViewMCP::WireOptions& wire = ParaViewMCP::WireOptions(),
+                          ParaViewMCP::CompressionStats* stats = nullptr,
+                          ParaViewMCPSharedRegion* region = nullptr);
+  void closeClientSocket(QIODevice* socket, bool resetSession, bool announce = true);
+
+  QTcpServer* Server = nullptr;
+  QLocalServer* LocalServer = nullptr;
+  QTimer* HeartbeatTimer = nullptr;
+  ParaViewMCPServerConfig Config;
+  InterruptHandler Interrupt;
+  StatusHandler Status;
+  // The session table. Sessions are few (MaxSessions), so looking one up by
+  // connection id is a scan.
+  std::map<QIODevice*, std::unique_ptr<ParaViewMCPSession>> Sessions;
+  quint64 LastConnectionId = 0;
+  // Pauses of sessions already closed still count.
+  quint64 OutboundPauses = 0;
+  double LastRoundTripMs = 0.0;
+  mutable QMutex StatsMutex;
+  ParaViewMCP::OutboundStats Outbound;
+  ParaViewMCP::LatencyStats Latency;
+};
+
+Q_DECLARE_METATYPE(ParaViewMCP::WireOptions)
+Q_DECLARE_METATYPE(ParaViewMCP::LatencyStats)
+Q_DECLARE_METATYPE(ParaViewMCP::ReceiveTiming)
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "ParaViewMCPProtocol.h"
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QQueue>
+
+// Frames waiting to go out on one connection. Responses are queued here
+// instead of being written straight into the socket, and pump() hands them to
+// the socket a little at a time as it reports bytesWritten(), so a client that
+// reads slowly holds up its own replies instead of growing the socket's write
+// buffer without limit.
+//
+// Queued frames share their payload with the caller; chunking a large payload
+// records offsets rather than copying it.
+//
+// Once more than the high watermark is outstanding (queued here plus not yet
+// taken by the socket) the queue reports itself paused, and the connection
+// stops reading new requests until it has drained below the low watermark.
+class ParaViewMCPOutboundQueue
+{
+public:
+  // Bytes handed to the socket per pump; more only once they are written.
+  static constexpr qint64 WriteBytes = 1024 * 1024;
+
+  void setWatermarks(qint64 high, qint64 low)
+  {
+    this->High = high;
+    this->Low = qMin(low, high);
+  }
+
+  // Payloads larger than maxFrameBytes become a chain of frames; every chunk
+  // but the last carries FrameFlagContinued and all carry the payload's flags.
+  void enqueue(const QByteArray& payload, quint32 flags, quint32 maxFrameBytes)
+  {
+    const qsizetype chunkBytes = static_cast<qsizetype>(maxFrameBytes);
+    if (payload.size() <= chunkBytes)
+    {
+      this->push(payload, 0, payload.size(), flags);
+      return;
+    }
+
+    for (qsizetype offset = 0; offset < payload.size(); offset += chunkBytes)
+    {
+      const qsizetype length = qMin(chunkBytes, payload.size() - offset);
+      const bool lastChunk = offset + length == payload.size();
+      this->push(
+        payload, offset, length, lastChunk ? flags : flags | ParaViewMCP::FrameFlagContinued);
+    }
+  }
+
+  // Moves whole frames into the device while it holds less than WriteBytes.
+  void pump(QIODevice* device)
+  {
+    while (!this->Frames.isEmpty() && device->bytesToWrite() < WriteBytes)
+    {
+      this->writeNext(device);
+    }
+    this->update(device);
+  }
+
+  // Moves everything into the device regardless of how much it holds; used
+  // right before a connection is closed.
+  void drain(QIODevice* device)
+  {
+    while (!this->Frames.isEmpty())
+    {
+      this->writeNext(device);
+    }
+    this->update(device);
+  }
+
+  void clear()
+  {
+    this->Frames.clear();
+    this->Bytes = 0;
+    this->Paused = false;
+  }
+
+  // Bytes accepted for this connection that the socket has not sent yet.
+  [[nodiscard]] qint64 outstandingBytes(const QIODevice* device) const
+  {
+    return this->Bytes + (device != nullptr ? device->bytesToWrite() : 0);
+  }
+
+  [[nodiscard]] bool isPaused() const
+  {
+    return this->Paused;
+  }
+
+private:
+  struct Frame
+  {
+    QByteArray Payload;
+    qsizetype Offset = 0;
+    qsizetype Length = 0;
+    quint32 Flags = 0;
+  };
+
+  void push(const QByteArray& payload, qsizetype offset, qsizetype length, quint32 flags)
+  {
+    this->Frames.enqueue(Frame{payload, offset, length, flags});
+    this->Bytes += 4 + length;
+  }
+
+  void writeNext(QIODevice* device)
+  {
+    const Frame frame = this->Frames.dequeue();
+    ParaViewMCP::writeFrame(
+      device, frame.Payload.constData() + frame.Offset, frame.Length, frame.Flags);
+    this->Bytes -= 4 + frame.Length;
+  }
+
+  void update(const QIODevice* device)
+  {
+    const qint64 outstanding = this->outstandingBytes(device);
+    if (!this->Paused && outstanding > this->High)
+    {
+      this->Paused = true;
+    }
+    else if (this->Paused && outstanding <= this->Low)
+    {
+      this->Paused = false;
+    }
+  }
+
+  QQueue<Frame> Frames;
+  qint64 Bytes = 0;
+  qint64 High = ParaViewMCP::DefaultOutboundHighWatermark;
+  qint64 Low = ParaViewMCP::DefaultOutboundHighWatermark / 4;
+  bool Paused = false;
+};
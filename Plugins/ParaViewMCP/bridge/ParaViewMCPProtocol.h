@@ -1,8 +1,14 @@
 #pragma once
 
+#include "ParaViewMCPReadBuffer.h"
+
 #include <algorithm>
+#include <chrono>
 
 #include <QByteArray>
+#include <QCborMap>
+#include <QCborValue>
+#include <QIODevice>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonParseError>
@@ -13,8 +19,233 @@
 namespace ParaViewMCP
 {
   inline constexpr int ProtocolVersion = 2;
+  // Default per-frame limit, used until 'hello' negotiates another one and by
+  // peers that do not ask for one.
   inline constexpr quint32 MaxFrameBytes = 25u * 1024u * 1024u;
+  // Smallest frame limit a client may negotiate or a user may configure; the
+  // largest is FrameLengthMask, the most a frame header can describe.
+  inline constexpr quint32 MinFrameBytes = 64u * 1024u;
+  // Upper bound for one logical payload streamed as chunked frames.
+  inline constexpr qint64 MaxMessageBytes = 1024ll * 1024ll * 1024ll;
   inline constexpr quint16 DefaultPort = 9877;
+  // Clients served at once; the next one is turned away with CLIENT_BUSY.
+  inline constexpr int DefaultMaxSessions = 4;
+
+  // The top four bits of a frame header carry flags that only appear once the
+  // corresponding feature was negotiated in 'hello'. Peers that never
+  // negotiated them still see such headers as oversized frames and reject them.
+  inline constexpr quint32 FrameLengthMask = 0x0FFFFFFFu;
+  inline constexpr quint32 FrameFlagCompressed = 0x80000000u;
+  inline constexpr quint32 FrameFlagContinued = 0x40000000u;
+  inline constexpr quint32 FrameFlagBinary = 0x20000000u;
+  inline constexpr quint32 FrameFlagCbor = 0x10000000u;
+
+  // Large binary result members (e.g. screenshots) that follow the JSON
+  // envelope as raw frames instead of travelling base64-encoded inside it.
+  struct Attachment
+  {
+    QString Key;
+    QByteArray Data;
+  };
+
+  inline constexpr int DefaultCompressionThreshold = 1024;
+  // Bodies at least this large go through the shared region when one was
+  // negotiated; smaller ones cost less to send inline than to describe.
+  inline constexpr qsizetype SharedMemoryThreshold = 64 * 1024;
+  inline constexpr qint64 DefaultSharedMemoryBytes = 64ll * 1024ll * 1024ll;
+  // Unsent reply bytes one connection may have outstanding before the bridge
+  // stops reading its requests; reading resumes below a quarter of this.
+  inline constexpr qint64 DefaultOutboundHighWatermark = 32ll * 1024ll * 1024ll;
+  // Clients that negotiate 'heartbeat' are sent one this often and dropped
+  // once one has gone unanswered for the timeout.
+  inline constexpr int DefaultHeartbeatIntervalMs = 5000;
+  inline constexpr int DefaultHeartbeatTimeoutMs = 15000;
+  // How long a disconnected client's Python session is kept for it to resume.
+  inline constexpr int DefaultResumeGraceMs = 60000;
+  // Kernel send and receive buffer size for accepted TCP connections; matches
+  // what the outbound queue hands the socket at a time.
+  inline constexpr int DefaultSocketBufferBytes = 1024 * 1024;
+
+  // Per-connection framing features agreed on during the handshake.
+  struct WireOptions
+  {
+    bool BinaryAttachments = false;
+    bool ChunkedFrames = false;
+    bool Cbor = false;
+    bool Compression = false;
+    int CompressionThreshold = DefaultCompressionThreshold;
+    // Largest single frame either side may send on this connection.
+    quint32 MaxFrameBytes = ParaViewMCP::MaxFrameBytes;
+    // Large bodies go through the session's shared region. Before 'hello'
+    // this only says whether the peer is close enough to be offered one.
+    bool SharedMemory = false;
+    // The client answers the bridge's 'heartbeat' messages.
+    bool Heartbeat = false;
+    // Replies to commands carry a 'timings' breakdown.
+    bool Timings = false;
+  };
+
+  // Monotonic nanoseconds, comparable between the network and GUI threads.
+  inline qint64 monotonicNs()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+  }
+
+  // Milliseconds with microsecond resolution, as reported in 'timings'.
+  inline double timingMs(qint64 nanoseconds)
+  {
+    return static_cast<double>(nanoseconds / 1000) / 1000.0;
+  }
+
+  // When and how quickly the network thread decoded a request.
+  struct ReceiveTiming
+  {
+    qint64 DecodedAtNs = 0;
+    // Decompressing and parsing the frame the request arrived in.
+    qint64 DecodeNs = 0;
+  };
+
+  inline quint32 clampFrameBytes(qint64 frameBytes)
+  {
+    return static_cast<quint32>(qBound<qint64>(MinFrameBytes, frameBytes, FrameLengthMask));
+  }
+
+  // Byte counters for payloads that were actually sent or received compressed.
+  struct CompressionStats
+  {
+    quint64 Frames = 0;
+    quint64 BytesBefore = 0;
+    quint64 BytesAfter = 0;
+
+    [[nodiscard]] qint64 bytesSaved() const
+    {
+      return static_cast<qint64>(this->BytesBefore) - static_cast<qint64>(this->BytesAfter);
+    }
+
+    void record(qsizetype before, qsizetype after)
+    {
+      ++this->Frames;
+      this->BytesBefore += static_cast<quint64>(before);
+      this->BytesAfter += static_cast<quint64>(after);
+    }
+  };
+
+  // Reply bytes accepted but not yet sent, summed over all connections.
+  struct OutboundStats
+  {
+    qint64 QueuedBytes = 0;
+    qint64 PeakQueuedBytes = 0;
+    // Times a connection went over its high watermark and stopped being read.
+    quint64 Pauses = 0;
+    int PausedConnections = 0;
+  };
+
+  // Heartbeat round trips of the connected clients, in milliseconds.
+  struct LatencyStats
+  {
+    int Samples = 0;
+    double LastMs = 0.0;
+    double P50Ms = 0.0;
+    double P90Ms = 0.0;
+    double P99Ms = 0.0;
+  };
+
+  inline QString binaryAttachmentsCapability()
+  {
+    return QStringLiteral("binary_attachments");
+  }
+
+  inline QString chunkedFramesCapability()
+  {
+    return QStringLiteral("chunked_frames");
+  }
+
+  inline QString cborCapability()
+  {
+    return QStringLiteral("cbor");
+  }
+
+  inline QString sharedMemoryCapability()
+  {
+    return QStringLiteral("shared_memory");
+  }
+
+  inline QString heartbeatCapability()
+  {
+    return QStringLiteral("heartbeat");
+  }
+
+  inline QString timingsCapability()
+  {
+    return QStringLiteral("timings");
+  }
+
+  inline QString zlibCodecName()
+  {
+    return QStringLiteral("zlib");
+  }
+
+  // Compresses payloads at or above the negotiated threshold with qCompress
+  // (a 4-byte big-endian original size followed by a zlib stream) and keeps
+  // the result only when it is actually smaller.
+  inline QByteArray compressPayload(const QByteArray& payload,
+                                    const WireOptions& wire,
+                                    quint32* flags,
+                                    CompressionStats* stats = nullptr)
+  {
+    if (!wire.Compression || payload.size() < wire.CompressionThreshold)
+    {
+      return payload;
+    }
+
+    QByteArray compressed = qCompress(payload);
+    if (compressed.size() >= payload.size())
+    {
+      return payload;
+    }
+
+    *flags |= FrameFlagCompressed;
+    if (stats)
+    {
+      stats->record(payload.size(), compressed.size());
+    }
+    return compressed;
+  }
+
+  // Inbound payloads are never chunked, so a compressed one may not expand
+  // past what the peer could have sent uncompressed in a single frame. The
+  // declared size is checked before qUncompress allocates anything.
+  inline bool decompressPayload(const QByteArray& payload,
+                                quint32 maxFrameBytes,
+                                QByteArray* inflated,
+                                QString* error)
+  {
+    const qint64 declaredSize =
+      payload.size() < 4 ? -1
+                         : static_cast<qint64>(qFromBigEndian<quint32>(
+                             reinterpret_cast<const uchar*>(payload.constData())));
+    if (declaredSize < 0 || declaredSize > static_cast<qint64>(maxFrameBytes))
+    {
+      if (error)
+      {
+        *error = QStringLiteral("Received a compressed payload with an invalid size");
+      }
+      return false;
+    }
+
+    *inflated = qUncompress(payload);
+    if (inflated->size() != declaredSize)
+    {
+      if (error)
+      {
+        *error = QStringLiteral("Received a corrupt compressed payload");
+      }
+      return false;
+    }
+    return true;
+  }
 
   inline QString defaultHost()
   {
@@ -28,57 +259,235 @@ namespace ParaViewMCP
            normalized == QStringLiteral("::1");
   }
 
-  inline QByteArray encodeMessage(const QJsonObject& message)
+  inline QByteArray encodeFrame(const QByteArray& payload, quint32 flags = 0)
   {
-    const QByteArray payload = QJsonDocument(message).toJson(QJsonDocument::JsonFormat::Compact);
     QByteArray frame;
     frame.resize(4 + payload.size());
-    qToBigEndian<quint32>(static_cast<quint32>(payload.size()), frame.data());
+    qToBigEndian<quint32>(static_cast<quint32>(payload.size()) | flags, frame.data());
     std::copy(payload.cbegin(), payload.cend(), frame.begin() + 4);
     return frame;
   }
 
-  inline bool tryExtractMessages(QByteArray& buffer, QList<QJsonObject>& messages, QString* error)
+  inline QByteArray serializeMessage(const QJsonObject& message)
+  {
+    return QJsonDocument(message).toJson(QJsonDocument::JsonFormat::Compact);
+  }
+
+  // Serializes with the negotiated encoding and marks CBOR payloads in 'flags'.
+  inline QByteArray
+  serializeMessage(const QJsonObject& message, const WireOptions& wire, quint32* flags)
   {
-    while (true)
+    if (!wire.Cbor)
     {
-      if (buffer.size() < 4)
-      {
-        return true;
-      }
+      return serializeMessage(message);
+    }
+    *flags |= FrameFlagCbor;
+    return QCborMap::fromJsonObject(message).toCborValue().toCbor();
+  }
+
+  // Splices pre-serialized JSON object text in as the envelope's "result"
+  // member, so a large result is never parsed into (or re-walked as) a DOM.
+  inline QByteArray serializeEnvelope(const QJsonObject& envelope, const QByteArray& rawResult)
+  {
+    static constexpr char Member[] = ",\"result\":";
+    const QByteArray head = serializeMessage(envelope);
+    const char* member = envelope.isEmpty() ? Member + 1 : Member;
+    const qsizetype memberLength = static_cast<qsizetype>(qstrlen(member));
+
+    QByteArray payload;
+    payload.reserve(head.size() + memberLength + rawResult.size());
+    payload.append(head.constData(), head.size() - 1);
+    payload.append(member, memberLength);
+    payload.append(rawResult);
+    payload.append('}');
+    return payload;
+  }
+
+  inline QByteArray serializeMessage(const QJsonObject& message,
+                                     const QByteArray& rawResult,
+                                     const WireOptions& wire,
+                                     quint32* flags)
+  {
+    if (rawResult.isEmpty())
+    {
+      return serializeMessage(message, wire, flags);
+    }
+    if (wire.Cbor)
+    {
+      // CBOR has no text form to splice into, so the result is parsed once.
+      QJsonObject full = message;
+      full.insert(QStringLiteral("result"), QJsonDocument::fromJson(rawResult).object());
+      return serializeMessage(full, wire, flags);
+    }
+    return serializeEnvelope(message, rawResult);
+  }
+
+  inline bool canSendPayload(qsizetype size, const WireOptions& wire)
+  {
+    return size <= static_cast<qsizetype>(wire.MaxFrameBytes) ||
+           (wire.ChunkedFrames && static_cast<qint64>(size) <= MaxMessageBytes);
+  }
+
+  inline void writeFrameHeader(QIODevice* device, qsizetype length, quint32 flags)
+  {
+    uchar header[4];
+    qToBigEndian<quint32>(static_cast<quint32>(length) | flags, header);
+    device->write(reinterpret_cast<const char*>(header), sizeof(header));
+  }
+
+  // Header and payload go out as two writes straight from the caller's buffer,
+  // so no payload+4 frame is assembled; the device's write buffer holds the
+  // only other copy.
+  inline void writeFrame(QIODevice* device, const char* data, qsizetype length, quint32 flags)
+  {
+    writeFrameHeader(device, length, flags);
+    device->write(data, length);
+  }
 
-      const quint32 frameLength =
-        qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(buffer.constData()));
-      if (frameLength > MaxFrameBytes)
+  namespace detail
+  {
+    inline bool parsePayload(const QByteArray& payload, bool cbor, QJsonObject* message)
+    {
+      if (cbor)
       {
-        if (error)
+        QCborParserError parseError;
+        const QCborValue value = QCborValue::fromCbor(payload, &parseError);
+        if (parseError.error != QCborError::NoError || !value.isMap())
         {
-          *error = QStringLiteral("Incoming frame exceeds the maximum allowed size");
+          return false;
         }
-        return false;
-      }
-
-      const qsizetype totalLength = 4 + static_cast<qsizetype>(frameLength);
-      if (buffer.size() < totalLength)
-      {
+        *message = value.toMap().toJsonObject();
         return true;
       }
 
-      const QByteArray payload = buffer.mid(4, frameLength);
-      buffer.remove(0, totalLength);
-
       QJsonParseError parseError;
       const QJsonDocument document = QJsonDocument::fromJson(payload, &parseError);
       if (parseError.error != QJsonParseError::NoError || !document.isObject())
       {
-        if (error)
+        return false;
+      }
+      *message = document.object();
+      return true;
+    }
+
+    // Parses every complete frame in [data, data + size) and reports how many
+    // bytes were consumed. Uncompressed payloads are handed to the JSON parser
+    // as views into the caller's storage, so no per-frame copy is made. When
+    // the input ends inside a frame whose header was read, *pending receives
+    // that frame's total length. With 'timings', each message gets its own
+    // entry, stamped as it is parsed.
+    inline bool extractFrames(const char* data,
+                              qsizetype size,
+                              qsizetype* consumed,
+                              qsizetype* pending,
+                              QList<QJsonObject>& messages,
+                              QString* error,
+                              const WireOptions& wire,
+                              CompressionStats* stats,
+                              QList<ReceiveTiming>* timings = nullptr)
+    {
+      const quint32 allowedFlags =
+        (wire.Compression ? FrameFlagCompressed : 0u) | (wire.Cbor ? FrameFlagCbor : 0u);
+      qsizetype offset = 0;
+      *pending = 0;
+      while (true)
+      {
+        *consumed = offset;
+        if (size - offset < 4)
         {
-          *error = QStringLiteral("Received malformed JSON payload");
+          return true;
+        }
+
+        const quint32 header =
+          qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(data + offset));
+        const quint32 frameLength = header & FrameLengthMask;
+        const quint32 flags = header & ~FrameLengthMask;
+        if (frameLength > wire.MaxFrameBytes || (flags & ~allowedFlags) != 0)
+        {
+          if (error)
+          {
+            *error = QStringLiteral("Incoming frame exceeds the maximum allowed size");
+          }
+          return false;
+        }
+
+        const qsizetype totalLength = 4 + static_cast<qsizetype>(frameLength);
+        if (size - offset < totalLength)
+        {
+          *pending = totalLength;
+          return true;
+        }
+
+        const qint64 frameStartedNs = timings != nullptr ? monotonicNs() : 0;
+        QByteArray payload =
+          QByteArray::fromRawData(data + offset + 4, static_cast<qsizetype>(frameLength));
+        offset += totalLength;
+
+        if ((flags & FrameFlagCompressed) != 0)
+        {
+          QByteArray inflated;
+          if (!decompressPayload(payload, wire.MaxFrameBytes, &inflated, error))
+          {
+            *consumed = offset;
+            return false;
+          }
+          if (stats)
+          {
+            stats->record(inflated.size(), payload.size());
+          }
+          payload = inflated;
+        }
+
+        const bool cbor = (flags & FrameFlagCbor) != 0;
+        QJsonObject message;
+        if (!parsePayload(payload, cbor, &message))
+        {
+          *consumed = offset;
+          if (error)
+          {
+            *error = cbor ? QStringLiteral("Received malformed CBOR payload")
+                          : QStringLiteral("Received malformed JSON payload");
+          }
+          return false;
+        }
+
+        messages.push_back(message);
+        if (timings != nullptr)
+        {
+          ReceiveTiming timing;
+          timing.DecodedAtNs = monotonicNs();
+          timing.DecodeNs = timing.DecodedAtNs - frameStartedNs;
+          timings->push_back(timing);
         }
-        return false;
       }
+    }
+  } // namespace detail
 
-      messages.push_back(document.object());
+  inline bool tryExtractMessages(ParaViewMCPReadBuffer& buffer,
+                                 QList<QJsonObject>& messages,
+                                 QString* error,
+                                 const WireOptions& wire = WireOptions(),
+                                 CompressionStats* stats = nullptr,
+                                 QList<ReceiveTiming>* timings = nullptr)
+  {
+    qsizetype consumed = 0;
+    qsizetype pending = 0;
+    const bool ok = detail::extractFrames(buffer.constData(),
+                                          buffer.size(),
+                                          &consumed,
+                                          &pending,
+                                          messages,
+                                          error,
+                                          wire,
+                                          stats,
+                                          timings);
+    buffer.consume(consumed);
+    // Storage is only sized from a header whose length is within the
+    // negotiated limit; anything larger never reaches the allocator.
+    if (ok && pending > 0 && pending <= 4 + static_cast<qsizetype>(wire.MaxFrameBytes))
+    {
+      buffer.reserve(pending);
     }
+    return ok;
   }
 } // namespace ParaViewMCP
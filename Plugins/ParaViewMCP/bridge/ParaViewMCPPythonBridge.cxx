@@ -2,6 +2,7 @@
 
 #include "ParaViewMCPPythonBridge.h"
 
+#include "ParaViewMCPProtocol.h"
 #include "pqPVApplicationCore.h"
 #include "pqPythonManager.h"
 #include "vtkPythonInterpreter.h"
@@ -115,6 +116,7 @@ void ParaViewMCPPythonBridge::shutdown()
   {
     this->Ready = false;
     this->Module = nullptr;
+    this->CancelledType = nullptr;
     this->Functions.clear();
     return;
   }
@@ -130,6 +132,36 @@ bool ParaViewMCPPythonBridge::isReady() const
   return this->Ready;
 }
 
+bool ParaViewMCPPythonBridge::selectSession(quint64 sessionId, QString* error)
+{
+  if (!this->initialize(error))
+  {
+    return false;
+  }
+
+  PyGILState_STATE gilState = PyGILState_Ensure();
+  PyObject* args = Py_BuildValue("(K)", static_cast<unsigned long long>(sessionId));
+  QJsonObject ignored;
+  const bool ok = this->callFunction(QStringLiteral("select_session"), args, &ignored, error);
+  PyGILState_Release(gilState);
+  return ok;
+}
+
+bool ParaViewMCPPythonBridge::closeSession(quint64 sessionId, QString* error)
+{
+  if (!this->initialize(error))
+  {
+    return false;
+  }
+
+  PyGILState_STATE gilState = PyGILState_Ensure();
+  PyObject* args = Py_BuildValue("(K)", static_cast<unsigned long long>(sessionId));
+  QJsonObject ignored;
+  const bool ok = this->callFunction(QStringLiteral("close_session"), args, &ignored, error);
+  PyGILState_Release(gilState);
+  return ok;
+}
+
 bool ParaViewMCPPythonBridge::resetSession(QString* error)
 {
   if (!this->initialize(error))
@@ -154,23 +186,77 @@ bool ParaViewMCPPythonBridge::executePython(const QString& code,
     return false;
   }
 
+  const qint64 gilRequestedNs = ParaViewMCP::monotonicNs();
   PyGILState_STATE gilState = PyGILState_Ensure();
+  this->addTiming(QStringLiteral("gil_ms"), gilRequestedNs);
+  // A cancel that came too late for the previous script must not stop this one.
+  if (PyObject_SetAttrString(this->Module, "_CANCEL_REQUESTED", Py_False) != 0)
+  {
+    PyErr_Clear();
+  }
+  this->RunningExecution.store(++this->LastExecution);
   PyObject* args = Py_BuildValue("(s)", code.toUtf8().constData());
   const bool ok = this->callFunction(QStringLiteral("execute_python"), args, result, error);
+  this->RunningExecution.store(0);
   PyGILState_Release(gilState);
   return ok;
 }
 
-bool ParaViewMCPPythonBridge::inspectPipeline(QJsonObject* result, QString* error)
+bool ParaViewMCPPythonBridge::interrupt()
+{
+  const quint64 execution = this->RunningExecution.load();
+  if (execution == 0)
+  {
+    return false;
+  }
+  this->CancelledExecution.store(execution);
+  // Runs on the interpreter's main thread (ParaView's GUI thread) at the next
+  // bytecode boundary, so a script blocked inside a VTK filter stops only
+  // once that filter returns.
+  return Py_AddPendingCall(&ParaViewMCPPythonBridge::raiseCancelled, this) == 0;
+}
+
+int ParaViewMCPPythonBridge::raiseCancelled(void* bridge)
+{
+  auto* self = static_cast<ParaViewMCPPythonBridge*>(bridge);
+  const quint64 execution = self->RunningExecution.load();
+  PyObject* callable = self->Functions.value(QStringLiteral("cancel_requested"), nullptr);
+  if (execution == 0 || execution != self->CancelledExecution.load() ||
+      self->CancelledType == nullptr || callable == nullptr)
+  {
+    return 0;
+  }
+
+  // Only the script itself is stopped. Outside it the helper keeps the
+  // request for a script that has yet to start, or drops it for one that has
+  // finished, so its history entry and cache invalidation always complete.
+  PyObject* value = PyObject_CallObject(callable, nullptr);
+  const bool raiseNow = value != nullptr && PyObject_IsTrue(value) == 1;
+  Py_XDECREF(value);
+  if (!raiseNow)
+  {
+    PyErr_Clear();
+    return 0;
+  }
+  PyErr_SetString(self->CancelledType, "Execution was cancelled by the client");
+  return -1;
+}
+
+bool ParaViewMCPPythonBridge::inspectPipeline(const QString& ifVersion,
+                                              QByteArray* resultJson,
+                                              QString* error)
 {
   if (!this->initialize(error))
   {
     return false;
   }
 
+  const qint64 gilRequestedNs = ParaViewMCP::monotonicNs();
   PyGILState_STATE gilState = PyGILState_Ensure();
-  PyObject* args = PyTuple_New(0);
-  const bool ok = this->callFunction(QStringLiteral("inspect_pipeline"), args, result, error);
+  this->addTiming(QStringLiteral("gil_ms"), gilRequestedNs);
+  PyObject* args = Py_BuildValue("(s)", ifVersion.toUtf8().constData());
+  const bool ok =
+    this->callFunction(QStringLiteral("inspect_pipeline"), args, resultJson, error);
   PyGILState_Release(gilState);
   return ok;
 }
@@ -185,13 +271,80 @@ bool ParaViewMCPPythonBridge::captureScreenshot(int width,
     return false;
   }
 
+  const qint64 gilRequestedNs = ParaViewMCP::monotonicNs();
   PyGILState_STATE gilState = PyGILState_Ensure();
+  this->addTiming(QStringLiteral("gil_ms"), gilRequestedNs);
   PyObject* args = Py_BuildValue("(ii)", width, height);
   const bool ok = this->callFunction(QStringLiteral("capture_screenshot"), args, result, error);
   PyGILState_Release(gilState);
   return ok;
 }
 
+bool ParaViewMCPPythonBridge::captureScreenshotBinary(
+  int width, int height, QJsonObject* result, QByteArray* imageData, QString* error)
+{
+  if (!this->initialize(error))
+  {
+    return false;
+  }
+
+  const qint64 gilRequestedNs = ParaViewMCP::monotonicNs();
+  PyGILState_STATE gilState = PyGILState_Ensure();
+  this->addTiming(QStringLiteral("gil_ms"), gilRequestedNs);
+
+  PyObject* callable = this->Functions.value(QStringLiteral("capture_screenshot"), nullptr);
+  if (callable == nullptr)
+  {
+    if (error)
+    {
+      *error = QStringLiteral("Requested Python helper is not available");
+    }
+    PyGILState_Release(gilState);
+    return false;
+  }
+
+  // With binary=True the helper returns (json_string, png_bytes) so the image
+  // never passes through base64 or the JSON parser.
+  PyObject* args = Py_BuildValue("(iiO)", width, height, Py_True);
+  const qint64 callStartedNs = ParaViewMCP::monotonicNs();
+  PyObject* value = PyObject_CallObject(callable, args);
+  Py_XDECREF(args);
+  this->addTiming(QStringLiteral("call_ms"), callStartedNs);
+  if (value == nullptr)
+  {
+    if (error)
+    {
+      *error = this->fetchPythonError();
+    }
+    this->collectHelperTimings();
+    PyGILState_Release(gilState);
+    return false;
+  }
+
+  const qint64 convertStartedNs = ParaViewMCP::monotonicNs();
+  bool ok = false;
+  if (PyTuple_Check(value) && PyTuple_GET_SIZE(value) == 2 &&
+      PyBytes_Check(PyTuple_GET_ITEM(value, 1)))
+  {
+    ok = this->parseJsonResult(PyTuple_GET_ITEM(value, 0), result, error);
+    if (ok && imageData != nullptr)
+    {
+      PyObject* bytes = PyTuple_GET_ITEM(value, 1);
+      *imageData = QByteArray(PyBytes_AS_STRING(bytes), PyBytes_GET_SIZE(bytes));
+    }
+  }
+  else if (error)
+  {
+    *error = QStringLiteral("capture_screenshot did not return a (json, bytes) tuple");
+  }
+
+  Py_DECREF(value);
+  this->addTiming(QStringLiteral("convert_ms"), convertStartedNs);
+  this->collectHelperTimings();
+  PyGILState_Release(gilState);
+  return ok;
+}
+
 bool ParaViewMCPPythonBridge::getHistory(QJsonArray* result, QString* error)
 {
   if (!this->initialize(error))
@@ -199,7 +352,9 @@ bool ParaViewMCPPythonBridge::getHistory(QJsonArray* result, QString* error)
     return false;
   }
 
+  const qint64 gilRequestedNs = ParaViewMCP::monotonicNs();
   PyGILState_STATE gilState = PyGILState_Ensure();
+  this->addTiming(QStringLiteral("gil_ms"), gilRequestedNs);
 
   PyObject* callable = this->Functions.value(QStringLiteral("get_history"), nullptr);
   if (callable == nullptr)
@@ -267,6 +422,22 @@ bool ParaViewMCPPythonBridge::getHistory(QJsonArray* result, QString* error)
   return true;
 }
 
+bool ParaViewMCPPythonBridge::historyDelta(QJsonObject* result, QString* error)
+{
+  if (!this->initialize(error))
+  {
+    return false;
+  }
+
+  const qint64 gilRequestedNs = ParaViewMCP::monotonicNs();
+  PyGILState_STATE gilState = PyGILState_Ensure();
+  this->addTiming(QStringLiteral("gil_ms"), gilRequestedNs);
+  const bool ok =
+    this->callFunction(QStringLiteral("history_delta"), PyTuple_New(0), result, error);
+  PyGILState_Release(gilState);
+  return ok;
+}
+
 bool ParaViewMCPPythonBridge::restoreSnapshot(int entryId, QJsonObject* result, QString* error)
 {
   if (!this->initialize(error))
@@ -274,13 +445,96 @@ bool ParaViewMCPPythonBridge::restoreSnapshot(int entryId, QJsonObject* result,
     return false;
   }
 
+  const qint64 gilRequestedNs = ParaViewMCP::monotonicNs();
   PyGILState_STATE gilState = PyGILState_Ensure();
+  this->addTiming(QStringLiteral("gil_ms"), gilRequestedNs);
   PyObject* args = Py_BuildValue("(i)", entryId);
   const bool ok = this->callFunction(QStringLiteral("restore_snapshot"), args, result, error);
   PyGILState_Release(gilState);
   return ok;
 }
 
+bool ParaViewMCPPythonBridge::setRendersDeferred(bool deferred, QString* error)
+{
+  if (!this->initialize(error))
+  {
+    return false;
+  }
+
+  const qint64 gilRequestedNs = ParaViewMCP::monotonicNs();
+  PyGILState_STATE gilState = PyGILState_Ensure();
+  this->addTiming(QStringLiteral("gil_ms"), gilRequestedNs);
+  PyObject* args = Py_BuildValue("(O)", deferred ? Py_True : Py_False);
+  QJsonObject ignored;
+  const bool ok = this->callFunction(QStringLiteral("defer_renders"), args, &ignored, error);
+  PyGILState_Release(gilState);
+  return ok;
+}
+
+void ParaViewMCPPythonBridge::setTimingsEnabled(bool enabled)
+{
+  this->TimingsEnabled = enabled;
+  if (!enabled)
+  {
+    this->Timings.clear();
+  }
+}
+
+QJsonObject ParaViewMCPPythonBridge::takeTimings()
+{
+  QJsonObject timings;
+  for (auto it = this->Timings.constBegin(); it != this->Timings.constEnd(); ++it)
+  {
+    timings.insert(it.key(), ParaViewMCP::timingMs(it.value()));
+  }
+  this->Timings.clear();
+  return timings;
+}
+
+void ParaViewMCPPythonBridge::addTiming(const QString& phase, qint64 startedNs)
+{
+  if (this->TimingsEnabled)
+  {
+    this->Timings[phase] += ParaViewMCP::monotonicNs() - startedNs;
+  }
+}
+
+// Adds the phases the helper measured during the call that just returned.
+// Called with the GIL held.
+void ParaViewMCPPythonBridge::collectHelperTimings()
+{
+  PyObject* callable = this->Functions.value(QStringLiteral("take_timings"), nullptr);
+  if (!this->TimingsEnabled || callable == nullptr)
+  {
+    return;
+  }
+
+  // Keep a failed call's exception out of the way of take_timings().
+  PyObject* type = nullptr;
+  PyObject* value = nullptr;
+  PyObject* traceback = nullptr;
+  PyErr_Fetch(&type, &value, &traceback);
+  PyObject* args = PyTuple_New(0);
+  PyObject* text = PyObject_CallObject(callable, args);
+  Py_XDECREF(args);
+  QByteArray json;
+  QJsonObject phases;
+  if (text == nullptr)
+  {
+    PyErr_Clear();
+  }
+  else if (this->readJsonText(text, &json, nullptr) &&
+           ParaViewMCPPythonBridge::parseJsonObject(json, &phases, nullptr))
+  {
+    for (auto it = phases.constBegin(); it != phases.constEnd(); ++it)
+    {
+      this->Timings[it.key()] += static_cast<qint64>(it.value().toDouble() * 1.0e6);
+    }
+  }
+  Py_XDECREF(text);
+  PyErr_Restore(type, value, traceback);
+}
+
 bool ParaViewMCPPythonBridge::importModule(QString* error)
 {
   if (this->Module != nullptr)
@@ -317,12 +571,18 @@ bool ParaViewMCPPythonBridge::cacheFunctions(QString* error)
 {
   static const char* functionNames[] = {
     "bootstrap",
+    "select_session",
+    "close_session",
     "reset_session",
     "execute_python",
+    "cancel_requested",
     "inspect_pipeline",
     "capture_screenshot",
     "get_history",
+    "history_delta",
     "restore_snapshot",
+    "defer_renders",
+    "take_timings",
   };
 
   for (const char* functionName : functionNames)
@@ -347,6 +607,19 @@ bool ParaViewMCPPythonBridge::cacheFunctions(QString* error)
     this->Functions.insert(key, callable);
   }
 
+  if (this->CancelledType == nullptr)
+  {
+    this->CancelledType = PyObject_GetAttrString(this->Module, "ExecutionCancelled");
+    if (this->CancelledType == nullptr)
+    {
+      if (error)
+      {
+        *error = this->fetchPythonError();
+      }
+      return false;
+    }
+  }
+
   return true;
 }
 
@@ -365,6 +638,22 @@ bool ParaViewMCPPythonBridge::callFunction(const QString& functionName,
     return false;
   }
 
+  QByteArray json;
+  if (!this->callFunction(functionName, args, &json, error))
+  {
+    return false;
+  }
+  const qint64 parseStartedNs = ParaViewMCP::monotonicNs();
+  const bool ok = ParaViewMCPPythonBridge::parseJsonObject(json, result, error);
+  this->addTiming(QStringLiteral("convert_ms"), parseStartedNs);
+  return ok;
+}
+
+bool ParaViewMCPPythonBridge::callFunction(const QString& functionName,
+                                           PyObject* args,
+                                           QByteArray* resultJson,
+                                           QString* error)
+{
   PyObject* callable = this->Functions.value(functionName, nullptr);
   if (callable == nullptr)
   {
@@ -376,23 +665,29 @@ bool ParaViewMCPPythonBridge::callFunction(const QString& functionName,
     return false;
   }
 
+  const qint64 callStartedNs = ParaViewMCP::monotonicNs();
   PyObject* value = PyObject_CallObject(callable, args);
   Py_XDECREF(args);
+  this->addTiming(QStringLiteral("call_ms"), callStartedNs);
   if (value == nullptr)
   {
     if (error)
     {
       *error = this->fetchPythonError();
     }
+    this->collectHelperTimings();
     return false;
   }
 
-  const bool ok = this->parseJsonResult(value, result, error);
+  const qint64 readStartedNs = ParaViewMCP::monotonicNs();
+  const bool ok = this->readJsonText(value, resultJson, error);
   Py_DECREF(value);
+  this->addTiming(QStringLiteral("convert_ms"), readStartedNs);
+  this->collectHelperTimings();
   return ok;
 }
 
-bool ParaViewMCPPythonBridge::parseJsonResult(PyObject* value, QJsonObject* result, QString* error)
+bool ParaViewMCPPythonBridge::readJsonText(PyObject* value, QByteArray* json, QString* error)
 {
   if (!PyUnicode_Check(value))
   {
@@ -403,7 +698,8 @@ bool ParaViewMCPPythonBridge::parseJsonResult(PyObject* value, QJsonObject* resu
     return false;
   }
 
-  const char* utf8 = PyUnicode_AsUTF8(value);
+  Py_ssize_t size = 0;
+  const char* utf8 = PyUnicode_AsUTF8AndSize(value, &size);
   if (utf8 == nullptr)
   {
     if (error)
@@ -413,8 +709,35 @@ bool ParaViewMCPPythonBridge::parseJsonResult(PyObject* value, QJsonObject* resu
     return false;
   }
 
+  // Raw results are spliced into responses unparsed, so at least make sure
+  // the text is shaped like a JSON object.
+  const QByteArray text = QByteArray(utf8, static_cast<qsizetype>(size)).trimmed();
+  if (!text.startsWith('{') || !text.endsWith('}'))
+  {
+    if (error)
+    {
+      *error = QStringLiteral("Python helper returned invalid JSON");
+    }
+    return false;
+  }
+
+  *json = text;
+  return true;
+}
+
+bool ParaViewMCPPythonBridge::parseJsonResult(PyObject* value, QJsonObject* result, QString* error)
+{
+  QByteArray json;
+  return this->readJsonText(value, &json, error) &&
+         ParaViewMCPPythonBridge::parseJsonObject(json, result, error);
+}
+
+bool ParaViewMCPPythonBridge::parseJsonObject(const QByteArray& json,
+                                              QJsonObject* result,
+                                              QString* error)
+{
   QJsonParseError parseError;
-  const QJsonDocument document = QJsonDocument::fromJson(QByteArray(utf8), &parseError);
+  const QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
   if (parseError.error != QJsonParseError::NoError || !document.isObject())
   {
     if (error)
@@ -460,6 +783,8 @@ void ParaViewMCPPythonBridge::clearPythonObjects()
   }
   this->Functions.clear();
 
+  Py_XDECREF(this->CancelledType);
+  this->CancelledType = nullptr;
   Py_XDECREF(this->Module);
   this->Module = nullptr;
 }
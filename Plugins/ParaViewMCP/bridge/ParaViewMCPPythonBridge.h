@@ -4,6 +4,8 @@
 
 #include <QHash>
 
+#include <atomic>
+
 struct _object;
 using PyObject = _object;
 
@@ -17,24 +19,58 @@ public:
   void shutdown() override;
 
   [[nodiscard]] bool isReady() const override;
+  bool selectSession(quint64 sessionId, QString* error = nullptr) override;
+  bool closeSession(quint64 sessionId, QString* error = nullptr) override;
   bool resetSession(QString* error = nullptr) override;
   bool executePython(const QString& code, QJsonObject* result, QString* error = nullptr) override;
-  bool inspectPipeline(QJsonObject* result, QString* error = nullptr) override;
+  bool interrupt() override;
+  bool inspectPipeline(const QString& ifVersion,
+                       QByteArray* resultJson,
+                       QString* error = nullptr) override;
   bool
   captureScreenshot(int width, int height, QJsonObject* result, QString* error = nullptr) override;
+  bool captureScreenshotBinary(int width,
+                               int height,
+                               QJsonObject* result,
+                               QByteArray* imageData,
+                               QString* error = nullptr) override;
   bool getHistory(QJsonArray* result, QString* error = nullptr) override;
+  bool historyDelta(QJsonObject* result, QString* error = nullptr) override;
   bool restoreSnapshot(int entryId, QJsonObject* result, QString* error = nullptr) override;
+  bool setRendersDeferred(bool deferred, QString* error = nullptr) override;
+  void setTimingsEnabled(bool enabled) override;
+  QJsonObject takeTimings() override;
 
 private:
   bool importModule(QString* error);
   bool cacheFunctions(QString* error);
   bool
   callFunction(const QString& functionName, PyObject* args, QJsonObject* result, QString* error);
+  bool callFunction(const QString& functionName,
+                    PyObject* args,
+                    QByteArray* resultJson,
+                    QString* error);
   bool parseJsonResult(PyObject* value, QJsonObject* result, QString* error);
+  bool readJsonText(PyObject* value, QByteArray* json, QString* error);
+  static bool parseJsonObject(const QByteArray& json, QJsonObject* result, QString* error);
   QString fetchPythonError() const;
+  // Adds the time since startedNs to phase while timings are enabled.
+  void addTiming(const QString& phase, qint64 startedNs);
+  void collectHelperTimings();
   void clearPythonObjects();
+  static int raiseCancelled(void* bridge);
 
   bool Ready = false;
   PyObject* Module = nullptr;
   QHash<QString, PyObject*> Functions;
+  // paraview_mcp_bridge.ExecutionCancelled, raised into a cancelled script.
+  PyObject* CancelledType = nullptr;
+  // Each executePython() call gets a new id. interrupt() reads the running
+  // one from another thread, so a cancel that arrives as a script finishes
+  // can never stop the next one or code outside the bridge.
+  quint64 LastExecution = 0;
+  std::atomic<quint64> RunningExecution{0};
+  std::atomic<quint64> CancelledExecution{0};
+  bool TimingsEnabled = false;
+  QHash<QString, qint64> Timings;
 };
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <QByteArray>
+#include <QIODevice>
+
+// Receive buffer with a read cursor. Consumed bytes are only reclaimed once
+// they make up at least half of the storage, so extracting N pipelined frames
+// costs O(N) copying instead of one memmove of the remaining bytes per frame.
+class ParaViewMCPReadBuffer
+{
+public:
+  [[nodiscard]] qsizetype size() const
+  {
+    return this->Data.size() - this->ReadOffset;
+  }
+
+  [[nodiscard]] bool isEmpty() const
+  {
+    return this->size() == 0;
+  }
+
+  [[nodiscard]] const char* constData() const
+  {
+    return this->Data.constData() + this->ReadOffset;
+  }
+
+  void append(const QByteArray& bytes)
+  {
+    this->compact();
+    this->Data.append(bytes);
+  }
+
+  // Reads everything currently available from the device straight into the
+  // buffer, avoiding the temporary QByteArray that readAll() would allocate.
+  qint64 readFrom(QIODevice* device)
+  {
+    if (device == nullptr)
+    {
+      return 0;
+    }
+
+    const qint64 available = device->bytesAvailable();
+    if (available <= 0)
+    {
+      return 0;
+    }
+
+    this->compact();
+    const qsizetype oldSize = this->Data.size();
+    this->Data.resize(oldSize + static_cast<qsizetype>(available));
+    const qint64 bytesRead = device->read(this->Data.data() + oldSize, available);
+    this->Data.resize(oldSize + static_cast<qsizetype>(qMax<qint64>(bytesRead, 0)));
+    return bytesRead;
+  }
+
+  // Ensures the unread bytes can grow to length without reallocating, so a
+  // large frame announced by its header arrives in one allocation instead of
+  // one growth step per read. Only the unread bytes move to the new storage.
+  void reserve(qsizetype length)
+  {
+    if (this->capacity() >= length)
+    {
+      return;
+    }
+    QByteArray storage;
+    storage.reserve(length);
+    storage.append(this->constData(), this->size());
+    this->Data.swap(storage);
+    this->ReadOffset = 0;
+  }
+
+  void consume(qsizetype length)
+  {
+    this->ReadOffset += qMin(length, this->size());
+    if (this->ReadOffset == this->Data.size())
+    {
+      // Storage reserved for one large frame is released once it has been
+      // consumed instead of staying pinned for the rest of the connection.
+      if (this->Data.capacity() > RetainedCapacity)
+      {
+        this->Data.clear();
+      }
+      else
+      {
+        this->Data.truncate(0);
+      }
+      this->ReadOffset = 0;
+    }
+  }
+
+  [[nodiscard]] qsizetype capacity() const
+  {
+    return this->Data.capacity() - this->ReadOffset;
+  }
+
+  void clear()
+  {
+    this->Data.clear();
+    this->ReadOffset = 0;
+  }
+
+private:
+  void compact()
+  {
+    if (this->ReadOffset == 0 || this->ReadOffset < this->Data.size() / 2)
+    {
+      return;
+    }
+    this->Data.remove(0, this->ReadOffset);
+    this->ReadOffset = 0;
+  }
+
+  static constexpr qsizetype RetainedCapacity = 1024 * 1024;
+
+  QByteArray Data;
+  qsizetype ReadOffset = 0;
+};
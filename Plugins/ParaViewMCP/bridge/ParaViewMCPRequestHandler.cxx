@@ -15,13 +15,106 @@ namespace
   constexpr const char* PluginVersion = PARAVIEW_MCP_PLUGIN_VERSION;
 } // namespace
 
+QJsonObject ParaViewMCPRequestHandler::Result::message() const
+{
+  if (this->RawResult.isEmpty())
+  {
+    return this->Response;
+  }
+
+  QJsonObject message = this->Response;
+  message.insert(QStringLiteral("result"), QJsonDocument::fromJson(this->RawResult).object());
+  return message;
+}
+
 ParaViewMCPRequestHandler::ParaViewMCPRequestHandler(IParaViewMCPPythonBridge& pythonBridge)
     : PythonBridge(pythonBridge)
 {
+  this->registerBuiltinCommands();
+}
+
+void ParaViewMCPRequestHandler::registerCommand(const QString& name, const Command& command)
+{
+  if (!this->Commands.contains(name))
+  {
+    this->CommandNames.append(name);
+  }
+  this->Commands.insert(name, command);
+}
+
+const ParaViewMCPRequestHandler::Command*
+ParaViewMCPRequestHandler::command(const QString& name) const
+{
+  const auto found = this->Commands.constFind(name);
+  return found != this->Commands.constEnd() ? &found.value() : nullptr;
+}
+
+QStringList ParaViewMCPRequestHandler::commandNames() const
+{
+  return this->CommandNames;
+}
+
+void ParaViewMCPRequestHandler::registerBuiltinCommands()
+{
+  Command ping;
+  ping.Run = [](const Request& request)
+  { return ParaViewMCPRequestHandler::pingResult(request.RequestId); };
+  this->registerCommand(QStringLiteral("ping"), ping);
+
+  Command executePython;
+  executePython.Validate = [](const QJsonObject& params)
+  {
+    return params.value(QStringLiteral("code")).toString().isEmpty()
+             ? QStringLiteral("execute_python requires a non-empty 'code' string")
+             : QString();
+  };
+  executePython.Run = [this](const Request& request) { return this->executePython(request); };
+  executePython.RefreshesHistory = true;
+  this->registerCommand(QStringLiteral("execute_python"), executePython);
+
+  Command inspectPipeline;
+  inspectPipeline.Run = [this](const Request& request) { return this->inspectPipeline(request); };
+  inspectPipeline.RefreshesHistory = true;
+  this->registerCommand(QStringLiteral("inspect_pipeline"), inspectPipeline);
+
+  Command captureScreenshot;
+  captureScreenshot.Run = [this](const Request& request)
+  { return this->captureScreenshot(request); };
+  captureScreenshot.RefreshesHistory = true;
+  this->registerCommand(QStringLiteral("capture_screenshot"), captureScreenshot);
+
+  Command getHistory;
+  getHistory.Run = [this](const Request& request) { return this->getHistory(request); };
+  // Asking for the history also brings the dock panel up to date.
+  getHistory.RefreshesHistory = true;
+  this->registerCommand(QStringLiteral("get_history"), getHistory);
+
+  Command restoreSnapshot;
+  restoreSnapshot.Validate = [](const QJsonObject& params)
+  {
+    return params.value(QStringLiteral("entry_id")).toInt(-1) < 1
+             ? QStringLiteral("restore_snapshot requires a positive 'entry_id' integer")
+             : QString();
+  };
+  restoreSnapshot.Run = [this](const Request& request) { return this->restoreSnapshot(request); };
+  restoreSnapshot.RefreshesHistory = true;
+  this->registerCommand(QStringLiteral("restore_snapshot"), restoreSnapshot);
+
+  // Runs the commands it carries one after another in a single GUI-thread
+  // turn, with one history refresh at the end instead of one per command.
+  Command batch;
+  batch.Validate = [this](const QJsonObject& params) { return this->validateBatch(params); };
+  batch.Run = [this](const Request& request) { return this->runBatch(request); };
+  batch.RefreshesHistory = true;
+  this->registerCommand(QStringLiteral("batch"), batch);
 }
 
-ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::handleMessage(
-  const QJsonObject& message, bool handshakeComplete, const QString& authToken)
+ParaViewMCPRequestHandler::Result
+ParaViewMCPRequestHandler::handleMessage(const QJsonObject& message,
+                                         bool handshakeComplete,
+                                         const QString& authToken,
+                                         const ParaViewMCP::WireOptions& wire,
+                                         bool resumeSession)
 {
   const QString type = message.value(QStringLiteral("type")).toString();
   if (!handshakeComplete)
@@ -30,12 +123,41 @@ ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::handleMessage(
     {
       return ParaViewMCPRequestHandler::protocolError(
         QStringLiteral("HANDSHAKE_REQUIRED"),
-        QStringLiteral("The first request on a new connection must be 'hello'"));
+        QStringLiteral("The first request on a new connection must be 'hello'"),
+        message.value(QStringLiteral("request_id")).toString());
     }
-    return this->handleHello(message, authToken);
+    return this->handleHello(message, authToken, wire, resumeSession);
   }
 
-  return this->handleCommand(message);
+  return this->handleCommand(message, wire);
+}
+
+ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::pingResult(const QString& requestId)
+{
+  return ParaViewMCPRequestHandler::success(requestId, QJsonObject{{"ok", true}});
+}
+
+ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::cancelResult(
+  const QString& requestId, const QString& targetId, bool cancelled)
+{
+  return ParaViewMCPRequestHandler::success(requestId,
+                                            QJsonObject{
+                                              {"request_id", targetId},
+                                              {"cancelled", cancelled},
+                                            });
+}
+
+ParaViewMCPRequestHandler::Result
+ParaViewMCPRequestHandler::cancelledResult(const QString& requestId)
+{
+  return ParaViewMCPRequestHandler::error(
+    requestId, QStringLiteral("CANCELLED"), QStringLiteral("The request was cancelled"));
+}
+
+ParaViewMCPRequestHandler::Result
+ParaViewMCPRequestHandler::statusResult(const QString& requestId, const QJsonObject& status)
+{
+  return ParaViewMCPRequestHandler::success(requestId, status);
 }
 
 ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::busyResult()
@@ -45,17 +167,37 @@ ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::busyResult()
                                           QStringLiteral("Another client is already connected"));
 }
 
-ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::protocolError(const QString& code,
-                                                                           const QString& message)
+ParaViewMCPRequestHandler::Result
+ParaViewMCPRequestHandler::responseTooLarge(const QString& requestId)
+{
+  return ParaViewMCPRequestHandler::error(
+    requestId,
+    QStringLiteral("RESPONSE_TOO_LARGE"),
+    QStringLiteral("The response exceeds the maximum frame size for this connection"));
+}
+
+ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::protocolError(
+  const QString& code, const QString& message, const QString& requestId)
 {
-  Result result = ParaViewMCPRequestHandler::error(QString(), code, message);
+  Result result = ParaViewMCPRequestHandler::error(requestId, code, message);
   result.CloseConnection = true;
   result.ResetSession = true;
   return result;
 }
 
-ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::handleHello(const QJsonObject& message,
-                                                                         const QString& authToken)
+void ParaViewMCPRequestHandler::addResumeToken(Result& result, const QString& token, bool resumed)
+{
+  QJsonObject body = result.Response.value(QStringLiteral("result")).toObject();
+  body.insert(QStringLiteral("resume_token"), token);
+  body.insert(QStringLiteral("resumed"), resumed);
+  result.Response.insert(QStringLiteral("result"), body);
+}
+
+ParaViewMCPRequestHandler::Result
+ParaViewMCPRequestHandler::handleHello(const QJsonObject& message,
+                                       const QString& authToken,
+                                       const ParaViewMCP::WireOptions& currentWire,
+                                       bool resumeSession)
 {
   const QString requestId = message.value(QStringLiteral("request_id")).toString();
   const int protocolVersion = message.value(QStringLiteral("protocol_version")).toInt(-1);
@@ -88,7 +230,11 @@ ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::handleHello(const Q
   QString pythonError;
   bool pythonReady = this->PythonBridge.initialize(&pythonError);
   QString logMessage;
-  if (pythonReady)
+  if (!pythonReady)
+  {
+    logMessage = pythonError;
+  }
+  else if (!resumeSession)
   {
     QString resetError;
     if (!this->PythonBridge.resetSession(&resetError))
@@ -97,152 +243,351 @@ ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::handleHello(const Q
       logMessage = resetError;
     }
   }
-  else
+
+  // Framing extensions are opt-in: the client lists the ones it understands in
+  // its own 'capabilities' and the reply echoes the subset that is enabled.
+  const QJsonArray requested = message.value(QStringLiteral("capabilities")).toArray();
+  ParaViewMCP::WireOptions wire;
+  QJsonArray capabilities = QJsonArray::fromStringList(this->CommandNames);
+  // Answered by the network thread, so never registered here.
+  capabilities.append(QStringLiteral("cancel"));
+  capabilities.append(QStringLiteral("status"));
+  if (requested.contains(ParaViewMCP::binaryAttachmentsCapability()))
   {
-    logMessage = pythonError;
+    wire.BinaryAttachments = true;
+    capabilities.append(ParaViewMCP::binaryAttachmentsCapability());
+  }
+  if (requested.contains(ParaViewMCP::chunkedFramesCapability()))
+  {
+    wire.ChunkedFrames = true;
+    capabilities.append(ParaViewMCP::chunkedFramesCapability());
+  }
+  if (requested.contains(ParaViewMCP::cborCapability()))
+  {
+    wire.Cbor = true;
+    capabilities.append(ParaViewMCP::cborCapability());
   }
+  if (requested.contains(ParaViewMCP::heartbeatCapability()))
+  {
+    wire.Heartbeat = true;
+    capabilities.append(ParaViewMCP::heartbeatCapability());
+  }
+  if (requested.contains(ParaViewMCP::timingsCapability()))
+  {
+    wire.Timings = true;
+    capabilities.append(ParaViewMCP::timingsCapability());
+  }
+  // Only agreed to here; the bridge owns the region and announces it in the
+  // reply once it is mapped.
+  wire.SharedMemory = currentWire.SharedMemory &&
+                      requested.contains(ParaViewMCP::sharedMemoryCapability());
+
+  // The client names the largest frame it accepts; both directions then use
+  // the smaller of that and the configured ceiling the session started with.
+  // Clients that do not ask keep the protocol default.
+  const double requestedFrameBytes =
+    qBound(0.0,
+           message.value(QStringLiteral("max_frame_bytes"))
+             .toDouble(static_cast<double>(ParaViewMCP::MaxFrameBytes)),
+           static_cast<double>(ParaViewMCP::FrameLengthMask));
+  wire.MaxFrameBytes = qMin(ParaViewMCP::clampFrameBytes(static_cast<qint64>(requestedFrameBytes)),
+                            currentWire.MaxFrameBytes);
+
+  QJsonObject response{
+    {"protocol_version", ParaViewMCP::ProtocolVersion},
+    {"plugin_version", QString::fromLatin1(PluginVersion)},
+    {"python_ready", pythonReady},
+    {"capabilities", capabilities},
+    {"max_frame_bytes", static_cast<qint64>(wire.MaxFrameBytes)},
+  };
 
-  Result result =
-    ParaViewMCPRequestHandler::success(requestId,
-                                       QJsonObject{
-                                         {"protocol_version", ParaViewMCP::ProtocolVersion},
-                                         {"plugin_version", QString::fromLatin1(PluginVersion)},
-                                         {"python_ready", pythonReady},
-                                         {"capabilities",
-                                          QJsonArray{
-                                            QStringLiteral("ping"),
-                                            QStringLiteral("execute_python"),
-                                            QStringLiteral("inspect_pipeline"),
-                                            QStringLiteral("capture_screenshot"),
-                                          }},
-                                       });
+  // Compression is offered as a list of codecs plus the smallest payload the
+  // client wants compressed; only payloads sent after the reply are affected.
+  const QJsonObject compression = message.value(QStringLiteral("compression")).toObject();
+  const QJsonArray codecs = compression.value(QStringLiteral("codecs")).toArray();
+  if (codecs.contains(ParaViewMCP::zlibCodecName()))
+  {
+    const int threshold = compression.value(QStringLiteral("threshold"))
+                            .toInt(ParaViewMCP::DefaultCompressionThreshold);
+    wire.Compression = true;
+    wire.CompressionThreshold = qMax(0, threshold);
+    response.insert(QStringLiteral("compression"),
+                    QJsonObject{
+                      {"codec", ParaViewMCP::zlibCodecName()},
+                      {"threshold", wire.CompressionThreshold},
+                    });
+  }
+
+  Result result = ParaViewMCPRequestHandler::success(requestId, response);
   result.HandshakeCompleted = true;
+  result.NegotiatedWire = wire;
   result.LogMessage = logMessage;
   return result;
 }
 
 ParaViewMCPRequestHandler::Result
-ParaViewMCPRequestHandler::handleCommand(const QJsonObject& message)
+ParaViewMCPRequestHandler::handleCommand(const QJsonObject& message,
+                                         const ParaViewMCP::WireOptions& wire)
 {
-  const QString requestId = message.value(QStringLiteral("request_id")).toString();
-  const QString type = message.value(QStringLiteral("type")).toString();
-  const QJsonObject params = message.value(QStringLiteral("params")).toObject();
+  Request request;
+  request.RequestId = message.value(QStringLiteral("request_id")).toString();
+  request.Params = message.value(QStringLiteral("params")).toObject();
+  request.Wire = wire;
 
-  if (type == QStringLiteral("ping"))
+  const Command* command = this->command(message.value(QStringLiteral("type")).toString());
+  if (command == nullptr)
   {
-    return ParaViewMCPRequestHandler::success(requestId, QJsonObject{{"ok", true}});
+    return ParaViewMCPRequestHandler::error(
+      request.RequestId,
+      QStringLiteral("UNKNOWN_COMMAND"),
+      QStringLiteral("The requested command is not supported"));
   }
 
-  if (type == QStringLiteral("execute_python"))
+  if (command->Validate)
   {
-    const QString code = params.value(QStringLiteral("code")).toString();
-    if (code.isEmpty())
+    const QString problem = command->Validate(request.Params);
+    if (!problem.isEmpty())
     {
       return ParaViewMCPRequestHandler::error(
-        requestId,
-        QStringLiteral("INVALID_PARAMS"),
-        QStringLiteral("execute_python requires a non-empty 'code' string"));
+        request.RequestId, QStringLiteral("INVALID_PARAMS"), problem);
     }
+  }
 
-    QJsonObject result;
-    QString errorText;
-    if (!this->PythonBridge.executePython(code, &result, &errorText))
-    {
-      return ParaViewMCPRequestHandler::error(
-        requestId,
-        QStringLiteral("PYTHON_BRIDGE_ERROR"),
-        errorText.isEmpty() ? QStringLiteral("Python execution failed") : errorText);
-    }
+  // Commands a batch runs share one breakdown.
+  const qint64 startedNs = ParaViewMCP::monotonicNs();
+  if (wire.Timings)
+  {
+    this->PythonBridge.setTimingsEnabled(true);
+  }
+  Result result = command->Run(request);
+  if (command->RefreshesHistory && !result.HistoryChanged &&
+      result.Response.value(QStringLiteral("status")).toString() == QStringLiteral("success"))
+  {
+    this->attachHistoryDelta(result);
+  }
+  if (wire.Timings)
+  {
+    QJsonObject timings = this->PythonBridge.takeTimings();
+    this->PythonBridge.setTimingsEnabled(false);
+    timings.insert(QStringLiteral("handler_ms"),
+                   ParaViewMCP::timingMs(ParaViewMCP::monotonicNs() - startedNs));
+    result.Response.insert(QStringLiteral("timings"), timings);
+  }
+  return result;
+}
+
+ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::executePython(const Request& request)
+{
+  QJsonObject result;
+  QString errorText;
+  if (!this->PythonBridge.executePython(
+        request.Params.value(QStringLiteral("code")).toString(), &result, &errorText))
+  {
+    return ParaViewMCPRequestHandler::error(
+      request.RequestId,
+      QStringLiteral("PYTHON_BRIDGE_ERROR"),
+      errorText.isEmpty() ? QStringLiteral("Python execution failed") : errorText);
+  }
 
-    Result handlerResult = ParaViewMCPRequestHandler::success(requestId, result);
-    this->attachHistoryJson(handlerResult);
+  // Stopped by a 'cancel' from the client. Output printed before that is
+  // kept, and the attempt still shows up in the history.
+  if (result.value(QStringLiteral("cancelled")).toBool())
+  {
+    Result handlerResult = ParaViewMCPRequestHandler::error(
+      request.RequestId,
+      QStringLiteral("CANCELLED"),
+      QStringLiteral("execute_python was cancelled"),
+      QJsonObject{
+        {"stdout", result.value(QStringLiteral("stdout")).toString()},
+        {"stderr", result.value(QStringLiteral("stderr")).toString()},
+      });
+    this->attachHistoryDelta(handlerResult);
     return handlerResult;
   }
 
-  if (type == QStringLiteral("inspect_pipeline"))
+  return ParaViewMCPRequestHandler::success(request.RequestId, result);
+}
+
+ParaViewMCPRequestHandler::Result
+ParaViewMCPRequestHandler::inspectPipeline(const Request& request)
+{
+  const QString ifVersion = request.Params.value(QStringLiteral("if_version")).toString();
+  QByteArray resultJson;
+  QString errorText;
+  if (!this->PythonBridge.inspectPipeline(ifVersion, &resultJson, &errorText))
   {
-    QJsonObject result;
-    QString errorText;
-    if (!this->PythonBridge.inspectPipeline(&result, &errorText))
-    {
-      return ParaViewMCPRequestHandler::error(
-        requestId,
-        QStringLiteral("PIPELINE_ERROR"),
-        errorText.isEmpty() ? QStringLiteral("Unable to inspect the pipeline") : errorText);
-    }
+    return ParaViewMCPRequestHandler::error(
+      request.RequestId,
+      QStringLiteral("PIPELINE_ERROR"),
+      errorText.isEmpty() ? QStringLiteral("Unable to inspect the pipeline") : errorText);
+  }
+  return ParaViewMCPRequestHandler::successRaw(request.RequestId, resultJson);
+}
 
-    Result handlerResult = ParaViewMCPRequestHandler::success(requestId, result);
-    this->attachHistoryJson(handlerResult);
-    return handlerResult;
+ParaViewMCPRequestHandler::Result
+ParaViewMCPRequestHandler::captureScreenshot(const Request& request)
+{
+  const int width = request.Params.value(QStringLiteral("width")).toInt(1600);
+  const int height = request.Params.value(QStringLiteral("height")).toInt(900);
+  const bool binary = request.Wire.BinaryAttachments;
+  QJsonObject result;
+  QByteArray imageData;
+  QString errorText;
+  const bool captured =
+    binary
+      ? this->PythonBridge.captureScreenshotBinary(width, height, &result, &imageData, &errorText)
+      : this->PythonBridge.captureScreenshot(width, height, &result, &errorText);
+  if (!captured)
+  {
+    return ParaViewMCPRequestHandler::error(
+      request.RequestId,
+      QStringLiteral("SCREENSHOT_ERROR"),
+      errorText.isEmpty() ? QStringLiteral("Unable to capture a screenshot") : errorText);
   }
 
-  if (type == QStringLiteral("capture_screenshot"))
+  Result handlerResult = ParaViewMCPRequestHandler::success(request.RequestId, result);
+  if (binary)
   {
-    const int width = params.value(QStringLiteral("width")).toInt(1600);
-    const int height = params.value(QStringLiteral("height")).toInt(900);
-    QJsonObject result;
-    QString errorText;
-    if (!this->PythonBridge.captureScreenshot(width, height, &result, &errorText))
-    {
-      return ParaViewMCPRequestHandler::error(
-        requestId,
-        QStringLiteral("SCREENSHOT_ERROR"),
-        errorText.isEmpty() ? QStringLiteral("Unable to capture a screenshot") : errorText);
-    }
+    ParaViewMCPRequestHandler::addAttachment(
+      handlerResult, QStringLiteral("image_data"), imageData);
+  }
+  return handlerResult;
+}
 
-    Result handlerResult = ParaViewMCPRequestHandler::success(requestId, result);
-    this->attachHistoryJson(handlerResult);
-    return handlerResult;
+ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::getHistory(const Request& request)
+{
+  QJsonArray historyArray;
+  QString errorText;
+  if (!this->PythonBridge.getHistory(&historyArray, &errorText))
+  {
+    return ParaViewMCPRequestHandler::error(
+      request.RequestId,
+      QStringLiteral("HISTORY_ERROR"),
+      errorText.isEmpty() ? QStringLiteral("Unable to retrieve history") : errorText);
   }
 
-  if (type == QStringLiteral("get_history"))
+  return ParaViewMCPRequestHandler::success(request.RequestId,
+                                            QJsonObject{{"history", historyArray}});
+}
+
+ParaViewMCPRequestHandler::Result
+ParaViewMCPRequestHandler::restoreSnapshot(const Request& request)
+{
+  QJsonObject result;
+  QString errorText;
+  if (!this->PythonBridge.restoreSnapshot(
+        request.Params.value(QStringLiteral("entry_id")).toInt(), &result, &errorText))
   {
-    QJsonArray historyArray;
-    QString errorText;
-    if (!this->PythonBridge.getHistory(&historyArray, &errorText))
-    {
-      return ParaViewMCPRequestHandler::error(
-        requestId,
-        QStringLiteral("HISTORY_ERROR"),
-        errorText.isEmpty() ? QStringLiteral("Unable to retrieve history") : errorText);
-    }
+    return ParaViewMCPRequestHandler::error(
+      request.RequestId,
+      QStringLiteral("RESTORE_ERROR"),
+      errorText.isEmpty() ? QStringLiteral("Unable to restore snapshot") : errorText);
+  }
+  return ParaViewMCPRequestHandler::success(request.RequestId, result);
+}
 
-    Result handlerResult =
-      ParaViewMCPRequestHandler::success(requestId, QJsonObject{{"history", historyArray}});
-    handlerResult.HistoryJson =
-      QString::fromUtf8(QJsonDocument(historyArray).toJson(QJsonDocument::Compact));
-    return handlerResult;
+QString ParaViewMCPRequestHandler::validateBatch(const QJsonObject& params) const
+{
+  const QJsonArray commands = params.value(QStringLiteral("commands")).toArray();
+  if (commands.isEmpty())
+  {
+    return QStringLiteral("batch requires a non-empty 'commands' array");
   }
 
-  if (type == QStringLiteral("restore_snapshot"))
+  // Everything is checked up front, so a batch with a bad entry runs nothing.
+  for (qsizetype index = 0; index < commands.size(); ++index)
   {
-    const int entryId = params.value(QStringLiteral("entry_id")).toInt(-1);
-    if (entryId < 1)
+    const QJsonObject item = commands.at(index).toObject();
+    const QString type = item.value(QStringLiteral("type")).toString();
+    const Command* command = this->command(type);
+    if (command == nullptr || type == QStringLiteral("batch"))
     {
-      return ParaViewMCPRequestHandler::error(
-        requestId,
-        QStringLiteral("INVALID_PARAMS"),
-        QStringLiteral("restore_snapshot requires a positive 'entry_id' integer"));
+      return QStringLiteral("batch commands[%1] has no supported 'type'").arg(index);
     }
+    if (command->Validate)
+    {
+      const QString problem = command->Validate(item.value(QStringLiteral("params")).toObject());
+      if (!problem.isEmpty())
+      {
+        return QStringLiteral("batch commands[%1]: %2").arg(index).arg(problem);
+      }
+    }
+  }
+  return QString();
+}
 
-    QJsonObject result;
-    QString errorText;
-    if (!this->PythonBridge.restoreSnapshot(entryId, &result, &errorText))
+ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::runBatch(const Request& request)
+{
+  const QJsonArray commands = request.Params.value(QStringLiteral("commands")).toArray();
+  const bool stopOnError = request.Params.value(QStringLiteral("stop_on_error")).toBool(false);
+
+  // Views the items render are rendered once, after the last item. Failing to
+  // defer only costs the extra renders, so the batch runs regardless.
+  this->PythonBridge.setRendersDeferred(true);
+
+  // The result is assembled as text so an item's raw result is spliced in
+  // as-is rather than parsed and serialized again.
+  QByteArray resultJson = QByteArrayLiteral("{\"results\":[");
+  QList<ParaViewMCP::Attachment> attachments;
+  bool stopped = false;
+  for (qsizetype index = 0; index < commands.size(); ++index)
+  {
+    const QJsonObject item = commands.at(index).toObject();
+    const QString type = item.value(QStringLiteral("type")).toString();
+    if (index > 0)
     {
-      return ParaViewMCPRequestHandler::error(
-        requestId,
-        QStringLiteral("RESTORE_ERROR"),
-        errorText.isEmpty() ? QStringLiteral("Unable to restore snapshot") : errorText);
+      resultJson.append(',');
+    }
+    if (stopped)
+    {
+      resultJson.append(ParaViewMCP::serializeMessage(QJsonObject{
+        {"type", type},
+        {"status", QStringLiteral("skipped")},
+      }));
+      continue;
     }
 
-    Result handlerResult = ParaViewMCPRequestHandler::success(requestId, result);
-    this->attachHistoryJson(handlerResult);
-    return handlerResult;
+    Request itemRequest;
+    itemRequest.RequestId = request.RequestId;
+    itemRequest.Params = item.value(QStringLiteral("params")).toObject();
+    itemRequest.Wire = request.Wire;
+    const Result itemResult = this->command(type)->Run(itemRequest);
+
+    // Each entry is the item's own reply minus the request id; attachments
+    // move to the batch reply, keyed by the entry they belong to.
+    QJsonObject entry = itemResult.Response;
+    entry.remove(QStringLiteral("request_id"));
+    entry.remove(QStringLiteral("attachments"));
+    entry.insert(QStringLiteral("type"), type);
+    for (const ParaViewMCP::Attachment& attachment : itemResult.Attachments)
+    {
+      attachments.push_back(ParaViewMCP::Attachment{
+        QStringLiteral("results.%1.%2").arg(index).arg(attachment.Key), attachment.Data});
+    }
+    resultJson.append(itemResult.RawResult.isEmpty()
+                        ? ParaViewMCP::serializeMessage(entry)
+                        : ParaViewMCP::serializeEnvelope(entry, itemResult.RawResult));
+
+    // A cancel ends the whole batch. execute_python reports an exception in
+    // the script as ok:false rather than as an error reply; raw results come
+    // only from commands without an "ok".
+    const QString code =
+      entry.value(QStringLiteral("error")).toObject().value(QStringLiteral("code")).toString();
+    const bool failed =
+      entry.value(QStringLiteral("status")).toString() != QStringLiteral("success") ||
+      !entry.value(QStringLiteral("result")).toObject().value(QStringLiteral("ok")).toBool(true);
+    stopped = code == QStringLiteral("CANCELLED") || (stopOnError && failed);
   }
+  resultJson.append("]}");
 
-  return ParaViewMCPRequestHandler::error(requestId,
-                                          QStringLiteral("UNKNOWN_COMMAND"),
-                                          QStringLiteral("The requested command is not supported"));
+  this->PythonBridge.setRendersDeferred(false);
+
+  Result result = ParaViewMCPRequestHandler::successRaw(request.RequestId, resultJson);
+  for (const ParaViewMCP::Attachment& attachment : attachments)
+  {
+    ParaViewMCPRequestHandler::addAttachment(result, attachment.Key, attachment.Data);
+  }
+  return result;
 }
 
 ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::success(const QString& requestId,
@@ -257,6 +602,18 @@ ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::success(const QStri
   return response;
 }
 
+ParaViewMCPRequestHandler::Result
+ParaViewMCPRequestHandler::successRaw(const QString& requestId, const QByteArray& resultJson)
+{
+  Result response;
+  response.Response = QJsonObject{
+    {"request_id", requestId},
+    {"status", QStringLiteral("success")},
+  };
+  response.RawResult = resultJson;
+  return response;
+}
+
 ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::error(const QString& requestId,
                                                                    const QString& code,
                                                                    const QString& messageText,
@@ -280,12 +637,27 @@ ParaViewMCPRequestHandler::Result ParaViewMCPRequestHandler::error(const QString
   return response;
 }
 
-void ParaViewMCPRequestHandler::attachHistoryJson(Result& result)
+void ParaViewMCPRequestHandler::addAttachment(Result& result,
+                                              const QString& key,
+                                              const QByteArray& data)
 {
-  QJsonArray historyArray;
-  if (this->PythonBridge.getHistory(&historyArray, nullptr))
+  // The envelope lists attachments in the order their frames follow it; each
+  // one becomes result[key] on the receiving side.
+  QJsonArray descriptors = result.Response.value(QStringLiteral("attachments")).toArray();
+  descriptors.append(QJsonObject{
+    {"key", key},
+    {"size", static_cast<qint64>(data.size())},
+  });
+  result.Response.insert(QStringLiteral("attachments"), descriptors);
+  result.Attachments.push_back(ParaViewMCP::Attachment{key, data});
+}
+
+void ParaViewMCPRequestHandler::attachHistoryDelta(Result& result)
+{
+  QJsonObject delta;
+  if (this->PythonBridge.historyDelta(&delta, nullptr) &&
+      ParaViewMCPHistoryDelta::fromJson(delta, &result.HistoryDelta))
   {
-    result.HistoryJson =
-      QString::fromUtf8(QJsonDocument(historyArray).toJson(QJsonDocument::Compact));
+    result.HistoryChanged = true;
   }
 }
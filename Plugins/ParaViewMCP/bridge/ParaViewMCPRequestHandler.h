@@ -1,7 +1,15 @@
 #pragma once
 
+#include "ParaViewMCPHistoryDelta.h"
+#include "ParaViewMCPProtocol.h"
+
+#include <QHash>
 #include <QJsonObject>
+#include <QList>
 #include <QString>
+#include <QStringList>
+
+#include <functional>
 
 class IParaViewMCPPythonBridge;
 
@@ -15,27 +23,105 @@ public:
     bool ResetSession = false;
     bool HandshakeCompleted = false;
     QString LogMessage;
-    QString HistoryJson;
+    // Set after commands that may have changed the history; HistoryDelta is
+    // then what changed since the last one.
+    bool HistoryChanged = false;
+    ParaViewMCPHistoryDelta HistoryDelta;
+    QList<ParaViewMCP::Attachment> Attachments;
+    ParaViewMCP::WireOptions NegotiatedWire;
+    // Pre-serialized JSON for the envelope's "result" member. When set, it is
+    // spliced into Response at send time instead of being parsed here.
+    QByteArray RawResult;
+
+    // The full response with RawResult parsed back in; for callers that need
+    // to inspect it rather than send it.
+    [[nodiscard]] QJsonObject message() const;
+  };
+
+  // What a command's handler is given.
+  struct Request
+  {
+    QString RequestId;
+    QJsonObject Params;
+    ParaViewMCP::WireOptions Wire;
+  };
+
+  // A command the GUI thread can run after the handshake. Every registered
+  // command is listed in the 'hello' capabilities.
+  struct Command
+  {
+    // Returns why the params are unusable, or an empty string. Checked before
+    // Run is called; failures are answered with INVALID_PARAMS.
+    std::function<QString(const QJsonObject& params)> Validate;
+    std::function<Result(const Request& request)> Run;
+    // A successful run is followed by the history's changes for the dock
+    // panel.
+    bool RefreshesHistory = false;
   };
 
   explicit ParaViewMCPRequestHandler(IParaViewMCPPythonBridge& pythonBridge);
+  // Built-in commands call back into the handler that registered them.
+  ParaViewMCPRequestHandler(const ParaViewMCPRequestHandler&) = delete;
+  ParaViewMCPRequestHandler& operator=(const ParaViewMCPRequestHandler&) = delete;
+
+  // Adds a command, or replaces the one already registered under name.
+  void registerCommand(const QString& name, const Command& command);
+  // nullptr for names that are not registered.
+  [[nodiscard]] const Command* command(const QString& name) const;
+  // In registration order.
+  [[nodiscard]] QStringList commandNames() const;
 
-  Result
-  handleMessage(const QJsonObject& message, bool handshakeComplete, const QString& authToken);
+  // resumeSession makes a 'hello' keep the active Python session as it is
+  // instead of starting it over; the caller has matched its resume token.
+  Result handleMessage(const QJsonObject& message,
+                       bool handshakeComplete,
+                       const QString& authToken,
+                       const ParaViewMCP::WireOptions& wire = ParaViewMCP::WireOptions(),
+                       bool resumeSession = false);
 
+  // Needs neither Python nor GUI state, so the network thread answers pings
+  // with it directly once the handshake is done.
+  static Result pingResult(const QString& requestId);
+  // The reply to 'cancel': whether the request it names was stopped.
+  static Result cancelResult(const QString& requestId, const QString& targetId, bool cancelled);
+  // The reply to a request that was cancelled before it started.
+  static Result cancelledResult(const QString& requestId);
+  // The reply to 'status', which the network thread assembles.
+  static Result statusResult(const QString& requestId, const QJsonObject& status);
   static Result busyResult();
-  static Result protocolError(const QString& code, const QString& message);
+  static Result responseTooLarge(const QString& requestId);
+  static Result protocolError(const QString& code,
+                              const QString& message,
+                              const QString& requestId = QString());
+  // Adds the token a 'hello' reply hands out for resuming the session, and
+  // whether this handshake resumed one.
+  static void addResumeToken(Result& result, const QString& token, bool resumed);
 
 private:
-  Result handleHello(const QJsonObject& message, const QString& authToken);
-  Result handleCommand(const QJsonObject& message);
-  void attachHistoryJson(Result& result);
+  Result handleHello(const QJsonObject& message,
+                     const QString& authToken,
+                     const ParaViewMCP::WireOptions& wire,
+                     bool resumeSession);
+  Result handleCommand(const QJsonObject& message, const ParaViewMCP::WireOptions& wire);
+  void registerBuiltinCommands();
+  Result executePython(const Request& request);
+  Result inspectPipeline(const Request& request);
+  Result captureScreenshot(const Request& request);
+  Result getHistory(const Request& request);
+  Result restoreSnapshot(const Request& request);
+  QString validateBatch(const QJsonObject& params) const;
+  Result runBatch(const Request& request);
+  void attachHistoryDelta(Result& result);
+  static void addAttachment(Result& result, const QString& key, const QByteArray& data);
 
   static Result success(const QString& requestId, const QJsonObject& result);
+  static Result successRaw(const QString& requestId, const QByteArray& resultJson);
   static Result error(const QString& requestId,
                       const QString& code,
                       const QString& messageText,
                       const QJsonObject& details = QJsonObject());
 
   IParaViewMCPPythonBridge& PythonBridge;
+  QHash<QString, Command> Commands;
+  QStringList CommandNames;
 };
@@ -11,6 +11,44 @@ struct ParaViewMCPServerConfig
   QString Host = ParaViewMCP::defaultHost();
   quint16 Port = ParaViewMCP::DefaultPort;
   QString AuthToken;
+  // Ceiling for the per-connection frame limit negotiated in 'hello'. Raise it
+  // for very large screenshots; lower it to cap what one client can make the
+  // GUI process allocate.
+  quint32 MaxFrameBytes = ParaViewMCP::MaxFrameBytes;
+  // When set, the bridge listens on this local socket (a Unix domain socket
+  // path, or a pipe name on Windows) instead of Host:Port.
+  QString SocketPath;
+  // Size of the shared region offered to clients on this machine that ask for
+  // one in 'hello'; 0 never offers it.
+  qint64 SharedMemoryBytes = ParaViewMCP::DefaultSharedMemoryBytes;
+  // Most clients connected at the same time. Each gets its own Python
+  // namespace; their commands take turns on the GUI thread.
+  int MaxSessions = ParaViewMCP::DefaultMaxSessions;
+  // Backlog of unsent replies at which a client's further requests are left
+  // unread. Lower it to bound memory held for clients that read slowly.
+  qint64 OutboundHighWatermark = ParaViewMCP::DefaultOutboundHighWatermark;
+  // How often clients that support it are sent a heartbeat; 0 sends none and
+  // leaves dead-peer detection to TCP.
+  int HeartbeatIntervalMs = ParaViewMCP::DefaultHeartbeatIntervalMs;
+  // How long a heartbeat may go unanswered before the client is considered
+  // gone and disconnected; 0 only measures round trips and never drops one.
+  int HeartbeatTimeoutMs = ParaViewMCP::DefaultHeartbeatTimeoutMs;
+  // How long the Python session of a client that disconnected is kept, so
+  // that it can reconnect with the resume token from its 'hello' and carry
+  // on; 0 drops it at once and hands out no tokens.
+  int ResumeGraceMs = ParaViewMCP::DefaultResumeGraceMs;
+  // Opt-in low-latency TCP profile: disables Nagle's algorithm, so small
+  // replies are not held back waiting for the client's delayed ACK, turns on
+  // keep-alive and applies SocketBufferBytes. Local sockets are unaffected.
+  bool LowLatency = false;
+  // SO_SNDBUF/SO_RCVBUF for accepted TCP connections under the low-latency
+  // profile; 0 keeps the system's.
+  int SocketBufferBytes = ParaViewMCP::DefaultSocketBufferBytes;
+
+  [[nodiscard]] bool usesLocalSocket() const
+  {
+    return !this->SocketPath.trimmed().isEmpty();
+  }
 
   static ParaViewMCPServerConfig load()
   {
@@ -24,6 +62,41 @@ struct ParaViewMCPServerConfig
     {
       config.Port = static_cast<quint16>(storedPort);
     }
+    const qint64 storedFrameBytes =
+      settings
+        .value(QStringLiteral("ParaViewMCP/MaxFrameBytes"),
+               static_cast<qint64>(config.MaxFrameBytes))
+        .toLongLong();
+    config.MaxFrameBytes = ParaViewMCP::clampFrameBytes(storedFrameBytes);
+    config.SocketPath = settings.value(QStringLiteral("ParaViewMCP/SocketPath")).toString();
+    config.SharedMemoryBytes = qMax<qint64>(
+      0,
+      settings.value(QStringLiteral("ParaViewMCP/SharedMemoryBytes"), config.SharedMemoryBytes)
+        .toLongLong());
+    config.MaxSessions = qMax(
+      1, settings.value(QStringLiteral("ParaViewMCP/MaxSessions"), config.MaxSessions).toInt());
+    config.OutboundHighWatermark =
+      qMax<qint64>(ParaViewMCP::MinFrameBytes,
+                   settings
+                     .value(QStringLiteral("ParaViewMCP/OutboundHighWatermark"),
+                            config.OutboundHighWatermark)
+                     .toLongLong());
+    config.HeartbeatIntervalMs = qMax(
+      0,
+      settings.value(QStringLiteral("ParaViewMCP/HeartbeatIntervalMs"), config.HeartbeatIntervalMs)
+        .toInt());
+    config.HeartbeatTimeoutMs = qMax(
+      0,
+      settings.value(QStringLiteral("ParaViewMCP/HeartbeatTimeoutMs"), config.HeartbeatTimeoutMs)
+        .toInt());
+    config.ResumeGraceMs = qMax(
+      0, settings.value(QStringLiteral("ParaViewMCP/ResumeGraceMs"), config.ResumeGraceMs).toInt());
+    config.LowLatency =
+      settings.value(QStringLiteral("ParaViewMCP/LowLatency"), config.LowLatency).toBool();
+    config.SocketBufferBytes = qMax(
+      0,
+      settings.value(QStringLiteral("ParaViewMCP/SocketBufferBytes"), config.SocketBufferBytes)
+        .toInt());
     if (config.Host.isEmpty())
     {
       config.Host = ParaViewMCP::defaultHost();
@@ -40,10 +113,28 @@ struct ParaViewMCPServerConfig
     QSettings settings;
     settings.setValue(QStringLiteral("ParaViewMCP/ListenHost"), this->Host);
     settings.setValue(QStringLiteral("ParaViewMCP/ListenPort"), this->Port);
+    settings.setValue(QStringLiteral("ParaViewMCP/MaxFrameBytes"), this->MaxFrameBytes);
+    settings.setValue(QStringLiteral("ParaViewMCP/SocketPath"), this->SocketPath);
+    settings.setValue(QStringLiteral("ParaViewMCP/SharedMemoryBytes"), this->SharedMemoryBytes);
+    settings.setValue(QStringLiteral("ParaViewMCP/MaxSessions"), this->MaxSessions);
+    settings.setValue(QStringLiteral("ParaViewMCP/OutboundHighWatermark"),
+                      this->OutboundHighWatermark);
+    settings.setValue(QStringLiteral("ParaViewMCP/HeartbeatIntervalMs"), this->HeartbeatIntervalMs);
+    settings.setValue(QStringLiteral("ParaViewMCP/HeartbeatTimeoutMs"), this->HeartbeatTimeoutMs);
+    settings.setValue(QStringLiteral("ParaViewMCP/ResumeGraceMs"), this->ResumeGraceMs);
+    settings.setValue(QStringLiteral("ParaViewMCP/LowLatency"), this->LowLatency);
+    settings.setValue(QStringLiteral("ParaViewMCP/SocketBufferBytes"), this->SocketBufferBytes);
   }
 
   bool validateForListen(QHostAddress* address, QString* error) const
   {
+    // A local socket never leaves the machine and is only reachable by the
+    // user running ParaView, so Host and the token requirement do not apply.
+    if (this->usesLocalSocket())
+    {
+      return true;
+    }
+
     const QString trimmedHost = this->Host.trimmed();
     if (trimmedHost.isEmpty())
     {
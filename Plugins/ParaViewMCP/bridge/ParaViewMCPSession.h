@@ -1,24 +1,51 @@
 #pragma once
 
-#include <QByteArray>
+#include "ParaViewMCPHeartbeat.h"
+#include "ParaViewMCPOutboundQueue.h"
+#include "ParaViewMCPProtocol.h"
+#include "ParaViewMCPReadBuffer.h"
+#include "ParaViewMCPSharedRegion.h"
+
+#include <QIODevice>
 #include <QPointer>
-#include <QTcpSocket>
 
 class ParaViewMCPSession
 {
 public:
-  void attach(QTcpSocket* socket)
+  // id is the connection id results are routed by. maxFrameBytes is the
+  // server's configured ceiling. It applies to the handshake itself and
+  // bounds whatever limit 'hello' negotiates. offerSharedMemory says whether
+  // 'hello' may agree to a shared region.
+  void attach(QIODevice* socket,
+              quint64 id,
+              quint32 maxFrameBytes = ParaViewMCP::MaxFrameBytes,
+              bool offerSharedMemory = false)
   {
     this->ActiveSocket = socket;
+    this->Id = id;
     this->ReadBuffer.clear();
     this->HandshakeComplete = false;
+    this->Wire = ParaViewMCP::WireOptions();
+    this->Wire.MaxFrameBytes = maxFrameBytes;
+    this->Wire.SharedMemory = offerSharedMemory;
+    this->Compression = ParaViewMCP::CompressionStats();
+    this->Outbound = ParaViewMCPOutboundQueue();
+    this->Beats.clear();
+    this->InFlight = 0;
+    this->Region.close();
   }
 
   void clear()
   {
     this->ActiveSocket = nullptr;
+    this->Id = 0;
     this->ReadBuffer.clear();
     this->HandshakeComplete = false;
+    this->Wire = ParaViewMCP::WireOptions();
+    this->Outbound.clear();
+    this->Beats.clear();
+    this->InFlight = 0;
+    this->Region.close();
   }
 
   [[nodiscard]] bool hasClient() const
@@ -26,6 +53,11 @@ public:
     return this->ActiveSocket != nullptr;
   }
 
+  [[nodiscard]] quint64 id() const
+  {
+    return this->Id;
+  }
+
   [[nodiscard]] bool handshakeComplete() const
   {
     return this->HandshakeComplete;
@@ -36,18 +68,93 @@ public:
     this->HandshakeComplete = value;
   }
 
-  QByteArray& buffer()
+  [[nodiscard]] const ParaViewMCP::WireOptions& wireOptions() const
+  {
+    return this->Wire;
+  }
+
+  void setWireOptions(const ParaViewMCP::WireOptions& wire)
+  {
+    this->Wire = wire;
+  }
+
+  // Kept after the client disconnects so the last connection's savings stay
+  // observable; reset when the next client attaches.
+  [[nodiscard]] const ParaViewMCP::CompressionStats& compressionStats() const
+  {
+    return this->Compression;
+  }
+
+  ParaViewMCP::CompressionStats& compressionStats()
+  {
+    return this->Compression;
+  }
+
+  ParaViewMCPReadBuffer& buffer()
   {
     return this->ReadBuffer;
   }
 
-  [[nodiscard]] QTcpSocket* socket() const
+  // The connected QTcpSocket or QLocalSocket; framing only needs the device.
+  [[nodiscard]] QIODevice* socket() const
   {
     return this->ActiveSocket;
   }
 
+  // Frames accepted for this client that the socket has not taken yet.
+  ParaViewMCPOutboundQueue& outbound()
+  {
+    return this->Outbound;
+  }
+
+  // Round trips of the heartbeats answered by this client.
+  ParaViewMCPHeartbeat& heartbeat()
+  {
+    return this->Beats;
+  }
+
+  // Messages handed to the GUI thread that have not been answered yet. Each
+  // one gets exactly one reply, except a cancel that drops a queued request,
+  // which answers for both.
+  [[nodiscard]] int inFlight() const
+  {
+    return this->InFlight;
+  }
+
+  void beginRequest()
+  {
+    ++this->InFlight;
+  }
+
+  void endRequest()
+  {
+    this->InFlight = qMax(0, this->InFlight - 1);
+  }
+
+  ParaViewMCPSharedRegion& sharedRegion()
+  {
+    return this->Region;
+  }
+
+  // The region large bodies should be written to, or nullptr when this
+  // connection sends everything inline. The 'hello' reply that announces the
+  // region always goes inline.
+  ParaViewMCPSharedRegion* activeSharedRegion()
+  {
+    return this->HandshakeComplete && this->Wire.SharedMemory && this->Region.isOpen()
+             ? &this->Region
+             : nullptr;
+  }
+
 private:
-  QPointer<QTcpSocket> ActiveSocket;
-  QByteArray ReadBuffer;
+  QPointer<QIODevice> ActiveSocket;
+  quint64 Id = 0;
+  ParaViewMCPSharedRegion Region;
+  ParaViewMCPReadBuffer ReadBuffer;
+  ParaViewMCPOutboundQueue Outbound;
+  ParaViewMCPHeartbeat Beats;
+  int InFlight = 0;
   bool HandshakeComplete = false;
+  ParaViewMCP::WireOptions Wire;
+  ParaViewMCP::CompressionStats Compression;
 };
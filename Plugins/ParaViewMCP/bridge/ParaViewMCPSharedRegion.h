@@ -0,0 +1,150 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDir>
+#include <QFileDevice>
+#include <QString>
+#include <QTemporaryFile>
+#include <QtEndian>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+// File-backed ring a co-located client maps to read large result bodies that
+// would otherwise be copied through the socket. Bodies are addressed by ring
+// position, a monotonic byte count whose data lives at
+// HeaderBytes + position % capacity(). A body never wraps; one that does not
+// fit before the end starts over at the beginning and the skipped tail counts
+// as used. The client stores the position up to which it has finished reading
+// as a little-endian 64-bit value at offset 0, which is what frees space.
+class ParaViewMCPSharedRegion
+{
+public:
+  static constexpr qint64 HeaderBytes = 64;
+
+  bool open(qint64 capacity, QString* error)
+  {
+    this->close();
+
+    auto file = std::make_unique<QTemporaryFile>(
+      ParaViewMCPSharedRegion::directory() + QStringLiteral("/paraview-mcp-XXXXXX.ring"));
+    if (capacity <= 0 || !file->open() ||
+        !file->setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner) ||
+        !file->resize(HeaderBytes + capacity))
+    {
+      if (error)
+      {
+        *error = QStringLiteral("Unable to create the shared memory region: %1")
+                   .arg(file->errorString());
+      }
+      return false;
+    }
+
+    uchar* map = file->map(0, HeaderBytes + capacity);
+    if (map == nullptr)
+    {
+      if (error)
+      {
+        *error = QStringLiteral("Unable to map the shared memory region: %1")
+                   .arg(file->errorString());
+      }
+      return false;
+    }
+
+    std::memset(map, 0, static_cast<size_t>(HeaderBytes));
+    this->File = std::move(file);
+    this->Map = map;
+    this->Capacity = capacity;
+    return true;
+  }
+
+  // Unmaps and deletes the backing file. A client that still has it mapped
+  // keeps its pages until it unmaps them too.
+  void close()
+  {
+    this->File.reset();
+    this->Map = nullptr;
+    this->Capacity = 0;
+    this->Head = 0;
+    this->Released = 0;
+  }
+
+  [[nodiscard]] bool isOpen() const
+  {
+    return this->Map != nullptr;
+  }
+
+  [[nodiscard]] QString path() const
+  {
+    return this->File ? this->File->fileName() : QString();
+  }
+
+  // Bytes available for bodies, excluding the header.
+  [[nodiscard]] qint64 capacity() const
+  {
+    return this->Capacity;
+  }
+
+  // Size of the backing file, which is what the client maps.
+  [[nodiscard]] qint64 size() const
+  {
+    return this->isOpen() ? HeaderBytes + this->Capacity : 0;
+  }
+
+  // Copies bytes into the ring and returns their position, or -1 when the
+  // client has not yet released enough space; the caller then sends inline.
+  qint64 write(const QByteArray& bytes)
+  {
+    const qint64 length = bytes.size();
+    if (!this->isOpen() || length == 0 || length > this->Capacity)
+    {
+      return -1;
+    }
+
+    qint64 position = this->Head;
+    const qint64 offset = position % this->Capacity;
+    if (offset + length > this->Capacity)
+    {
+      position += this->Capacity - offset;
+    }
+    if (position + length - this->released() > this->Capacity)
+    {
+      return -1;
+    }
+
+    std::memcpy(this->Map + HeaderBytes + position % this->Capacity,
+                bytes.constData(),
+                static_cast<size_t>(length));
+    this->Head = position + length;
+    return position;
+  }
+
+private:
+  // /dev/shm is tmpfs on Linux, so the pages never go to disk; elsewhere the
+  // per-user temporary directory is the closest equivalent.
+  static QString directory()
+  {
+    const QDir shm(QStringLiteral("/dev/shm"));
+    return shm.exists() ? shm.path() : QDir::tempPath();
+  }
+
+  qint64 released()
+  {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const qint64 cursor = static_cast<qint64>(qFromLittleEndian<quint64>(this->Map));
+    // The client can only move the cursor forward over bytes it was given; a
+    // value outside that range is ignored rather than trusted.
+    if (cursor >= this->Released && cursor <= this->Head)
+    {
+      this->Released = cursor;
+    }
+    return this->Released;
+  }
+
+  std::unique_ptr<QTemporaryFile> File;
+  uchar* Map = nullptr;
+  qint64 Capacity = 0;
+  qint64 Head = 0;
+  qint64 Released = 0;
+};
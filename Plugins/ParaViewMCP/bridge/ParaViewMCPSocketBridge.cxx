@@ -1,16 +1,65 @@
 #include "ParaViewMCPSocketBridge.h"
 
-#include "ParaViewMCPProtocol.h"
+#include "ParaViewMCPNetworkWorker.h"
 
-#include <QList>
-#include <QTcpServer>
-#include <QTcpSocket>
+#include <QHostAddress>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+#include <QTimer>
 
 ParaViewMCPSocketBridge::ParaViewMCPSocketBridge(IParaViewMCPPythonBridge& pythonBridge,
                                                  ParaViewMCPRequestHandler& requestHandler,
                                                  QObject* parent)
     : QObject(parent), PythonBridge(pythonBridge), RequestHandler(requestHandler)
 {
+  qRegisterMetaType<ParaViewMCP::WireOptions>();
+  qRegisterMetaType<ParaViewMCP::LatencyStats>();
+  qRegisterMetaType<ParaViewMCP::ReceiveTiming>();
+  qRegisterMetaType<ParaViewMCPHistoryDelta>();
+
+  this->Worker = new ParaViewMCPNetworkWorker();
+  this->Worker->setInterruptHandler([this](quint64 connectionId, const QString& requestId)
+                                    { return this->interruptRunning(connectionId, requestId); });
+  this->Worker->setStatusHandler([this](quint64 connectionId)
+                                 { return this->runningStatus(connectionId); });
+  this->Worker->moveToThread(&this->NetworkThread);
+  QObject::connect(&this->NetworkThread, &QThread::finished, this->Worker, &QObject::deleteLater);
+  QObject::connect(
+    this->Worker, &ParaViewMCPNetworkWorker::logChanged, this, &ParaViewMCPSocketBridge::setLog);
+  QObject::connect(this->Worker,
+                   &ParaViewMCPNetworkWorker::clientAttached,
+                   this,
+                   &ParaViewMCPSocketBridge::onClientAttached);
+  QObject::connect(this->Worker,
+                   &ParaViewMCPNetworkWorker::clientDetached,
+                   this,
+                   &ParaViewMCPSocketBridge::onClientDetached);
+  QObject::connect(this->Worker,
+                   &ParaViewMCPNetworkWorker::requestReceived,
+                   this,
+                   &ParaViewMCPSocketBridge::onRequestReceived);
+  QObject::connect(this->Worker,
+                   &ParaViewMCPNetworkWorker::cancelRequested,
+                   this,
+                   &ParaViewMCPSocketBridge::onCancelRequested);
+  QObject::connect(this->Worker,
+                   &ParaViewMCPNetworkWorker::latencyChanged,
+                   this,
+                   &ParaViewMCPSocketBridge::onLatencyChanged);
+  this->NetworkThread.setObjectName(QStringLiteral("ParaViewMCP network"));
+  this->NetworkThread.start();
+}
+
+ParaViewMCPSocketBridge::~ParaViewMCPSocketBridge()
+{
+  // The servers and sockets belong to the network thread and are closed and
+  // deleted there before it exits.
+  ParaViewMCPNetworkWorker* worker = this->Worker;
+  QMetaObject::invokeMethod(
+    worker, [worker]() { worker->close(); }, Qt::BlockingQueuedConnection);
+  this->NetworkThread.quit();
+  this->NetworkThread.wait();
 }
 
 bool ParaViewMCPSocketBridge::start(const ParaViewMCPServerConfig& config, QString* error)
@@ -28,70 +77,130 @@ bool ParaViewMCPSocketBridge::start(const ParaViewMCPServerConfig& config, QStri
     return false;
   }
 
-  if (this->Server == nullptr)
-  {
-    this->Server = new QTcpServer(this);
-    QObject::connect(
-      this->Server, &QTcpServer::newConnection, this, &ParaViewMCPSocketBridge::onNewConnection);
-  }
-
-  if (this->Server->isListening())
+  if (this->isListening())
   {
     this->stop();
   }
 
-  if (!this->Server->listen(address, config.Port))
+  // Blocks until the network thread has bound the server so the port, or a
+  // failure, is known when start() returns.
+  ParaViewMCPNetworkWorker* worker = this->Worker;
+  bool listening = false;
+  quint16 port = 0;
+  QString path;
+  QMetaObject::invokeMethod(
+    worker,
+    [&]()
+    {
+      listening = worker->listen(config, address, &listenError);
+      port = worker->serverPort();
+      path = worker->socketPath();
+    },
+    Qt::BlockingQueuedConnection);
+  if (!listening)
   {
-    const QString serverError = this->Server->errorString();
     if (error != nullptr)
     {
-      *error = serverError;
+      *error = listenError;
     }
     this->setStatus(QStringLiteral("Error"));
-    this->setLog(serverError);
+    this->setLog(listenError);
     return false;
   }
 
   this->Config = config;
+  this->Listening = true;
+  this->Port = port;
+  this->LocalPath = path;
   this->setStatus(QStringLiteral("Listening"));
-  this->setLog(
-    QStringLiteral("Listening on %1:%2").arg(this->Config.Host).arg(this->Server->serverPort()));
+  if (config.usesLocalSocket())
+  {
+    this->setLog(QStringLiteral("Listening on %1").arg(this->LocalPath));
+  }
+  else
+  {
+    this->setLog(QStringLiteral("Listening on %1:%2").arg(this->Config.Host).arg(this->Port));
+  }
   return true;
 }
 
 void ParaViewMCPSocketBridge::stop()
 {
-  if (this->Server != nullptr && this->Server->isListening())
+  ParaViewMCPNetworkWorker* worker = this->Worker;
+  quint64 closedConnectionId = 0;
+  QMetaObject::invokeMethod(
+    worker,
+    [worker, &closedConnectionId]() { closedConnectionId = worker->close(); },
+    Qt::BlockingQueuedConnection);
+  this->ClosedConnectionId = closedConnectionId;
+  this->Listening = false;
+  this->LocalPath.clear();
+
+  const QList<quint64> connectionIds = this->Connections.keys();
+  for (const quint64 connectionId : connectionIds)
   {
-    this->Server->close();
+    this->finishConnection(connectionId, true, false);
+  }
+  // Nobody can come back to a stopped server.
+  const QList<quint64> parkedSessions = this->ParkedSessions.values();
+  this->ParkedSessions.clear();
+  if ((connectionIds.isEmpty() || !parkedSessions.isEmpty()) && this->PythonBridge.isReady())
+  {
+    for (const quint64 pythonSession : parkedSessions)
+    {
+      this->PythonBridge.closeSession(pythonSession);
+    }
+    this->PythonBridge.resetSession();
+    emit this->historyChanged(ParaViewMCPHistoryDelta::cleared());
   }
-  this->closeClientSocket(true, false);
   this->setStatus(QStringLiteral("Stopped"));
 }
 
 bool ParaViewMCPSocketBridge::isListening() const
 {
-  return this->Server != nullptr && this->Server->isListening();
+  return this->Listening;
 }
 
 bool ParaViewMCPSocketBridge::hasClient() const
 {
-  return this->Session.hasClient();
+  return !this->Connections.isEmpty();
+}
+
+int ParaViewMCPSocketBridge::clientCount() const
+{
+  return static_cast<int>(this->Connections.size());
 }
 
 bool ParaViewMCPSocketBridge::handshakeComplete() const
 {
-  return this->Session.handshakeComplete();
+  for (const Connection& connection : this->Connections)
+  {
+    if (connection.HandshakeComplete)
+    {
+      return true;
+    }
+  }
+  return false;
 }
 
 quint16 ParaViewMCPSocketBridge::serverPort() const
 {
-  return this->Server != nullptr ? this->Server->serverPort() : 0;
+  return this->Port;
 }
 
-const ParaViewMCPSession& ParaViewMCPSocketBridge::session() const
+QString ParaViewMCPSocketBridge::socketPath() const
 {
-  return this->Session;
+  return this->LocalPath;
+}
+
+ParaViewMCP::OutboundStats ParaViewMCPSocketBridge::outboundStats() const
+{
+  return this->Worker->outboundStats();
+}
+
+ParaViewMCP::LatencyStats ParaViewMCPSocketBridge::latencyStats() const
+{
+  return this->Latency;
 }
 
 void ParaViewMCPSocketBridge::setStatus(const QString& status)
@@ -104,149 +213,406 @@ void ParaViewMCPSocketBridge::setLog(const QString& message)
   emit this->logChanged(message);
 }
 
-void ParaViewMCPSocketBridge::onNewConnection()
+void ParaViewMCPSocketBridge::setConnectedStatus()
 {
-  if (this->Server == nullptr)
+  if (this->Connections.size() == 1)
   {
-    return;
+    this->setStatus(QStringLiteral("Client connected"));
   }
-
-  while (this->Server->hasPendingConnections())
+  else
   {
-    QTcpSocket* socket = this->Server->nextPendingConnection();
-    if (socket == nullptr)
-    {
-      continue;
-    }
-
-    if (this->Session.hasClient())
-    {
-      const auto result = ParaViewMCPRequestHandler::busyResult();
-      ParaViewMCPSocketBridge::sendMessage(socket, result.Response);
-      socket->disconnectFromHost();
-      socket->deleteLater();
-      continue;
-    }
+    this->setStatus(QStringLiteral("%1 clients connected").arg(this->Connections.size()));
+  }
+}
 
-    this->Session.attach(socket);
+void ParaViewMCPSocketBridge::onClientAttached(quint64 connectionId,
+                                               const ParaViewMCP::WireOptions& wire)
+{
+  if (connectionId <= this->ClosedConnectionId)
+  {
+    return;
+  }
 
-    QObject::connect(
-      socket, &QTcpSocket::readyRead, this, &ParaViewMCPSocketBridge::onSocketReadyRead);
-    QObject::connect(
-      socket, &QTcpSocket::disconnected, this, &ParaViewMCPSocketBridge::onSocketDisconnected);
-    QObject::connect(
-      socket, &QTcpSocket::errorOccurred, this, &ParaViewMCPSocketBridge::onSocketError);
+  Connection connection;
+  connection.Wire = wire;
+  connection.PythonSession = connectionId;
+  this->Connections.insert(connectionId, connection);
+  this->setConnectedStatus();
+}
 
-    this->setStatus(QStringLiteral("Client connected"));
-    this->setLog(QStringLiteral("Client connected from %1").arg(socket->peerAddress().toString()));
+void ParaViewMCPSocketBridge::onClientDetached(quint64 connectionId, bool resetSession)
+{
+  if (this->Connections.contains(connectionId))
+  {
+    this->finishConnection(connectionId, resetSession);
   }
 }
 
-void ParaViewMCPSocketBridge::onSocketReadyRead()
+void ParaViewMCPSocketBridge::onRequestReceived(quint64 connectionId,
+                                                const QJsonObject& message,
+                                                const ParaViewMCP::ReceiveTiming& received)
 {
-  QTcpSocket* socket = this->Session.socket();
-  if (socket == nullptr)
+  auto found = this->Connections.find(connectionId);
+  if (found == this->Connections.end())
   {
     return;
   }
 
-  this->Session.buffer().append(socket->readAll());
+  if (found->Pending.isEmpty())
+  {
+    this->ReadyConnections.push_back(connectionId);
+  }
+  found->Pending.enqueue(PendingRequest{message, received});
+  this->scheduleDispatch();
+}
 
-  QList<QJsonObject> messages;
-  QString parseError;
-  if (!ParaViewMCP::tryExtractMessages(this->Session.buffer(), messages, &parseError))
+// Arrives in order with the client's requests, so a request sent before the
+// cancel is either still queued, running or already answered.
+void ParaViewMCPSocketBridge::onCancelRequested(quint64 connectionId, const QJsonObject& message)
+{
+  auto found = this->Connections.find(connectionId);
+  if (found == this->Connections.end())
   {
-    this->applyHandlerResult(
-      ParaViewMCPRequestHandler::protocolError(QStringLiteral("PROTOCOL_ERROR"), parseError));
     return;
   }
 
-  for (const QJsonObject& message : messages)
+  const QString requestId = message.value(QStringLiteral("request_id")).toString();
+  const QJsonObject params = message.value(QStringLiteral("params")).toObject();
+  const QString targetId = params.value(QStringLiteral("request_id")).toString();
+  QList<ParaViewMCPRequestHandler::Result> results;
+  bool cancelled = false;
+  for (qsizetype index = 0; !targetId.isEmpty() && index < found->Pending.size(); ++index)
   {
-    this->applyHandlerResult(this->RequestHandler.handleMessage(
-      message, this->Session.handshakeComplete(), this->Config.AuthToken));
-    if (!this->Session.hasClient())
+    if (found->Pending.at(index).Message.value(QStringLiteral("request_id")).toString() ==
+        targetId)
     {
-      return;
+      found->Pending.removeAt(index);
+      results.append(ParaViewMCPRequestHandler::cancelledResult(targetId));
+      cancelled = true;
+      break;
     }
   }
+  if (found->Pending.isEmpty())
+  {
+    this->ReadyConnections.removeAll(connectionId);
+  }
+  // Only reached while a request runs if Python spun an event loop.
+  if (!cancelled && !targetId.isEmpty())
+  {
+    cancelled = this->interruptRunning(connectionId, targetId);
+  }
+  results.append(ParaViewMCPRequestHandler::cancelResult(requestId, targetId, cancelled));
+
+  ParaViewMCPNetworkWorker* worker = this->Worker;
+  QMetaObject::invokeMethod(
+    worker,
+    [worker, connectionId, results]()
+    {
+      for (const ParaViewMCPRequestHandler::Result& result : results)
+      {
+        worker->sendResult(connectionId, result);
+      }
+    },
+    Qt::QueuedConnection);
+}
+
+// Called from the network thread.
+bool ParaViewMCPSocketBridge::interruptRunning(quint64 connectionId, const QString& requestId)
+{
+  QMutexLocker locker(&this->RunningMutex);
+  if (connectionId != this->RunningConnection || requestId != this->RunningRequestId)
+  {
+    return false;
+  }
+  return this->PythonBridge.interrupt();
+}
+
+// Called from the network thread. Only the asking client learns which of its
+// requests is running; other clients' request ids stay private.
+QJsonObject ParaViewMCPSocketBridge::runningStatus(quint64 connectionId)
+{
+  QMutexLocker locker(&this->RunningMutex);
+  QJsonObject status{{"busy", this->RunningConnection != 0}};
+  if (this->RunningConnection != 0)
+  {
+    status.insert(QStringLiteral("busy_ms"), this->RunningTimer.elapsed());
+  }
+  if (this->RunningConnection != 0 && this->RunningConnection == connectionId)
+  {
+    status.insert(QStringLiteral("running_request_id"), this->RunningRequestId);
+  }
+  return status;
 }
 
-void ParaViewMCPSocketBridge::onSocketDisconnected()
+void ParaViewMCPSocketBridge::setRunning(quint64 connectionId, const QString& requestId)
 {
-  this->closeClientSocket(true);
+  QMutexLocker locker(&this->RunningMutex);
+  this->RunningConnection = connectionId;
+  this->RunningRequestId = requestId;
+  this->RunningTimer.start();
 }
 
-void ParaViewMCPSocketBridge::onSocketError(QAbstractSocket::SocketError socketError)
+void ParaViewMCPSocketBridge::onLatencyChanged(const ParaViewMCP::LatencyStats& stats)
 {
-  Q_UNUSED(socketError);
+  this->Latency = stats;
+  emit this->latencyChanged(stats);
+}
+
+void ParaViewMCPSocketBridge::scheduleDispatch()
+{
+  if (this->DispatchScheduled)
+  {
+    return;
+  }
+  this->DispatchScheduled = true;
+  QMetaObject::invokeMethod(this, [this]() { this->dispatchNext(); }, Qt::QueuedConnection);
+}
+
+// Runs one request from the connection whose turn it is. The flag stays set
+// while it runs, so an event loop spun from inside Python cannot start a
+// second request on top of this one.
+void ParaViewMCPSocketBridge::dispatchNext()
+{
+  if (!this->ReadyConnections.isEmpty())
+  {
+    const quint64 connectionId = this->ReadyConnections.takeFirst();
+    auto found = this->Connections.find(connectionId);
+    if (found != this->Connections.end() && !found->Pending.isEmpty())
+    {
+      const PendingRequest pending = found->Pending.dequeue();
+      if (!found->Pending.isEmpty())
+      {
+        this->ReadyConnections.push_back(connectionId);
+      }
+      this->handleRequest(connectionId, pending.Message, pending.Received);
+    }
+  }
 
-  if (this->Session.socket() != nullptr)
+  this->DispatchScheduled = false;
+  if (!this->ReadyConnections.isEmpty())
   {
-    this->setLog(this->Session.socket()->errorString());
+    this->scheduleDispatch();
   }
 }
 
-void ParaViewMCPSocketBridge::applyHandlerResult(const ParaViewMCPRequestHandler::Result& result)
+void ParaViewMCPSocketBridge::handleRequest(quint64 connectionId,
+                                            const QJsonObject& message,
+                                            const ParaViewMCP::ReceiveTiming& received)
 {
+  const qint64 startedNs = ParaViewMCP::monotonicNs();
+  const Connection connection = this->Connections.value(connectionId);
+
+  // A 'hello' with the token of a parked session, or of one still held by a
+  // connection the client has given up on, continues that session.
+  const QString resumeToken = message.value(QStringLiteral("resume_token")).toString();
+  quint64 supersededConnection = 0;
+  quint64 resumedSession = 0;
+  if (!connection.HandshakeComplete &&
+      message.value(QStringLiteral("type")).toString() == QStringLiteral("hello"))
+  {
+    resumedSession = this->findResumable(resumeToken, connectionId, &supersededConnection);
+  }
+  this->activateSession(resumedSession != 0 ? resumedSession : connection.PythonSession);
+
+  this->setRunning(connectionId, message.value(QStringLiteral("request_id")).toString());
+  ParaViewMCPRequestHandler::Result result =
+    this->RequestHandler.handleMessage(message,
+                                       connection.HandshakeComplete,
+                                       this->Config.AuthToken,
+                                       connection.Wire,
+                                       resumedSession != 0);
+  this->setRunning(0, QString());
+
+  // The handler timed the command itself; add what happened before it got
+  // its turn on this thread.
+  if (result.Response.contains(QStringLiteral("timings")))
+  {
+    QJsonObject timings = result.Response.value(QStringLiteral("timings")).toObject();
+    timings.insert(QStringLiteral("decode_ms"), ParaViewMCP::timingMs(received.DecodeNs));
+    timings.insert(QStringLiteral("queue_ms"),
+                   ParaViewMCP::timingMs(startedNs - received.DecodedAtNs));
+    result.Response.insert(QStringLiteral("timings"), timings);
+  }
+
   if (!result.LogMessage.isEmpty())
   {
     this->setLog(result.LogMessage);
   }
 
-  if (!result.HistoryJson.isEmpty())
+  if (result.HistoryChanged)
   {
-    emit this->historyChanged(result.HistoryJson);
+    emit this->historyChanged(result.HistoryDelta);
   }
 
-  if (!result.Response.isEmpty())
+  // Looked up again: the client may have gone while Python was running.
+  auto found = this->Connections.find(connectionId);
+  if (found == this->Connections.end())
   {
-    ParaViewMCPSocketBridge::sendMessage(this->Session.socket(), result.Response);
+    return;
   }
-
   if (result.HandshakeCompleted)
   {
-    this->Session.setHandshakeComplete(true);
+    found->HandshakeComplete = true;
+    found->Wire = result.NegotiatedWire;
+    if (resumedSession != 0)
+    {
+      found->PythonSession = resumedSession;
+      this->ParkedSessions.remove(resumeToken);
+      this->setLog(QStringLiteral("Client %1 resumed its session").arg(connectionId));
+    }
+    // A fresh token every time, so one that leaked with a log line or an old
+    // connection is good for one resume at most.
+    if (this->Config.ResumeGraceMs > 0)
+    {
+      found->ResumeToken = ParaViewMCPSocketBridge::newResumeToken();
+      ParaViewMCPRequestHandler::addResumeToken(result, found->ResumeToken, resumedSession != 0);
+    }
+  }
+
+  ParaViewMCPNetworkWorker* worker = this->Worker;
+  QMetaObject::invokeMethod(
+    worker,
+    [worker, connectionId, result]() { worker->sendResult(connectionId, result); },
+    Qt::QueuedConnection);
+
+  if (result.HandshakeCompleted && supersededConnection != 0)
+  {
+    this->setLog(QStringLiteral("Client %1 took over the session of client %2")
+                   .arg(connectionId)
+                   .arg(supersededConnection));
+    this->finishConnection(supersededConnection, false);
+    QMetaObject::invokeMethod(
+      worker,
+      [worker, supersededConnection]() { worker->dropClient(supersededConnection); },
+      Qt::QueuedConnection);
   }
 
+  // The network thread closes the socket once the reply is out; stop taking
+  // this client's requests now rather than when it reports back.
   if (result.CloseConnection)
   {
-    this->closeClientSocket(result.ResetSession);
+    this->finishConnection(connectionId, result.ResetSession);
   }
 }
 
-void ParaViewMCPSocketBridge::sendMessage(QTcpSocket* socket, const QJsonObject& message)
+void ParaViewMCPSocketBridge::activateSession(quint64 pythonSession)
 {
-  if (socket == nullptr)
+  if (pythonSession == this->ActiveSession)
   {
     return;
   }
+  QString sessionError;
+  if (this->PythonBridge.selectSession(pythonSession, &sessionError))
+  {
+    this->ActiveSession = pythonSession;
+  }
+  else if (!sessionError.isEmpty())
+  {
+    this->setLog(sessionError);
+  }
+}
 
-  socket->write(ParaViewMCP::encodeMessage(message));
-  socket->flush();
+// Returns the Python session token resumes, or 0. When another connection
+// still holds it, that connection's id goes to supersededConnection.
+quint64 ParaViewMCPSocketBridge::findResumable(const QString& token,
+                                               quint64 connectionId,
+                                               quint64* supersededConnection) const
+{
+  if (token.isEmpty() || this->Config.ResumeGraceMs <= 0)
+  {
+    return 0;
+  }
+  const auto parked = this->ParkedSessions.constFind(token);
+  if (parked != this->ParkedSessions.constEnd())
+  {
+    return parked.value();
+  }
+  for (auto other = this->Connections.constBegin(); other != this->Connections.constEnd(); ++other)
+  {
+    if (other.key() != connectionId && other->ResumeToken == token)
+    {
+      *supersededConnection = other.key();
+      return other->PythonSession;
+    }
+  }
+  return 0;
+}
+
+QString ParaViewMCPSocketBridge::newResumeToken()
+{
+  quint32 words[4];
+  QRandomGenerator::system()->fillRange(words);
+  return QString::fromLatin1(
+    QByteArray(reinterpret_cast<const char*>(words), sizeof(words)).toHex());
 }
 
-void ParaViewMCPSocketBridge::closeClientSocket(bool resetSession, bool emitStateUpdate)
+// Keeps a disconnected client's session for the grace period; it is released
+// then unless a 'hello' has resumed it.
+void ParaViewMCPSocketBridge::parkSession(const QString& token, quint64 pythonSession)
 {
-  const bool listening = this->isListening();
-  QTcpSocket* socket = this->Session.socket();
-  this->Session.clear();
+  this->ParkedSessions.insert(token, pythonSession);
+  QTimer::singleShot(this->Config.ResumeGraceMs,
+                     this,
+                     [this, token]()
+                     {
+                       const auto parked = this->ParkedSessions.find(token);
+                       if (parked == this->ParkedSessions.end())
+                       {
+                         return;
+                       }
+                       const quint64 pythonSession = parked.value();
+                       this->ParkedSessions.erase(parked);
+                       this->releaseSession(pythonSession);
+                     });
+}
 
-  if (socket != nullptr)
+// Drops a Python session. Once no client is connected or expected back, the
+// whole Python state starts over, as it did when only one was allowed.
+void ParaViewMCPSocketBridge::releaseSession(quint64 pythonSession)
+{
+  if (!this->PythonBridge.isReady())
   {
-    QObject::disconnect(socket, nullptr, this, nullptr);
-    socket->close();
-    socket->deleteLater();
+    return;
   }
-
-  if (resetSession && this->PythonBridge.isReady())
+  this->PythonBridge.closeSession(pythonSession);
+  if (this->Connections.isEmpty() && this->ParkedSessions.isEmpty())
   {
     this->PythonBridge.resetSession();
-    emit this->historyChanged(QString());
+    emit this->historyChanged(ParaViewMCPHistoryDelta::cleared());
   }
+}
+
+// Drops the client's queue. Its Python session is parked if the client may
+// still resume it, and released otherwise.
+void ParaViewMCPSocketBridge::finishConnection(quint64 connectionId,
+                                               bool resetSession,
+                                               bool emitStateUpdate)
+{
+  const Connection connection = this->Connections.take(connectionId);
+  this->ReadyConnections.removeAll(connectionId);
 
-  if (emitStateUpdate)
+  if (resetSession)
+  {
+    if (this->Listening && connection.HandshakeComplete && !connection.ResumeToken.isEmpty())
+    {
+      this->parkSession(connection.ResumeToken, connection.PythonSession);
+    }
+    else
+    {
+      this->releaseSession(connection.PythonSession);
+    }
+  }
+
+  if (!emitStateUpdate)
+  {
+    return;
+  }
+  if (!this->Connections.isEmpty())
+  {
+    this->setConnectedStatus();
+  }
+  else
   {
-    this->setStatus(listening ? QStringLiteral("Listening") : QStringLiteral("Stopped"));
+    this->setStatus(this->Listening ? QStringLiteral("Listening") : QStringLiteral("Stopped"));
   }
 }
@@ -1,16 +1,41 @@
 #pragma once
 
 #include "IParaViewMCPPythonBridge.h"
+#include "ParaViewMCPHistoryDelta.h"
+#include "ParaViewMCPProtocol.h"
 #include "ParaViewMCPRequestHandler.h"
 #include "ParaViewMCPServerConfig.h"
-#include "ParaViewMCPSession.h"
 
-#include <QAbstractSocket>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
 #include <QObject>
+#include <QQueue>
+#include <QThread>
 
-class QTcpServer;
-class QTcpSocket;
+class ParaViewMCPNetworkWorker;
 
+// GUI-thread side of the bridge. Socket I/O and framing run on a network
+// thread owned by ParaViewMCPNetworkWorker; this object runs the requests it
+// receives through the request handler, where Python executes, and posts the
+// results back. State exposed here follows the order in which the GUI thread
+// has seen clients come and go.
+//
+// Each connected client has its own queue. Queues are served round-robin, one
+// request per turn and one turn per event loop pass, so a client pipelining
+// many commands cannot starve another and the GUI keeps repainting between
+// them. Before each request the client's Python session is selected.
+//
+// A client can cancel its own requests: a queued one is dropped and answered
+// with CANCELLED, and a running execute_python is interrupted from the
+// network thread, since the GUI thread is busy running it.
+//
+// Each 'hello' reply carries a resume token. When a client disconnects its
+// Python session is parked for ResumeGraceMs instead of being dropped, and a
+// 'hello' presenting the token in that time carries on with the namespace,
+// history and snapshots as they were.
 class ParaViewMCPSocketBridge : public QObject
 {
   Q_OBJECT
@@ -19,35 +44,101 @@ public:
   explicit ParaViewMCPSocketBridge(IParaViewMCPPythonBridge& pythonBridge,
                                    ParaViewMCPRequestHandler& requestHandler,
                                    QObject* parent = nullptr);
+  ~ParaViewMCPSocketBridge() override;
 
   bool start(const ParaViewMCPServerConfig& config, QString* error = nullptr);
   void stop();
 
   [[nodiscard]] bool isListening() const;
   [[nodiscard]] bool hasClient() const;
+  [[nodiscard]] int clientCount() const;
+  // True once any connected client has completed 'hello'.
   [[nodiscard]] bool handshakeComplete() const;
   [[nodiscard]] quint16 serverPort() const;
-  [[nodiscard]] const ParaViewMCPSession& session() const;
+  // Full path of the local socket when listening on one, otherwise empty.
+  [[nodiscard]] QString socketPath() const;
+  // Unsent reply bytes across all clients, kept by the network thread.
+  [[nodiscard]] ParaViewMCP::OutboundStats outboundStats() const;
+  // Heartbeat round trips as of the last latencyChanged().
+  [[nodiscard]] ParaViewMCP::LatencyStats latencyStats() const;
 
 signals:
   void statusChanged(const QString& status);
   void logChanged(const QString& message);
-  void historyChanged(const QString& historyJson);
+  void historyChanged(const ParaViewMCPHistoryDelta& delta);
+  void latencyChanged(const ParaViewMCP::LatencyStats& stats);
 
 private:
   void setStatus(const QString& status);
   void setLog(const QString& message);
-  void onNewConnection();
-  void onSocketReadyRead();
-  void onSocketDisconnected();
-  void onSocketError(QAbstractSocket::SocketError socketError);
-  void applyHandlerResult(const ParaViewMCPRequestHandler::Result& result);
-  static void sendMessage(QTcpSocket* socket, const QJsonObject& message);
-  void closeClientSocket(bool resetSession, bool emitStateUpdate = true);
-
-  QTcpServer* Server = nullptr;
+  void onClientAttached(quint64 connectionId, const ParaViewMCP::WireOptions& wire);
+  void onClientDetached(quint64 connectionId, bool resetSession);
+  void onRequestReceived(quint64 connectionId,
+                         const QJsonObject& message,
+                         const ParaViewMCP::ReceiveTiming& received);
+  void onCancelRequested(quint64 connectionId, const QJsonObject& message);
+  bool interruptRunning(quint64 connectionId, const QString& requestId);
+  QJsonObject runningStatus(quint64 connectionId);
+  void setRunning(quint64 connectionId, const QString& requestId);
+  void onLatencyChanged(const ParaViewMCP::LatencyStats& stats);
+  void activateSession(quint64 pythonSession);
+  quint64 findResumable(const QString& token,
+                        quint64 connectionId,
+                        quint64* supersededConnection) const;
+  static QString newResumeToken();
+  void parkSession(const QString& token, quint64 pythonSession);
+  void releaseSession(quint64 pythonSession);
+  void scheduleDispatch();
+  void dispatchNext();
+  void handleRequest(quint64 connectionId,
+                     const QJsonObject& message,
+                     const ParaViewMCP::ReceiveTiming& received);
+  void finishConnection(quint64 connectionId, bool resetSession, bool emitStateUpdate = true);
+  void setConnectedStatus();
+
+  struct PendingRequest
+  {
+    QJsonObject Message;
+    ParaViewMCP::ReceiveTiming Received;
+  };
+
+  struct Connection
+  {
+    bool HandshakeComplete = false;
+    ParaViewMCP::WireOptions Wire;
+    QQueue<PendingRequest> Pending;
+    // The Python session requests run in: the connection's own id, or that
+    // of the connection whose session it resumed.
+    quint64 PythonSession = 0;
+    QString ResumeToken;
+  };
+
+  QThread NetworkThread;
+  ParaViewMCPNetworkWorker* Worker = nullptr;
   ParaViewMCPServerConfig Config;
-  ParaViewMCPSession Session;
+  bool Listening = false;
+  quint16 Port = 0;
+  QString LocalPath;
+  ParaViewMCP::LatencyStats Latency;
+  // Requests from a connection not in this table are leftovers of a client
+  // that has already gone and are ignored.
+  QHash<quint64, Connection> Connections;
+  // Connections with queued requests, in the order they get their next turn.
+  QList<quint64> ReadyConnections;
+  // Python sessions of clients that disconnected, by resume token, until the
+  // client comes back or the grace period ends.
+  QHash<QString, quint64> ParkedSessions;
+  bool DispatchScheduled = false;
+  // The session Python currently runs in, so it is only switched on change.
+  quint64 ActiveSession = 0;
+  // Highest id already closed by stop(); an attach for it still in flight
+  // from the network thread must not bring the client back.
+  quint64 ClosedConnectionId = 0;
+  // The request handleRequest() is running; read by the network thread.
+  QMutex RunningMutex;
+  quint64 RunningConnection = 0;
+  QString RunningRequestId;
+  QElapsedTimer RunningTimer;
   IParaViewMCPPythonBridge& PythonBridge;
   ParaViewMCPRequestHandler& RequestHandler;
 };
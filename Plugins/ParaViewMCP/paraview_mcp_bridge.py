@@ -8,13 +8,66 @@ import io
 import json
 import os
 import tempfile
+import time
 import traceback
 from contextlib import redirect_stderr, redirect_stdout
 from typing import Any
 
-_SESSION_GLOBALS: dict[str, Any] | None = None
+# One namespace per connected client, keyed by the plugin's connection id, so
+# names defined by one client are invisible to the others. History and the
+# pipeline itself are shared.
+_SESSIONS: dict[int, dict[str, Any]] = {}
+_ACTIVE_SESSION: int = 0
 _HISTORY: list[dict] = []
 _NEXT_ID: int = 1
+# How many leading _HISTORY entries the plugin already holds. history_delta()
+# sends only what changed after them, so keeping the plugin's copy current
+# costs the same however long the history grows.
+_REPORTED: int = 0
+
+# inspect_pipeline() results are cached until the server manager reports a
+# change. _PIPELINE_GENERATION is bumped by proxy manager events and after
+# every script, which may have changed data without touching a proxy; the
+# cache is trusted only while those events are observed on the current proxy
+# manager.
+_PIPELINE_GENERATION: int = 0
+_OBSERVED_PROXY_MANAGER: Any = None
+_PIPELINE_CACHE: dict[str, Any] = {}
+# Versions handed to clients. The epoch keeps a token from an earlier plugin
+# run from matching this one's.
+_PIPELINE_EPOCH: str = os.urandom(4).hex()
+_PIPELINE_VERSION: int = 0
+_PIPELINE_EVENTS = (
+    "RegisterEvent",
+    "UnRegisterEvent",
+    "PropertyModifiedEvent",
+    "StateChangedEvent",
+)
+# Milliseconds spent in each phase of the running command, for clients that
+# asked the plugin for timings. Every command starts a fresh set.
+_TIMINGS: dict[str, float] = {}
+# True only while a script's own code runs; the plugin's interrupt raises
+# ExecutionCancelled then and nowhere else. A cancel that arrives before the
+# script starts is kept in _CANCEL_REQUESTED and stops it before its first
+# line; one that arrives after it finished is dropped, so the history entry
+# and cache invalidation around a script always complete. The plugin clears
+# _CANCEL_REQUESTED before each script.
+_IN_EXEC: bool = False
+_CANCEL_REQUESTED: bool = False
+# While a batch runs, paraview.simple.Render is replaced and the views its
+# scripts ask for are only noted, then rendered once after the last item.
+# _RENDER holds the real function meanwhile; both are None otherwise.
+_RENDER: Any = None
+_DEFERRED_RENDERS: list[tuple[Any, dict[str, Any]]] | None = None
+
+
+class ExecutionCancelled(BaseException):
+    """Raised inside a running script when its client cancels the request.
+
+    The plugin injects it between bytecodes from its network thread. It
+    derives from BaseException so a script's own ``except Exception`` does not
+    swallow it.
+    """
 
 
 def _new_session() -> dict[str, Any]:
@@ -36,10 +89,11 @@ def _new_session() -> dict[str, Any]:
 
 
 def _ensure_session() -> dict[str, Any]:
-    global _SESSION_GLOBALS
-    if _SESSION_GLOBALS is None:
-        _SESSION_GLOBALS = _new_session()
-    return _SESSION_GLOBALS
+    namespace = _SESSIONS.get(_ACTIVE_SESSION)
+    if namespace is None:
+        namespace = _new_session()
+        _SESSIONS[_ACTIVE_SESSION] = namespace
+    return namespace
 
 
 def _capture_snapshot() -> str | None:
@@ -108,25 +162,80 @@ def _log_readonly(command: str) -> None:
     _append_entry(command)
 
 
+def _record_phase(phase: str, started: float) -> float:
+    """Add the time since started to phase; returns now for the next phase."""
+    now = time.perf_counter()
+    _TIMINGS[phase] = _TIMINGS.get(phase, 0.0) + (now - started) * 1000.0
+    return now
+
+
+def take_timings() -> str:
+    """Return the phases measured since the last command began, then forget them."""
+    timings = {phase: round(elapsed, 3) for phase, elapsed in _TIMINGS.items()}
+    _TIMINGS.clear()
+    return json.dumps(timings)
+
+
 def bootstrap() -> str:
     _ensure_session()
     return json.dumps({"ok": True})
 
 
+def _slim_entry(entry: dict) -> dict:
+    slim = {k: v for k, v in entry.items() if k != "snapshot"}
+    slim["has_snapshot"] = entry.get("snapshot") is not None
+    return slim
+
+
+def _truncate_history(length: int) -> None:
+    global _HISTORY, _REPORTED
+    _HISTORY = _HISTORY[:length]
+    _REPORTED = min(_REPORTED, length)
+
+
 def get_history() -> str:
-    lightweight = []
-    for entry in _HISTORY:
-        slim = {k: v for k, v in entry.items() if k != "snapshot"}
-        slim["has_snapshot"] = entry.get("snapshot") is not None
-        lightweight.append(slim)
-    return json.dumps(lightweight)
+    return json.dumps([_slim_entry(entry) for entry in _HISTORY])
+
+
+def history_delta() -> str:
+    """Return what changed in the history since the last call.
+
+    The plugin keeps its first ``keep`` entries, drops any after them, and
+    appends ``append``.
+    """
+    global _REPORTED
+    keep = _REPORTED
+    appended = [_slim_entry(entry) for entry in _HISTORY[keep:]]
+    _REPORTED = len(_HISTORY)
+    return json.dumps({"keep": keep, "append": appended})
+
+
+def select_session(session_id: int) -> str:
+    """Make session_id's namespace the one later calls run in."""
+    global _ACTIVE_SESSION
+    _ACTIVE_SESSION = session_id
+    _ensure_session()
+    return json.dumps({"ok": True})
+
+
+def close_session(session_id: int) -> str:
+    _SESSIONS.pop(session_id, None)
+    return json.dumps({"ok": True})
 
 
 def reset_session() -> str:
-    global _SESSION_GLOBALS, _HISTORY, _NEXT_ID
-    _SESSION_GLOBALS = _new_session()
-    _HISTORY = []
-    _NEXT_ID = 1
+    """Start the active session over.
+
+    History is shared, so it is only cleared when no other session is open.
+    """
+    global _NEXT_ID
+    others = [key for key in _SESSIONS if key != _ACTIVE_SESSION]
+    if not others:
+        _SESSIONS.clear()
+        _truncate_history(0)
+        _NEXT_ID = 1
+    _SESSIONS[_ACTIVE_SESSION] = _new_session()
+    _pipeline_modified()
     return json.dumps({"ok": True})
 
 
@@ -135,9 +244,10 @@ def restore_snapshot(entry_id: int) -> str:
 
     Truncates history to entries before entry_id.
     """
-    global _SESSION_GLOBALS, _HISTORY, _NEXT_ID
+    global _NEXT_ID
     from paraview import simple
 
+    _TIMINGS.clear()
     target = None
     target_idx = None
     for idx, entry in enumerate(_HISTORY):
@@ -157,9 +267,12 @@ def restore_snapshot(entry_id: int) -> str:
             {"ok": False, "error": "Entry has no snapshot (read-only command)"}
         )
 
+    _pipeline_modified()
+    started = time.perf_counter()
     try:
         simple.ResetSession()
         exec(snapshot, {"__builtins__": __builtins__})
+        _record_phase("restore_ms", started)
     except Exception as exc:
         return json.dumps(
             {
@@ -169,16 +282,31 @@ def restore_snapshot(entry_id: int) -> str:
             }
         )
 
-    _HISTORY = _HISTORY[:target_idx]
+    _truncate_history(target_idx)
     _NEXT_ID = (_HISTORY[-1]["id"] + 1) if _HISTORY else 1
-    _SESSION_GLOBALS = _new_session()
+    # The restored pipeline replaced every proxy, so no session's names are
+    # valid any more.
+    _SESSIONS.clear()
 
     return json.dumps({"ok": True})
 
 
+def cancel_requested() -> bool:
+    """Called by the plugin's interrupt; True if it should raise right now."""
+    global _CANCEL_REQUESTED
+    if _IN_EXEC:
+        return True
+    _CANCEL_REQUESTED = True
+    return False
+
+
 def execute_python(code: str) -> str:
+    global _IN_EXEC
+    _TIMINGS.clear()
+    started = time.perf_counter()
     namespace = _ensure_session()
     snapshot = _capture_snapshot()
+    started = _record_phase("snapshot_ms", started)
     stdout_buffer = io.StringIO()
     stderr_buffer = io.StringIO()
     result = {
@@ -191,11 +319,25 @@ def execute_python(code: str) -> str:
 
     try:
         with redirect_stdout(stdout_buffer), redirect_stderr(stderr_buffer):
-            exec(code, namespace, namespace)
+            _IN_EXEC = True
+            try:
+                if _CANCEL_REQUESTED:
+                    raise ExecutionCancelled("Execution was cancelled by the client")
+                exec(code, namespace, namespace)
+            finally:
+                _IN_EXEC = False
+    except ExecutionCancelled as exc:
+        # Whatever the script assigned before it was stopped stays in the
+        # namespace; the session itself remains usable.
+        result["ok"] = False
+        result["cancelled"] = True
+        result["error"] = str(exc) or "Execution was cancelled"
+        result["traceback"] = traceback.format_exc()
     except Exception as exc:
         result["ok"] = False
         result["error"] = str(exc)
         result["traceback"] = traceback.format_exc()
+    started = _record_phase("exec_ms", started)
 
     result["stdout"] = stdout_buffer.getvalue()
     result["stderr"] = stderr_buffer.getvalue()
@@ -207,16 +349,160 @@ def execute_python(code: str) -> str:
         result={"stdout": result["stdout"], "error": result["error"]},
         status="ok" if result["ok"] else "error",
     )
+    _pipeline_modified()
+
+    text = json.dumps(result)
+    _record_phase("serialize_ms", started)
+    return text
+
+
+def _defer_render(view: Any = None, **params: Any) -> Any:
+    """Stand-in for paraview.simple.Render while renders are deferred."""
+    from paraview import simple
+
+    if view is None:
+        view = simple.GetActiveView()
+    if view is None or _DEFERRED_RENDERS is None:
+        return view
+    for deferred_view, deferred_params in _DEFERRED_RENDERS:
+        if deferred_view is view:
+            deferred_params.update(params)
+            return view
+    _DEFERRED_RENDERS.append((view, dict(params)))
+    return view
+
+
+def _swap_session_render(current: Any, replacement: Any) -> None:
+    # Scripts that ran "from paraview.simple import *" hold their own name.
+    for namespace in _SESSIONS.values():
+        if namespace.get("Render") is current:
+            namespace["Render"] = replacement
 
-    return json.dumps(result)
 
+def defer_renders(deferred: bool) -> str:
+    """Hold back Render() calls from scripts, or render what was held back.
 
-def inspect_pipeline() -> str:
+    Each view asked for while deferred is rendered once when deferral ends,
+    however many items of the batch rendered it.
+    """
+    global _RENDER, _DEFERRED_RENDERS
     from paraview import simple
 
+    if deferred:
+        if _RENDER is None:
+            _RENDER = simple.Render
+            _DEFERRED_RENDERS = []
+            simple.Render = _defer_render
+            _swap_session_render(_RENDER, _defer_render)
+        return json.dumps({"ok": True, "rendered": 0})
+
+    if _RENDER is None:
+        return json.dumps({"ok": True, "rendered": 0})
+    render, pending = _RENDER, _DEFERRED_RENDERS or []
+    simple.Render = render
+    _swap_session_render(_defer_render, render)
+    _RENDER = None
+    _DEFERRED_RENDERS = None
+
+    _TIMINGS.clear()
+    started = time.perf_counter()
+    for view, params in pending:
+        render(view, **params)
+    _record_phase("render_ms", started)
+    return json.dumps({"ok": True, "rendered": len(pending)})
+
+
+def _pipeline_modified(*_args: Any) -> None:
+    """Drop the cached inspect_pipeline() result."""
+    global _PIPELINE_GENERATION
+    _PIPELINE_GENERATION += 1
+
+
+def _observe_proxy_manager() -> bool:
+    """Watch the current proxy manager; False if changes cannot be observed."""
+    global _OBSERVED_PROXY_MANAGER
+    try:
+        from paraview import servermanager
+
+        proxy_manager = servermanager.ProxyManager().SMProxyManager
+    except Exception:
+        return False
+    if proxy_manager is None:
+        return False
+    if proxy_manager is _OBSERVED_PROXY_MANAGER:
+        return True
+    # A new session brings a new proxy manager; nothing cached survives it.
+    try:
+        for event in _PIPELINE_EVENTS:
+            proxy_manager.AddObserver(event, _pipeline_modified)
+    except Exception:
+        return False
+    _OBSERVED_PROXY_MANAGER = proxy_manager
+    _pipeline_modified()
+    return True
+
+
+def _proxy_key(proxy: Any) -> Any:
+    for method_name in ("GetGlobalIDAsString", "GetGlobalID"):
+        method = getattr(proxy, method_name, None)
+        if callable(method):
+            try:
+                return method()
+            except Exception:
+                continue
+    return id(proxy)
+
+
+def _animation_time(simple: Any) -> Any:
+    # Moving through time changes the data without a proxy manager event.
+    try:
+        return float(simple.GetAnimationScene().AnimationTime)
+    except Exception:
+        return None
+
+
+def inspect_pipeline(if_version: str = "") -> str:
+    """Describe the pipeline, or report that it is unchanged since if_version.
+
+    The walk over every source and property is skipped while the server
+    manager reports no change, no script has run, and the active view and
+    animation time are the same. A not_modified reply is not logged.
+    """
+    global _PIPELINE_CACHE, _PIPELINE_VERSION
+    from paraview import simple
+
+    _TIMINGS.clear()
     _ensure_session()
-    sources = []
+    observed = _observe_proxy_manager()
     active_view = simple.GetActiveView()
+    key = (
+        _PIPELINE_GENERATION,
+        None if active_view is None else _proxy_key(active_view),
+        _animation_time(simple),
+    )
+    cached = _PIPELINE_CACHE.get("json")
+    if not (observed and cached is not None and _PIPELINE_CACHE["key"] == key):
+        # Unobserved or stale: walk again, but keep the version when nothing
+        # in the result changed.
+        started = time.perf_counter()
+        body = _describe_pipeline(simple, active_view)
+        _record_phase("inspect_ms", started)
+        if body != _PIPELINE_CACHE.get("body"):
+            _PIPELINE_VERSION += 1
+            version = f"{_PIPELINE_EPOCH}-{_PIPELINE_VERSION}"
+            cached = body[:-1] + f',"version":"{version}"}}'
+        _PIPELINE_CACHE = {"key": key, "body": body, "json": cached}
+
+    version = f"{_PIPELINE_EPOCH}-{_PIPELINE_VERSION}"
+    if if_version and if_version == version:
+        return json.dumps({"not_modified": True, "version": version}, separators=(",", ":"))
+    _log_readonly("inspect_pipeline")
+    # The same str object every time, so its UTF-8 form is only built once.
+    return _PIPELINE_CACHE["json"]
+
+
+def _describe_pipeline(simple: Any, active_view: Any) -> str:
+    sources = []
 
     for name, proxy in simple.GetSources().items():
         entry = {
@@ -286,13 +572,19 @@ def inspect_pipeline() -> str:
 
         sources.append(entry)
 
-    _log_readonly("inspect_pipeline")
-    return json.dumps({"count": len(sources), "sources": sources})
+    # The plugin splices this text into its response verbatim, so keep it compact.
+    return json.dumps({"count": len(sources), "sources": sources}, separators=(",", ":"))
+
 
+def capture_screenshot(width: int, height: int, binary: bool = False) -> str | tuple[str, bytes]:
+    """Render the active view to PNG.
 
-def capture_screenshot(width: int, height: int) -> str:
+    With ``binary`` the raw PNG bytes are returned next to the JSON metadata so
+    the plugin can ship them as an attachment frame instead of base64 text.
+    """
     from paraview import simple
 
+    _TIMINGS.clear()
     _ensure_session()
     view = simple.GetActiveView()
     if view is None:
@@ -302,6 +594,7 @@ def capture_screenshot(width: int, height: int) -> str:
     try:
         with tempfile.NamedTemporaryFile(suffix=".png", delete=False) as handle:
             path = handle.name
+        started = time.perf_counter()
         simple.SaveScreenshot(
             path,
             view,
@@ -309,13 +602,18 @@ def capture_screenshot(width: int, height: int) -> str:
         )
         with open(path, "rb") as handle:
             image_bytes = handle.read()
+        started = _record_phase("render_ms", started)
         _log_readonly("capture_screenshot")
-        return json.dumps(
+        if binary:
+            return json.dumps({"format": "png"}), image_bytes
+        text = json.dumps(
             {
                 "format": "png",
                 "image_data": base64.b64encode(image_bytes).decode("ascii"),
             }
         )
+        _record_phase("serialize_ms", started)
+        return text
     finally:
         if path:
             try:
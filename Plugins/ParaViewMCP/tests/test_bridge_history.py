@@ -85,6 +85,77 @@ def test_history_captures_error(bridge) -> None:
     assert "boom" in entry["result"]["error"]
 
 
+def test_cancelled_execution_keeps_the_session(bridge) -> None:
+    bridge.bootstrap()
+    # What the plugin injects while the script runs; a script's own
+    # 'except Exception' must not swallow it.
+    code = (
+        "before = 1\n"
+        "try:\n"
+        "    raise __import__('paraview_mcp_bridge').ExecutionCancelled('Cancelled')\n"
+        "except Exception:\n"
+        "    pass\n"
+        "after = 2\n"
+    )
+    result = json.loads(bridge.execute_python(code))
+    assert result["ok"] is False
+    assert result["cancelled"] is True
+    assert result["error"] == "Cancelled"
+
+    result = json.loads(bridge.execute_python("print(before, 'after' in globals())"))
+    assert result["ok"] is True
+    assert result["stdout"] == "1 False\n"
+    history = json.loads(bridge.get_history())
+    assert history[0]["status"] == "error"
+
+
+def _interrupt(bridge) -> None:
+    """What the plugin's pending call does when a client cancels."""
+    if bridge.cancel_requested():
+        raise bridge.ExecutionCancelled("Execution was cancelled by the client")
+
+
+def test_cancel_after_the_script_keeps_its_bookkeeping(bridge, monkeypatch) -> None:
+    _observed_proxy_manager(monkeypatch)
+    simple = sys.modules["paraview.simple"]
+    bridge.bootstrap()
+    bridge.inspect_pipeline()
+    append_entry = bridge._append_entry
+
+    def cancel_then_append(*args, **kwargs):
+        _interrupt(bridge)
+        append_entry(*args, **kwargs)
+
+    monkeypatch.setattr(bridge, "_append_entry", cancel_then_append)
+    result = json.loads(bridge.execute_python("print('done')"))
+    assert result["ok"] is True
+    assert "cancelled" not in result
+    assert result["stdout"] == "done\n"
+
+    history = json.loads(bridge.get_history())
+    assert history[-1]["command"] == "execute_python"
+    assert history[-1]["status"] == "ok"
+    assert history[-1]["has_snapshot"] is True
+    bridge.inspect_pipeline()
+    assert simple.GetSources.call_count == 2
+
+
+def test_cancel_before_the_script_stops_it_first(bridge, monkeypatch) -> None:
+    bridge.bootstrap()
+    capture_snapshot = bridge._capture_snapshot
+
+    def cancel_then_capture():
+        _interrupt(bridge)
+        return capture_snapshot()
+
+    monkeypatch.setattr(bridge, "_capture_snapshot", cancel_then_capture)
+    result = json.loads(bridge.execute_python("ran = True"))
+    assert result["ok"] is False
+    assert result["cancelled"] is True
+    assert "ran" not in bridge._ensure_session()
+    assert json.loads(bridge.get_history())[-1]["status"] == "error"
+
+
 def test_inspect_pipeline_logged_without_snapshot(bridge) -> None:
     bridge.bootstrap()
     bridge.inspect_pipeline()
@@ -96,6 +167,127 @@ def test_inspect_pipeline_logged_without_snapshot(bridge) -> None:
     assert entry["status"] == "ok"
 
 
+def _observed_proxy_manager(monkeypatch: pytest.MonkeyPatch) -> list:
+    """Give the bridge a proxy manager and return the observers it installs."""
+    observers: list = []
+    proxy_manager = MagicMock()
+    proxy_manager.AddObserver.side_effect = lambda _event, callback: observers.append(callback)
+    sm_mod = sys.modules["paraview.servermanager"]
+    proxy_manager_wrapper = types.SimpleNamespace(SMProxyManager=proxy_manager)
+    monkeypatch.setattr(sm_mod, "ProxyManager", lambda: proxy_manager_wrapper, raising=False)
+    return observers
+
+
+def test_inspect_pipeline_not_modified_for_current_version(bridge) -> None:
+    bridge.bootstrap()
+    first = json.loads(bridge.inspect_pipeline())
+    assert first["count"] == 0
+    version = first["version"]
+
+    assert json.loads(bridge.inspect_pipeline(version)) == {
+        "not_modified": True,
+        "version": version,
+    }
+    assert json.loads(bridge.inspect_pipeline("stale"))["count"] == 0
+    # Only the calls answered in full are logged.
+    assert len(json.loads(bridge.get_history())) == 2
+
+
+def test_inspect_pipeline_cached_until_proxy_manager_event(bridge, monkeypatch) -> None:
+    observers = _observed_proxy_manager(monkeypatch)
+    simple = sys.modules["paraview.simple"]
+    bridge.bootstrap()
+    version = json.loads(bridge.inspect_pipeline())["version"]
+    assert observers
+    bridge.inspect_pipeline(version)
+    assert simple.GetSources.call_count == 1
+
+    # A change that does not alter the description keeps the version.
+    observers[0]()
+    assert json.loads(bridge.inspect_pipeline(version))["not_modified"] is True
+    assert simple.GetSources.call_count == 2
+
+    source = types.SimpleNamespace(ListProperties=lambda: [])
+    simple.GetSources.return_value = {("Sphere1", "1"): source}
+    observers[0]()
+    changed = json.loads(bridge.inspect_pipeline(version))
+    assert changed["count"] == 1
+    assert changed["version"] != version
+
+
+def test_scripts_and_time_invalidate_inspect_pipeline(bridge, monkeypatch) -> None:
+    _observed_proxy_manager(monkeypatch)
+    simple = sys.modules["paraview.simple"]
+    scene = types.SimpleNamespace(AnimationTime=0.0)
+    simple.GetAnimationScene = MagicMock(return_value=scene)  # type: ignore[attr-defined]
+    bridge.bootstrap()
+    bridge.inspect_pipeline()
+    bridge.inspect_pipeline()
+    assert simple.GetSources.call_count == 1
+
+    # A script may change data without any proxy manager event.
+    bridge.execute_python("x = 1")
+    bridge.inspect_pipeline()
+    assert simple.GetSources.call_count == 2
+
+    scene.AnimationTime = 1.0
+    bridge.inspect_pipeline()
+    assert simple.GetSources.call_count == 3
+
+
+def test_reset_and_restore_invalidate_inspect_pipeline(bridge, monkeypatch) -> None:
+    _observed_proxy_manager(monkeypatch)
+    simple = sys.modules["paraview.simple"]
+    bridge.bootstrap()
+    bridge.execute_python("x = 1")
+    bridge.inspect_pipeline()
+
+    bridge.reset_session()
+    bridge.inspect_pipeline()
+    assert simple.GetSources.call_count == 2
+
+    bridge.execute_python("y = 2")
+    bridge.execute_python("z = 3")
+    bridge.restore_snapshot(2)
+    bridge.inspect_pipeline()
+    assert simple.GetSources.call_count == 3
+
+
+def test_take_timings_reports_the_last_command(bridge) -> None:
+    bridge.bootstrap()
+    bridge.execute_python("x = 1")
+    timings = json.loads(bridge.take_timings())
+    assert set(timings) == {"snapshot_ms", "exec_ms", "serialize_ms"}
+    assert all(value >= 0 for value in timings.values())
+    assert json.loads(bridge.take_timings()) == {}
+
+    bridge.execute_python("y = 2")
+    bridge.inspect_pipeline()
+    assert set(json.loads(bridge.take_timings())) == {"inspect_ms"}
+
+
+def test_deferred_renders_run_once_per_view(bridge) -> None:
+    simple = sys.modules["paraview.simple"]
+    view = object()
+    simple.Render = MagicMock()  # type: ignore[attr-defined]
+    render = simple.Render
+    simple.GetActiveView.return_value = view
+    bridge.bootstrap()
+    bridge.execute_python("from paraview.simple import Render")
+
+    bridge.defer_renders(True)
+    bridge.execute_python("Render()")
+    bridge.execute_python("simple.Render()\nRender(ViewTime=2)")
+    assert render.call_count == 0
+    assert json.loads(bridge.defer_renders(False))["rendered"] == 1
+    render.assert_called_once_with(view, ViewTime=2)
+
+    # Renders are immediate again, including the session's imported name.
+    bridge.execute_python("Render()")
+    assert render.call_count == 2
+    assert json.loads(bridge.defer_renders(False))["rendered"] == 0
+
+
 def test_mixed_command_history(bridge) -> None:
     bridge.bootstrap()
     bridge.execute_python("x = 1")
@@ -201,3 +393,37 @@ def test_capture_screenshot_logged_in_history(bridge) -> None:
     assert history[0]["command"] == "capture_screenshot"
     assert history[0]["code"] is None
     assert history[0]["has_snapshot"] is False
+
+
+def test_history_delta_sends_only_new_entries(bridge) -> None:
+    bridge.bootstrap()
+    bridge.execute_python("x = 1")
+    delta = json.loads(bridge.history_delta())
+    assert delta["keep"] == 0
+    assert [entry["id"] for entry in delta["append"]] == [1]
+    assert "snapshot" not in delta["append"][0]
+
+    bridge.execute_python("y = 2")
+    bridge.inspect_pipeline()
+    delta = json.loads(bridge.history_delta())
+    assert delta["keep"] == 1
+    assert [entry["id"] for entry in delta["append"]] == [2, 3]
+
+    assert json.loads(bridge.history_delta()) == {"keep": 3, "append": []}
+
+
+def test_history_delta_reports_truncation(bridge) -> None:
+    bridge.bootstrap()
+    bridge.execute_python("x = 1")
+    bridge.execute_python("y = 2")
+    bridge.execute_python("z = 3")
+    bridge.history_delta()
+
+    bridge.restore_snapshot(2)
+    bridge.execute_python("w = 4")
+    delta = json.loads(bridge.history_delta())
+    assert delta["keep"] == 1
+    assert [entry["code"] for entry in delta["append"]] == ["w = 4"]
+
+    bridge.reset_session()
+    assert json.loads(bridge.history_delta()) == {"keep": 0, "append": []}
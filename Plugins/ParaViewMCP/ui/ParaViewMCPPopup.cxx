@@ -7,8 +7,7 @@
 #include <QFormLayout>
 #include <QGuiApplication>
 #include <QHBoxLayout>
-#include <QJsonArray>
-#include <QJsonDocument>
+#include <QJsonObject>
 #include <QLabel>
 #include <QLineEdit>
 #include <QMessageBox>
@@ -47,6 +46,11 @@ ParaViewMCPPopup::ParaViewMCPPopup(QWidget* parent)
   statusRow->addWidget(this->StatusDot);
   statusRow->addWidget(this->StatusText);
   statusRow->addStretch();
+  this->LatencyText = new QLabel(this);
+  this->LatencyText->setToolTip(
+    QStringLiteral("Heartbeat round trip to connected clients (median / p90 / p99)"));
+  this->LatencyText->setVisible(false);
+  statusRow->addWidget(this->LatencyText);
   layout->addLayout(statusRow);
 
   // --- Form fields ---
@@ -139,6 +143,11 @@ ParaViewMCPPopup::ParaViewMCPPopup(QWidget* parent)
                      this->applyAppearance(appearance.Label, appearance.Color);
                    });
 
+  QObject::connect(&controller,
+                   &ParaViewMCPBridgeController::latencyChanged,
+                   this,
+                   [this](const ParaViewMCP::LatencyStats& /*stats*/) { this->updateLatency(); });
+
   QObject::connect(&controller,
                    &ParaViewMCPBridgeController::historyChanged,
                    this,
@@ -209,10 +218,11 @@ void ParaViewMCPPopup::refreshFromController()
   this->HostField->setText(controller.host());
   this->PortField->setValue(static_cast<int>(controller.port()));
   this->TokenField->setText(controller.authToken());
-  this->rebuildHistoryEntries(controller.lastHistory());
+  this->applyHistoryDelta(ParaViewMCPHistoryDelta::replacing(controller.lastHistory()));
 
   const auto appearance = appearanceForState(controller.serverState());
   this->applyAppearance(appearance.Label, appearance.Color);
+  this->updateLatency();
 
   this->syncState();
 }
@@ -225,6 +235,16 @@ void ParaViewMCPPopup::applyAppearance(const char* label, const char* color)
   this->StatusText->setStyleSheet(QStringLiteral("color: %1;").arg(QLatin1String(color)));
 }
 
+void ParaViewMCPPopup::updateLatency()
+{
+  const ParaViewMCP::LatencyStats stats = ParaViewMCPBridgeController::instance().latencyStats();
+  this->LatencyText->setVisible(stats.Samples > 0);
+  this->LatencyText->setText(QStringLiteral("RTT %1 / %2 / %3 ms")
+                               .arg(stats.P50Ms, 0, 'f', 1)
+                               .arg(stats.P90Ms, 0, 'f', 1)
+                               .arg(stats.P99Ms, 0, 'f', 1));
+}
+
 void ParaViewMCPPopup::syncState()
 {
   const ParaViewMCPBridgeController& controller = ParaViewMCPBridgeController::instance();
@@ -237,9 +257,9 @@ void ParaViewMCPPopup::syncState()
   this->StopButton->setEnabled(listening);
 }
 
-void ParaViewMCPPopup::onHistoryChanged(const QString& historyJson)
+void ParaViewMCPPopup::onHistoryChanged(const ParaViewMCPHistoryDelta& delta)
 {
-  this->rebuildHistoryEntries(historyJson);
+  this->applyHistoryDelta(delta);
 }
 
 void ParaViewMCPPopup::onRestoreRequested(int entryId)
@@ -257,12 +277,12 @@ void ParaViewMCPPopup::onRestoreRequested(int entryId)
   }
 }
 
-void ParaViewMCPPopup::rebuildHistoryEntries(const QString& historyJson)
+void ParaViewMCPPopup::applyHistoryDelta(const ParaViewMCPHistoryDelta& delta)
 {
-  // Remove existing entry widgets (keep the trailing stretch)
-  while (this->HistoryLayout->count() > 1)
+  // Remove the entry widgets past the ones kept (and keep the trailing stretch)
+  while (this->HistoryLayout->count() - 1 > delta.Keep)
   {
-    QLayoutItem* item = this->HistoryLayout->takeAt(0);
+    QLayoutItem* item = this->HistoryLayout->takeAt(this->HistoryLayout->count() - 2);
     if (item->widget() != nullptr)
     {
       delete item->widget();
@@ -270,20 +290,16 @@ void ParaViewMCPPopup::rebuildHistoryEntries(const QString& historyJson)
     delete item;
   }
 
-  const QJsonDocument doc = QJsonDocument::fromJson(historyJson.toUtf8());
-  const QJsonArray entries = doc.array();
-
-  this->HistoryCountLabel->setText(QStringLiteral("(%1)").arg(entries.size()));
-
-  for (const auto& val : entries)
+  for (const QJsonObject& value : delta.Appended)
   {
-    auto* entry = new ParaViewMCPHistoryEntry(val.toObject(), this->HistoryContainer);
+    auto* entry = new ParaViewMCPHistoryEntry(value, this->HistoryContainer);
     QObject::connect(entry,
                      &ParaViewMCPHistoryEntry::restoreRequested,
                      this,
                      &ParaViewMCPPopup::onRestoreRequested);
     this->HistoryLayout->insertWidget(this->HistoryLayout->count() - 1, entry);
   }
+  this->HistoryCountLabel->setText(QStringLiteral("(%1)").arg(this->HistoryLayout->count() - 1));
 
   // Auto-scroll to bottom
   QMetaObject::invokeMethod(
@@ -9,6 +9,7 @@ class QScrollArea;
 class QSpinBox;
 class QToolButton;
 class QVBoxLayout;
+struct ParaViewMCPHistoryDelta;
 
 class ParaViewMCPPopup : public QFrame
 {
@@ -23,12 +24,14 @@ public:
 private:
   void syncState();
   void applyAppearance(const char* label, const char* color);
-  void onHistoryChanged(const QString& historyJson);
+  void updateLatency();
+  void onHistoryChanged(const ParaViewMCPHistoryDelta& delta);
   void onRestoreRequested(int entryId);
-  void rebuildHistoryEntries(const QString& historyJson);
+  void applyHistoryDelta(const ParaViewMCPHistoryDelta& delta);
 
   QLabel* StatusDot = nullptr;
   QLabel* StatusText = nullptr;
+  QLabel* LatencyText = nullptr;
   QLineEdit* HostField = nullptr;
   QSpinBox* PortField = nullptr;
   QLineEdit* TokenField = nullptr;
@@ -0,0 +1,427 @@
+#include "FakeParaViewMCPPythonBridge.h"
+#include "ParaViewMCPProtocol.h"
+#include "ParaViewMCPReadBuffer.h"
+#include "ParaViewMCPRequestHandler.h"
+#include "ParaViewMCPSocketBridge.h"
+#include "TestProtocolPayloads.h"
+#include "TestSocketHelpers.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QLocalSocket>
+#include <QObject>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <algorithm>
+
+// Codec and transport benchmarks for the bridge wire protocol. Every slot is
+// data-driven so the XML/CSV reports written by ctest carry one stable row per
+// case, which is what release-to-release comparisons key on. Keep row names
+// unchanged when touching a case; add a new row instead.
+class BenchmarkParaViewMCPProtocol : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void encodeFrames_data();
+  void encodeFrames();
+  void decodeFrames_data();
+  void decodeFrames();
+  void pipelinedFrames_data();
+  void pipelinedFrames();
+  void framesSplitAcrossReads_data();
+  void framesSplitAcrossReads();
+  void encodings_data();
+  void encodings();
+  void responseSerialization_data();
+  void responseSerialization();
+  void transportRoundTrip_data();
+  void transportRoundTrip();
+  void roundTripLatency_data();
+  void roundTripLatency();
+};
+
+namespace
+{
+  // execute_python reply carrying stdoutBytes of captured output.
+  QJsonObject executePythonResponse(qsizetype stdoutBytes)
+  {
+    return QJsonObject{
+      {"request_id", QStringLiteral("exec")},
+      {"status", QStringLiteral("success")},
+      {"result",
+       QJsonObject{
+         {"ok", true},
+         {"stdout", QString(stdoutBytes, QLatin1Char('x'))},
+         {"stderr", QString()},
+       }},
+    };
+  }
+
+  void addFrameSizeRows()
+  {
+    QTest::addColumn<QJsonObject>("message");
+    QTest::newRow("small") << QJsonObject{
+      {"request_id", QStringLiteral("1")},
+      {"type", QStringLiteral("ping")},
+      {"params", QJsonObject()},
+    };
+    QTest::newRow("medium") << executePythonResponse(64 * 1024);
+    QTest::newRow("huge") << executePythonResponse(16 * 1024 * 1024);
+  }
+
+  // Sends one request and spins the event loop without sleeping until its
+  // reply is decoded, so the time measured is the transport's, not a poll
+  // interval's.
+  bool roundTrip(QIODevice* client, const QByteArray& request, ParaViewMCPReadBuffer& buffer)
+  {
+    client->write(request);
+    QList<QJsonObject> messages;
+    QElapsedTimer timer;
+    timer.start();
+    while (messages.isEmpty() && timer.elapsed() < 2000)
+    {
+      QCoreApplication::processEvents();
+      buffer.readFrom(client);
+      if (!ParaViewMCP::tryExtractMessages(buffer, messages, nullptr))
+      {
+        return false;
+      }
+    }
+    return !messages.isEmpty();
+  }
+
+  // Nearest rank, as the heartbeat statistics use.
+  double percentile(QList<double> samples, int percent)
+  {
+    std::sort(samples.begin(), samples.end());
+    const qsizetype rank = (samples.size() * percent + 99) / 100;
+    return samples.at(qMax<qsizetype>(rank, 1) - 1);
+  }
+} // namespace
+
+void BenchmarkParaViewMCPProtocol::encodeFrames_data()
+{
+  addFrameSizeRows();
+}
+
+void BenchmarkParaViewMCPProtocol::encodeFrames()
+{
+  QFETCH(QJsonObject, message);
+
+  QBENCHMARK
+  {
+    const QByteArray frame = ParaViewMCP::encodeMessage(message);
+    QVERIFY(frame.size() > 4);
+  }
+}
+
+void BenchmarkParaViewMCPProtocol::decodeFrames_data()
+{
+  addFrameSizeRows();
+}
+
+void BenchmarkParaViewMCPProtocol::decodeFrames()
+{
+  QFETCH(QJsonObject, message);
+  const QByteArray frame = ParaViewMCP::encodeMessage(message);
+
+  QBENCHMARK
+  {
+    ParaViewMCPReadBuffer buffer;
+    buffer.append(frame);
+    QList<QJsonObject> messages;
+    ParaViewMCP::tryExtractMessages(buffer, messages, nullptr);
+    QCOMPARE(messages.size(), 1);
+  }
+}
+
+void BenchmarkParaViewMCPProtocol::pipelinedFrames_data()
+{
+  QTest::addColumn<int>("frameCount");
+  QTest::newRow("100 frames") << 100;
+  QTest::newRow("1000 frames") << 1000;
+  QTest::newRow("10000 frames") << 10000;
+}
+
+void BenchmarkParaViewMCPProtocol::pipelinedFrames()
+{
+  QFETCH(int, frameCount);
+  const QByteArray encoded = encodePipelinedPings(frameCount);
+
+  // Per-frame cost should stay flat across rows; the old front-erasing buffer
+  // grew quadratically with the number of frames delivered in one read.
+  QBENCHMARK
+  {
+    ParaViewMCPReadBuffer buffer;
+    buffer.append(encoded);
+    QList<QJsonObject> messages;
+    messages.reserve(frameCount);
+    ParaViewMCP::tryExtractMessages(buffer, messages, nullptr);
+    QCOMPARE(messages.size(), frameCount);
+  }
+}
+
+void BenchmarkParaViewMCPProtocol::framesSplitAcrossReads_data()
+{
+  QTest::addColumn<QJsonObject>("message");
+  QTest::addColumn<int>("readBytes");
+
+  const QJsonObject medium = executePythonResponse(64 * 1024);
+  const QJsonObject large = executePythonResponse(4 * 1024 * 1024);
+  QTest::newRow("medium 1460-byte reads") << medium << 1460;
+  QTest::newRow("medium 64KiB reads") << medium << 64 * 1024;
+  QTest::newRow("large 1460-byte reads") << large << 1460;
+  QTest::newRow("large 64KiB reads") << large << 64 * 1024;
+}
+
+void BenchmarkParaViewMCPProtocol::framesSplitAcrossReads()
+{
+  QFETCH(QJsonObject, message);
+  QFETCH(int, readBytes);
+  const QByteArray frame = ParaViewMCP::encodeMessage(message);
+
+  // Mirrors onSocketReadyRead(): append whatever arrived, then try to decode.
+  // A partial frame must cost one header peek per read, not a rescan.
+  QBENCHMARK
+  {
+    ParaViewMCPReadBuffer buffer;
+    QList<QJsonObject> messages;
+    for (qsizetype offset = 0; offset < frame.size(); offset += readBytes)
+    {
+      buffer.append(frame.mid(offset, readBytes));
+      ParaViewMCP::tryExtractMessages(buffer, messages, nullptr);
+    }
+    QCOMPARE(messages.size(), 1);
+  }
+}
+
+void BenchmarkParaViewMCPProtocol::encodings_data()
+{
+  QTest::addColumn<QJsonObject>("message");
+  QTest::addColumn<bool>("cbor");
+
+  const QJsonObject inspect = inspectPipelineResponse(200);
+  const QJsonObject screenshot = screenshotResponse(512 * 1024);
+  QTest::newRow("inspect_pipeline json") << inspect << false;
+  QTest::newRow("inspect_pipeline cbor") << inspect << true;
+  QTest::newRow("screenshot json") << screenshot << false;
+  QTest::newRow("screenshot cbor") << screenshot << true;
+}
+
+void BenchmarkParaViewMCPProtocol::encodings()
+{
+  QFETCH(QJsonObject, message);
+  QFETCH(bool, cbor);
+
+  ParaViewMCP::WireOptions wire;
+  wire.Cbor = cbor;
+  quint32 flags = 0;
+  qInfo("frame size: %lld bytes",
+        static_cast<long long>(ParaViewMCP::serializeMessage(message, wire, &flags).size()));
+
+  // One iteration is a full send/receive: serialize, frame and parse back.
+  QBENCHMARK
+  {
+    quint32 frameFlags = 0;
+    QByteArray buffer = ParaViewMCP::encodeFrame(
+      ParaViewMCP::serializeMessage(message, wire, &frameFlags), frameFlags);
+    QList<QJsonObject> messages;
+    ParaViewMCP::tryExtractMessages(buffer, messages, nullptr, wire);
+    QCOMPARE(messages.size(), 1);
+  }
+}
+
+void BenchmarkParaViewMCPProtocol::responseSerialization_data()
+{
+  QTest::addColumn<bool>("splice");
+  QTest::newRow("parse and rebuild") << false;
+  QTest::newRow("splice raw result") << true;
+}
+
+void BenchmarkParaViewMCPProtocol::responseSerialization()
+{
+  QFETCH(bool, splice);
+  const QByteArray rawResult = QJsonDocument(inspectPipelineResponse(2000)
+                                               .value(QStringLiteral("result"))
+                                               .toObject())
+                                 .toJson(QJsonDocument::Compact);
+  const QJsonObject envelope{
+    {"request_id", QStringLiteral("inspect")},
+    {"status", QStringLiteral("success")},
+  };
+
+  // Starts from the helper's JSON text, as the handler does, and ends with
+  // the bytes that go on the wire.
+  QBENCHMARK
+  {
+    QByteArray payload;
+    if (splice)
+    {
+      payload = ParaViewMCP::serializeEnvelope(envelope, rawResult);
+    }
+    else
+    {
+      QJsonObject message = envelope;
+      message.insert(QStringLiteral("result"), QJsonDocument::fromJson(rawResult).object());
+      payload = ParaViewMCP::serializeMessage(message);
+    }
+    QVERIFY(payload.size() > rawResult.size());
+  }
+}
+
+void BenchmarkParaViewMCPProtocol::transportRoundTrip_data()
+{
+  QTest::addColumn<bool>("localSocket");
+  QTest::newRow("tcp loopback") << false;
+  QTest::newRow("local socket") << true;
+}
+
+void BenchmarkParaViewMCPProtocol::transportRoundTrip()
+{
+  QFETCH(bool, localSocket);
+  FakeParaViewMCPPythonBridge pythonBridge;
+  ParaViewMCPRequestHandler handler(pythonBridge);
+  ParaViewMCPSocketBridge bridge(pythonBridge, handler);
+
+  QTemporaryDir directory;
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("127.0.0.1");
+  config.Port = 0;
+  if (localSocket)
+  {
+    config.SocketPath = directory.filePath(QStringLiteral("bench.sock"));
+  }
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+
+  QTcpSocket tcpClient;
+  QLocalSocket localClient;
+  QIODevice* client = &tcpClient;
+  if (localSocket)
+  {
+    QVERIFY2(connectLocalSocket(localClient, bridge.socketPath(), &error), qPrintable(error));
+    client = &localClient;
+  }
+  else
+  {
+    QVERIFY2(connectClientSocket(tcpClient, bridge.serverPort(), &error), qPrintable(error));
+  }
+
+  ParaViewMCPReadBuffer buffer;
+  QVERIFY(roundTrip(client,
+                    ParaViewMCP::encodeMessage(QJsonObject{
+                      {"request_id", QStringLiteral("hello")},
+                      {"type", QStringLiteral("hello")},
+                      {"protocol_version", ParaViewMCP::ProtocolVersion},
+                      {"auth_token", QString()},
+                    }),
+                    buffer));
+
+  // A ping is answered on the network thread without touching Python, so
+  // this is the framing and transport cost of one request/response pair
+  // through the real bridge.
+  const QByteArray ping = ParaViewMCP::encodeMessage(QJsonObject{
+    {"request_id", QStringLiteral("ping")},
+    {"type", QStringLiteral("ping")},
+    {"params", QJsonObject()},
+  });
+  QBENCHMARK
+  {
+    QVERIFY(roundTrip(client, ping, buffer));
+  }
+
+  bridge.stop();
+}
+
+void BenchmarkParaViewMCPProtocol::roundTripLatency_data()
+{
+  QTest::addColumn<bool>("lowLatency");
+  QTest::addColumn<int>("responseBytes");
+  QTest::newRow("small nagle") << false << 0;
+  QTest::newRow("small low latency") << true << 0;
+  QTest::newRow("large nagle") << false << 1024 * 1024;
+  QTest::newRow("large low latency") << true << 1024 * 1024;
+}
+
+void BenchmarkParaViewMCPProtocol::roundTripLatency()
+{
+  QFETCH(bool, lowLatency);
+  QFETCH(int, responseBytes);
+  FakeParaViewMCPPythonBridge pythonBridge;
+  pythonBridge.ExecutePayload = QJsonObject{
+    {"ok", true},
+    {"stdout", QString(responseBytes, QLatin1Char('x'))},
+    {"stderr", QString()},
+  };
+  ParaViewMCPRequestHandler handler(pythonBridge);
+  ParaViewMCPSocketBridge bridge(pythonBridge, handler);
+
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("127.0.0.1");
+  config.Port = 0;
+  config.LowLatency = lowLatency;
+  config.SocketBufferBytes = lowLatency ? ParaViewMCP::DefaultSocketBufferBytes : 0;
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+
+  QTcpSocket client;
+  QVERIFY2(connectClientSocket(client, bridge.serverPort(), &error), qPrintable(error));
+  if (lowLatency)
+  {
+    client.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+  }
+  ParaViewMCPReadBuffer buffer;
+  QVERIFY(roundTrip(&client,
+                    ParaViewMCP::encodeMessage(QJsonObject{
+                      {"request_id", QStringLiteral("hello")},
+                      {"type", QStringLiteral("hello")},
+                      {"protocol_version", ParaViewMCP::ProtocolVersion},
+                      {"auth_token", QString()},
+                    }),
+                    buffer));
+
+  // Small rows ping the network thread; large ones go through the GUI thread
+  // and come back as a 1 MiB execute_python reply.
+  const QByteArray request = ParaViewMCP::encodeMessage(QJsonObject{
+    {"request_id", QStringLiteral("request")},
+    {"type", responseBytes > 0 ? QStringLiteral("execute_python") : QStringLiteral("ping")},
+    {"params", QJsonObject{{"code", QStringLiteral("pass")}}},
+  });
+  constexpr int RoundTrips = 200;
+  QList<double> samples;
+  samples.reserve(RoundTrips);
+  QElapsedTimer timer;
+  for (int index = 0; index < RoundTrips; ++index)
+  {
+    timer.start();
+    QVERIFY(roundTrip(&client, request, buffer));
+    samples.append(static_cast<double>(timer.nsecsElapsed()) / 1.0e6);
+  }
+
+  // The reports carry the median; the tail goes to the log next to it.
+  const double p50 = percentile(samples, 50);
+  qInfo("p50 %.3f ms, p99 %.3f ms over %d round trips",
+        p50,
+        percentile(samples, 99),
+        RoundTrips);
+  QTest::setBenchmarkResult(p50, QTest::WalltimeMilliseconds);
+
+  bridge.stop();
+}
+
+QTEST_GUILESS_MAIN(BenchmarkParaViewMCPProtocol)
+
+#include "BenchmarkParaViewMCPProtocol.moc"
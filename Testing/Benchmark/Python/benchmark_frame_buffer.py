@@ -0,0 +1,123 @@
+"""FrameBuffer benchmarks mirroring the C++ ParaViewMCPBenchmarks cases.
+
+Run directly or through ``ctest -L benchmark``. Results print as a table and,
+with ``--output``, are written as JSON (or CSV for a ``.csv`` path) keyed by
+the same ``case/row`` names the Qt Test reports use.
+"""
+
+from __future__ import annotations
+
+import argparse
+import csv
+import json
+import sys
+import timeit
+from collections.abc import Callable
+from pathlib import Path
+from typing import Any
+
+sys.path.insert(0, str(Path(__file__).resolve().parents[3] / "Wrapping/Python/MCPServer/src"))
+
+from paraview_mcp.protocol import FrameBuffer, encode_message  # noqa: E402
+
+MIN_SECONDS = 0.2
+
+
+def _ping(index: int) -> dict[str, Any]:
+    return {"request_id": str(index), "type": "ping", "params": {}}
+
+
+def _execute_python_response(stdout_bytes: int) -> dict[str, Any]:
+    return {
+        "request_id": "exec",
+        "status": "success",
+        "result": {"ok": True, "stdout": "x" * stdout_bytes, "stderr": ""},
+    }
+
+
+FRAME_SIZES = {
+    "small": _ping(1),
+    "medium": _execute_python_response(64 * 1024),
+    "huge": _execute_python_response(16 * 1024 * 1024),
+}
+
+
+def _decode(frame: bytes, expected: int) -> Callable[[], None]:
+    def run() -> None:
+        messages = FrameBuffer().feed(frame)
+        assert len(messages) == expected
+
+    return run
+
+
+def _split(frame: bytes, read_bytes: int) -> Callable[[], None]:
+    reads = [frame[offset : offset + read_bytes] for offset in range(0, len(frame), read_bytes)]
+
+    def run() -> None:
+        buffer = FrameBuffer()
+        messages = []
+        for chunk in reads:
+            messages.extend(buffer.feed(chunk))
+        assert len(messages) == 1
+
+    return run
+
+
+def _cases() -> list[tuple[str, Callable[[], None]]]:
+    cases: list[tuple[str, Callable[[], None]]] = []
+    for row, message in FRAME_SIZES.items():
+        cases.append((f"encodeFrames/{row}", lambda message=message: encode_message(message)))
+    for row, message in FRAME_SIZES.items():
+        cases.append((f"decodeFrames/{row}", _decode(encode_message(message), 1)))
+    for count in (100, 1000, 10000):
+        pipelined = b"".join(encode_message(_ping(index)) for index in range(count))
+        cases.append((f"pipelinedFrames/{count} frames", _decode(pipelined, count)))
+    medium = encode_message(_execute_python_response(64 * 1024))
+    large = encode_message(_execute_python_response(4 * 1024 * 1024))
+    for name, frame in (("medium", medium), ("large", large)):
+        cases.append((f"framesSplitAcrossReads/{name} 1460-byte reads", _split(frame, 1460)))
+        cases.append((f"framesSplitAcrossReads/{name} 64KiB reads", _split(frame, 64 * 1024)))
+    return cases
+
+
+def _measure(run: Callable[[], None]) -> dict[str, float | int]:
+    timer = timeit.Timer(run)
+    iterations, elapsed = timer.autorange()
+    while elapsed < MIN_SECONDS:
+        iterations *= 2
+        elapsed = timer.timeit(iterations)
+    return {"iterations": iterations, "msecs_per_iteration": elapsed * 1000.0 / iterations}
+
+
+def _write(path: Path, results: list[dict[str, Any]]) -> None:
+    path.parent.mkdir(parents=True, exist_ok=True)
+    if path.suffix == ".csv":
+        with path.open("w", newline="") as handle:
+            writer = csv.DictWriter(handle, fieldnames=list(results[0]))
+            writer.writeheader()
+            writer.writerows(results)
+    else:
+        path.write_text(json.dumps({"python": sys.version, "results": results}, indent=2) + "\n")
+
+
+def main(argv: list[str] | None = None) -> int:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--output", type=Path, help="write results to this .json or .csv file")
+    parser.add_argument("--filter", default="", help="only run cases containing this text")
+    args = parser.parse_args(argv)
+
+    results = []
+    for name, run in _cases():
+        if args.filter not in name:
+            continue
+        result = {"name": name, **_measure(run)}
+        print(f"{name:<48} {result['msecs_per_iteration']:>12.4f} msecs/iter")
+        results.append(result)
+
+    if args.output and results:
+        _write(args.output, results)
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -2,6 +2,12 @@
 
 #include "IParaViewMCPPythonBridge.h"
 
+#include <QJsonDocument>
+#include <QList>
+
+#include <atomic>
+#include <functional>
+
 class FakeParaViewMCPPythonBridge : public IParaViewMCPPythonBridge
 {
 public:
@@ -26,12 +32,23 @@ public:
     {"format", QStringLiteral("png")},
     {"image_data", QStringLiteral("ZmFrZQ==")},
   };
+  QByteArray ScreenshotBytes = QByteArrayLiteral("fake");
 
   int ResetCalls = 0;
+  quint64 ActiveSession = 0;
+  QList<quint64> ClosedSessions;
   int ExecuteCalls = 0;
   int InspectCalls = 0;
   int ScreenshotCalls = 0;
+  int BinaryScreenshotCalls = 0;
   QString LastCode;
+  QString LastIfVersion;
+  // Runs inside executePython(), i.e. while the GUI thread is busy.
+  std::function<void()> ExecuteHook;
+  // interrupt() comes from the network thread while the hook runs.
+  std::atomic<bool> Executing{false};
+  std::atomic<bool> Interrupted{false};
+  std::atomic<int> InterruptCalls{0};
   int LastWidth = 0;
   int LastHeight = 0;
 
@@ -55,6 +72,18 @@ public:
     return this->Ready;
   }
 
+  bool selectSession(quint64 sessionId, QString* /*error*/ = nullptr) override
+  {
+    this->ActiveSession = sessionId;
+    return true;
+  }
+
+  bool closeSession(quint64 sessionId, QString* /*error*/ = nullptr) override
+  {
+    this->ClosedSessions.push_back(sessionId);
+    return true;
+  }
+
   bool resetSession(QString* error = nullptr) override
   {
     ++this->ResetCalls;
@@ -69,6 +98,25 @@ public:
   {
     ++this->ExecuteCalls;
     this->LastCode = code;
+    this->Executing = true;
+    if (this->ExecuteHook)
+    {
+      this->ExecuteHook();
+    }
+    this->Executing = false;
+    if (this->Interrupted.exchange(false))
+    {
+      if (result != nullptr)
+      {
+        *result = QJsonObject{
+          {"ok", false},
+          {"cancelled", true},
+          {"stdout", QStringLiteral("partial")},
+          {"stderr", QString()},
+        };
+      }
+      return true;
+    }
     if (!this->ExecuteResult)
     {
       if (error != nullptr)
@@ -84,9 +132,23 @@ public:
     return true;
   }
 
-  bool inspectPipeline(QJsonObject* result, QString* error = nullptr) override
+  bool interrupt() override
+  {
+    ++this->InterruptCalls;
+    if (!this->Executing)
+    {
+      return false;
+    }
+    this->Interrupted = true;
+    return true;
+  }
+
+  bool inspectPipeline(const QString& ifVersion,
+                       QByteArray* resultJson,
+                       QString* error = nullptr) override
   {
     ++this->InspectCalls;
+    this->LastIfVersion = ifVersion;
     if (!this->InspectResult)
     {
       if (error != nullptr)
@@ -95,9 +157,9 @@ public:
       }
       return false;
     }
-    if (result != nullptr)
+    if (resultJson != nullptr)
     {
-      *result = this->InspectPayload;
+      *resultJson = QJsonDocument(this->InspectPayload).toJson(QJsonDocument::Compact);
     }
     return true;
   }
@@ -123,6 +185,34 @@ public:
     return true;
   }
 
+  bool captureScreenshotBinary(int width,
+                               int height,
+                               QJsonObject* result,
+                               QByteArray* imageData,
+                               QString* error = nullptr) override
+  {
+    ++this->BinaryScreenshotCalls;
+    this->LastWidth = width;
+    this->LastHeight = height;
+    if (!this->ScreenshotResult)
+    {
+      if (error != nullptr)
+      {
+        *error = this->ScreenshotError;
+      }
+      return false;
+    }
+    if (result != nullptr)
+    {
+      *result = QJsonObject{{"format", QStringLiteral("png")}};
+    }
+    if (imageData != nullptr)
+    {
+      *imageData = this->ScreenshotBytes;
+    }
+    return true;
+  }
+
   bool getHistory(QJsonArray* result, QString* /*error*/ = nullptr) override
   {
     if (result != nullptr)
@@ -132,6 +222,24 @@ public:
     return true;
   }
 
+  // Reports the HistoryPayload entries past the ones reported last time.
+  bool historyDelta(QJsonObject* result, QString* /*error*/ = nullptr) override
+  {
+    ++this->HistoryDeltaCalls;
+    const int keep = qMin(this->ReportedHistory, static_cast<int>(this->HistoryPayload.size()));
+    QJsonArray appended;
+    for (int index = keep; index < this->HistoryPayload.size(); ++index)
+    {
+      appended.append(this->HistoryPayload.at(index));
+    }
+    this->ReportedHistory = static_cast<int>(this->HistoryPayload.size());
+    if (result != nullptr)
+    {
+      *result = QJsonObject{{"keep", keep}, {"append", appended}};
+    }
+    return true;
+  }
+
   bool restoreSnapshot(int entryId, QJsonObject* result, QString* error = nullptr) override
   {
     this->LastRestoreEntryId = entryId;
@@ -150,6 +258,31 @@ public:
     return true;
   }
 
+  bool setRendersDeferred(bool deferred, QString* /*error*/ = nullptr) override
+  {
+    this->RendersDeferred = deferred;
+    this->DeferralCalls.push_back(deferred);
+    return true;
+  }
+
+  void setTimingsEnabled(bool enabled) override
+  {
+    this->TimingsEnabled = enabled;
+  }
+
+  QJsonObject takeTimings() override
+  {
+    return this->TimingsEnabled ? this->TimingsPayload : QJsonObject();
+  }
+
   QJsonArray HistoryPayload;
+  // Reported by takeTimings() while timings are enabled.
+  QJsonObject TimingsPayload = QJsonObject{{"exec_ms", 1.5}};
+  bool TimingsEnabled = false;
+  int ReportedHistory = 0;
+  int HistoryDeltaCalls = 0;
   int LastRestoreEntryId = 0;
+  bool RendersDeferred = false;
+  // Every setRendersDeferred() argument, in order.
+  QList<bool> DeferralCalls;
 };
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ParaViewMCPProtocol.h"
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+// Framing shortcuts for tests and benchmarks. The plugin itself sends through
+// ParaViewMCPOutboundQueue and receives through ParaViewMCPReadBuffer; these
+// build or parse whole frames in one QByteArray so a test can script both ends.
+namespace ParaViewMCP
+{
+  inline QByteArray encodeMessage(const QJsonObject& message)
+  {
+    return encodeFrame(serializeMessage(message));
+  }
+
+  inline QByteArray encodeAttachment(const Attachment& attachment)
+  {
+    return encodeFrame(attachment.Data, FrameFlagBinary);
+  }
+
+  // Writes one logical payload. Payloads above maxFrameBytes are streamed as
+  // bounded chunks; every chunk but the last carries FrameFlagContinued and all
+  // of them carry the payload's own flags.
+  inline void writeFrames(QIODevice* device,
+                          const QByteArray& payload,
+                          quint32 flags = 0,
+                          quint32 maxFrameBytes = MaxFrameBytes)
+  {
+    const qsizetype chunkBytes = static_cast<qsizetype>(maxFrameBytes);
+    if (payload.size() <= chunkBytes)
+    {
+      writeFrame(device, payload.constData(), payload.size(), flags);
+      return;
+    }
+
+    for (qsizetype offset = 0; offset < payload.size(); offset += chunkBytes)
+    {
+      const qsizetype length = qMin(chunkBytes, payload.size() - offset);
+      const bool lastChunk = offset + length == payload.size();
+      writeFrame(device,
+                 payload.constData() + offset,
+                 length,
+                 lastChunk ? flags : flags | FrameFlagContinued);
+    }
+  }
+
+  inline bool tryExtractMessages(QByteArray& buffer,
+                                 QList<QJsonObject>& messages,
+                                 QString* error,
+                                 const WireOptions& wire = WireOptions())
+  {
+    qsizetype consumed = 0;
+    qsizetype pending = 0;
+    const bool ok = detail::extractFrames(
+      buffer.constData(), buffer.size(), &consumed, &pending, messages, error, wire, nullptr);
+    buffer.remove(0, consumed);
+    return ok;
+  }
+} // namespace ParaViewMCP
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ParaViewMCPProtocol.h"
+#include "TestProtocolFraming.h"
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+
+inline QByteArray encodePipelinedPings(int count)
+{
+  QByteArray encoded;
+  for (int index = 0; index < count; ++index)
+  {
+    encoded.append(ParaViewMCP::encodeMessage(QJsonObject{
+      {"request_id", QString::number(index)},
+      {"type", QStringLiteral("ping")},
+      {"params", QJsonObject()},
+    }));
+  }
+  return encoded;
+}
+
+// Shaped like a real inspect_pipeline reply: a list of sources with their
+// proxy metadata and a handful of typed properties each.
+inline QJsonObject inspectPipelineResponse(int sourceCount)
+{
+  QJsonArray sources;
+  for (int index = 0; index < sourceCount; ++index)
+  {
+    sources.append(QJsonObject{
+      {"name", QStringLiteral("Source%1").arg(index)},
+      {"id", QString::number(1000 + index)},
+      {"proxy_type", QStringLiteral("Contour")},
+      {"representation", QStringLiteral("Surface")},
+      {"properties",
+       QJsonObject{
+         {"ContourBy", QJsonArray{QStringLiteral("POINTS"), QStringLiteral("RTData")}},
+         {"Isosurfaces", QJsonArray{97.5, 157.1, 216.8}},
+         {"ComputeNormals", 1},
+         {"Opacity", 0.75},
+       }},
+    });
+  }
+  return QJsonObject{
+    {"request_id", QStringLiteral("inspect")},
+    {"status", QStringLiteral("success")},
+    {"result", QJsonObject{{"count", sourceCount}, {"sources", sources}}},
+  };
+}
+
+// Screenshot reply for clients without binary attachments: the PNG travels
+// as base64 text in either encoding.
+inline QJsonObject screenshotResponse(qsizetype imageBytes)
+{
+  QByteArray image(imageBytes, Qt::Uninitialized);
+  for (qsizetype index = 0; index < imageBytes; ++index)
+  {
+    image[index] = static_cast<char>((index * 2654435761u) >> 24);
+  }
+  return QJsonObject{
+    {"request_id", QStringLiteral("screenshot")},
+    {"status", QStringLiteral("success")},
+    {"result",
+     QJsonObject{
+       {"format", QStringLiteral("png")},
+       {"width", 1600},
+       {"height", 900},
+       {"image_data", QString::fromLatin1(image.toBase64())},
+     }},
+  };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ParaViewMCPProtocol.h"
+#include "TestProtocolFraming.h"
 
 #include <QCoreApplication>
 #include <QElapsedTimer>
@@ -8,6 +9,7 @@
 #include <QHostAddress>
 #include <QJsonObject>
 #include <QList>
+#include <QLocalSocket>
 #include <QString>
 #include <QTcpSocket>
 #include <QTest>
@@ -41,14 +43,50 @@ connectClientSocket(QTcpSocket& socket, quint16 port, QString* error, int timeou
   return false;
 }
 
+inline bool connectLocalSocket(QLocalSocket& socket,
+                               const QString& path,
+                               QString* error,
+                               int timeoutMs = 5000)
+{
+  socket.connectToServer(path);
+
+  QElapsedTimer timer;
+  timer.start();
+  while (timer.elapsed() < timeoutMs)
+  {
+    QCoreApplication::processEvents(QEventLoop::AllEvents, 20);
+    if (socket.state() == QLocalSocket::ConnectedState || socket.bytesAvailable() > 0)
+    {
+      return true;
+    }
+    if (socket.state() == QLocalSocket::UnconnectedState)
+    {
+      break;
+    }
+    QTest::qWait(10);
+  }
+
+  if (error != nullptr)
+  {
+    *error = QStringLiteral("Could not connect the test socket to %1").arg(path);
+  }
+  return false;
+}
+
 inline void writeJsonFrame(QTcpSocket& socket, const QJsonObject& message)
 {
   socket.write(ParaViewMCP::encodeMessage(message));
   socket.flush();
 }
 
+inline void writeJsonFrame(QLocalSocket& socket, const QJsonObject& message)
+{
+  socket.write(ParaViewMCP::encodeMessage(message));
+  socket.flush();
+}
+
 inline bool
-waitForJsonMessage(QTcpSocket& socket, QJsonObject* message, QString* error, int timeoutMs = 2000)
+waitForJsonMessage(QIODevice& socket, QJsonObject* message, QString* error, int timeoutMs = 2000)
 {
   QByteArray buffer;
   QList<QJsonObject> messages;
@@ -91,3 +129,47 @@ waitForJsonMessage(QTcpSocket& socket, QJsonObject* message, QString* error, int
   }
   return false;
 }
+
+// Collects exactly 'count' messages, keeping every frame that arrives in the
+// same read instead of discarding all but the first.
+inline bool waitForJsonMessages(QIODevice& socket,
+                                int count,
+                                QList<QJsonObject>* messages,
+                                QString* error,
+                                int timeoutMs = 2000)
+{
+  QByteArray buffer;
+  QElapsedTimer timer;
+  timer.start();
+
+  while (timer.elapsed() < timeoutMs)
+  {
+    QCoreApplication::processEvents(QEventLoop::AllEvents, 20);
+    const QByteArray chunk = socket.readAll();
+    if (!chunk.isEmpty())
+    {
+      buffer.append(chunk);
+      QString parseError;
+      if (!ParaViewMCP::tryExtractMessages(buffer, *messages, &parseError))
+      {
+        if (error != nullptr)
+        {
+          *error = parseError;
+        }
+        return false;
+      }
+    }
+
+    if (messages->size() >= count)
+    {
+      return true;
+    }
+    QTest::qWait(10);
+  }
+
+  if (error != nullptr)
+  {
+    *error = QStringLiteral("Timed out waiting for %1 framed JSON messages").arg(count);
+  }
+  return false;
+}
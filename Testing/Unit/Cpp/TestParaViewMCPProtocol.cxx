@@ -1,9 +1,19 @@
+#include "ParaViewMCPHeartbeat.h"
+#include "ParaViewMCPOutboundQueue.h"
 #include "ParaViewMCPProtocol.h"
+#include "ParaViewMCPReadBuffer.h"
+#include "ParaViewMCPSharedRegion.h"
+#include "TestProtocolFraming.h"
+#include "TestProtocolPayloads.h"
 
+#include <QBuffer>
 #include <QByteArray>
+#include <QFile>
+#include <QJsonDocument>
 #include <QJsonObject>
 #include <QList>
 #include <QObject>
+#include <QThread>
 #include <QtTest>
 
 class TestParaViewMCPProtocol : public QObject
@@ -15,10 +25,90 @@ private slots:
   void decodesBackToBackFrames();
   void waitsForPartialFrames();
   void rejectsOversizedFrames();
+  void enforcesTheNegotiatedFrameLimit();
   void rejectsMalformedJson();
   void detectsLoopbackHosts();
+  void encodesFlaggedAttachmentFrames();
+  void streamsOversizedPayloadsAsChunks();
+  void writesFramesWithoutCopyingThePayload();
+  void roundTripsCompressedFrames();
+  void rejectsCompressedFramesWithoutNegotiation();
+  void rejectsCompressedFramesInflatingPastTheFrameLimit();
+  void roundTripsCborFrames();
+  void splicesRawResultsIntoEnvelopes();
+  void readBufferDecodesPipelinedFrames();
+  void readBufferKeepsPartialTailAcrossAppends();
+  void readBufferReservesAnnouncedFrames();
+  void readBufferDoesNotReserveForOversizedHeaders();
+  void sharedRegionReusesReleasedSpace();
+  void outboundQueuePausesAboveTheHighWatermark();
+  void heartbeatTracksRoundTripsAndSilence();
 };
 
+namespace
+{
+  // Unbuffered sink that records where each write() came from instead of
+  // copying it, so tests can tell whether a payload was duplicated on the way.
+  class RecordingDevice : public QIODevice
+  {
+  public:
+    struct Write
+    {
+      const char* Data;
+      qint64 Length;
+    };
+
+    QList<Write> Writes;
+
+  protected:
+    qint64 readData(char* data, qint64 maxSize) override
+    {
+      Q_UNUSED(data);
+      Q_UNUSED(maxSize);
+      return -1;
+    }
+
+    qint64 writeData(const char* data, qint64 maxSize) override
+    {
+      this->Writes.append(Write{data, maxSize});
+      return maxSize;
+    }
+  };
+
+  // Keeps what was written as "not yet sent" until the test calls send().
+  class HoldingDevice : public QIODevice
+  {
+  public:
+    QByteArray Held;
+    QByteArray Sent;
+
+    void send()
+    {
+      this->Sent.append(this->Held);
+      this->Held.clear();
+    }
+
+    qint64 bytesToWrite() const override
+    {
+      return this->Held.size();
+    }
+
+  protected:
+    qint64 readData(char* data, qint64 maxSize) override
+    {
+      Q_UNUSED(data);
+      Q_UNUSED(maxSize);
+      return -1;
+    }
+
+    qint64 writeData(const char* data, qint64 maxSize) override
+    {
+      this->Held.append(data, maxSize);
+      return maxSize;
+    }
+  };
+} // namespace
+
 void TestParaViewMCPProtocol::encodesAndDecodesSingleFrame()
 {
   const QJsonObject payload{
@@ -90,6 +180,32 @@ void TestParaViewMCPProtocol::rejectsOversizedFrames()
   QCOMPARE(error, QStringLiteral("Incoming frame exceeds the maximum allowed size"));
 }
 
+void TestParaViewMCPProtocol::enforcesTheNegotiatedFrameLimit()
+{
+  const quint32 frameBytes = ParaViewMCP::MaxFrameBytes + 1u;
+  QByteArray buffer(4, '\0');
+  qToBigEndian<quint32>(frameBytes, buffer.data());
+
+  // Above the protocol default, but within what this connection negotiated.
+  ParaViewMCP::WireOptions wire;
+  wire.MaxFrameBytes = ParaViewMCP::MaxFrameBytes * 2u;
+  QVERIFY(ParaViewMCP::canSendPayload(frameBytes, wire));
+
+  QList<QJsonObject> messages;
+  QString error;
+  QVERIFY(ParaViewMCP::tryExtractMessages(buffer, messages, &error, wire));
+  QVERIFY(error.isEmpty());
+  QVERIFY(buffer.size() == 4);
+
+  wire.MaxFrameBytes = ParaViewMCP::MinFrameBytes;
+  QVERIFY(!ParaViewMCP::canSendPayload(frameBytes, wire));
+  qToBigEndian<quint32>(ParaViewMCP::MinFrameBytes + 1u, buffer.data());
+  QVERIFY(!ParaViewMCP::tryExtractMessages(buffer, messages, &error, wire));
+
+  QCOMPARE(ParaViewMCP::clampFrameBytes(1), ParaViewMCP::MinFrameBytes);
+  QCOMPARE(ParaViewMCP::clampFrameBytes(qint64(1) << 40), ParaViewMCP::FrameLengthMask);
+}
+
 void TestParaViewMCPProtocol::rejectsMalformedJson()
 {
   const QByteArray badPayload("{not-json");
@@ -114,6 +230,439 @@ void TestParaViewMCPProtocol::detectsLoopbackHosts()
   QVERIFY(!ParaViewMCP::isLoopbackHost(QStringLiteral("0.0.0.0")));
 }
 
+void TestParaViewMCPProtocol::encodesFlaggedAttachmentFrames()
+{
+  const QByteArray frame = ParaViewMCP::encodeAttachment(
+    ParaViewMCP::Attachment{QStringLiteral("image_data"), QByteArrayLiteral("png")});
+
+  const quint32 header = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(frame.constData()));
+  QCOMPARE(header & ParaViewMCP::FrameLengthMask, 3u);
+  QCOMPARE(header & ~ParaViewMCP::FrameLengthMask, ParaViewMCP::FrameFlagBinary);
+  QCOMPARE(frame.mid(4), QByteArrayLiteral("png"));
+
+  // Clients never send binary frames, so the bridge treats them as invalid.
+  QByteArray buffer = frame;
+  QList<QJsonObject> messages;
+  QString error;
+  QVERIFY(!ParaViewMCP::tryExtractMessages(buffer, messages, &error));
+  QCOMPARE(error, QStringLiteral("Incoming frame exceeds the maximum allowed size"));
+}
+
+void TestParaViewMCPProtocol::streamsOversizedPayloadsAsChunks()
+{
+  const qsizetype chunkBytes = static_cast<qsizetype>(ParaViewMCP::MaxFrameBytes);
+  const QByteArray payload(chunkBytes + 10, 'x');
+
+  ParaViewMCP::WireOptions wire;
+  QVERIFY(!ParaViewMCP::canSendPayload(payload.size(), wire));
+  wire.ChunkedFrames = true;
+  QVERIFY(ParaViewMCP::canSendPayload(payload.size(), wire));
+
+  QBuffer device;
+  QVERIFY(device.open(QIODevice::WriteOnly));
+  ParaViewMCP::writeFrames(&device, payload, ParaViewMCP::FrameFlagBinary);
+  const QByteArray& written = device.data();
+  QCOMPARE(written.size(), payload.size() + 8);
+
+  const auto* bytes = reinterpret_cast<const uchar*>(written.constData());
+  const quint32 firstHeader = qFromBigEndian<quint32>(bytes);
+  QCOMPARE(firstHeader & ParaViewMCP::FrameLengthMask, ParaViewMCP::MaxFrameBytes);
+  QCOMPARE(firstHeader & ~ParaViewMCP::FrameLengthMask,
+           ParaViewMCP::FrameFlagBinary | ParaViewMCP::FrameFlagContinued);
+
+  const quint32 lastHeader = qFromBigEndian<quint32>(bytes + 4 + chunkBytes);
+  QCOMPARE(lastHeader & ParaViewMCP::FrameLengthMask, 10u);
+  QCOMPARE(lastHeader & ~ParaViewMCP::FrameLengthMask, ParaViewMCP::FrameFlagBinary);
+}
+
+void TestParaViewMCPProtocol::writesFramesWithoutCopyingThePayload()
+{
+  // The serialized response is the one payload-sized allocation; the frame
+  // path must hand that exact buffer to the device.
+  const QByteArray payload = ParaViewMCP::serializeMessage(QJsonObject{
+    {"request_id", QStringLiteral("big")},
+    {"result", QJsonObject{{"stdout", QString(4 * 1024 * 1024, QLatin1Char('x'))}}},
+  });
+
+  RecordingDevice device;
+  QVERIFY(device.open(QIODevice::WriteOnly | QIODevice::Unbuffered));
+  ParaViewMCP::writeFrames(&device, payload);
+  QCOMPARE(device.Writes.size(), 2);
+  QCOMPARE(device.Writes.at(0).Length, qint64(4));
+  QVERIFY(device.Writes.at(1).Data == payload.constData());
+  QCOMPARE(device.Writes.at(1).Length, static_cast<qint64>(payload.size()));
+
+  const qsizetype chunkBytes = static_cast<qsizetype>(ParaViewMCP::MaxFrameBytes);
+  const QByteArray oversized(chunkBytes + 10, 'y');
+  device.Writes.clear();
+  ParaViewMCP::writeFrames(&device, oversized, ParaViewMCP::FrameFlagBinary);
+  QCOMPARE(device.Writes.size(), 4);
+  QVERIFY(device.Writes.at(1).Data == oversized.constData());
+  QVERIFY(device.Writes.at(3).Data == oversized.constData() + chunkBytes);
+  QCOMPARE(device.Writes.at(3).Length, qint64(10));
+}
+
+void TestParaViewMCPProtocol::roundTripsCompressedFrames()
+{
+  ParaViewMCP::WireOptions wire;
+  wire.Compression = true;
+  wire.CompressionThreshold = 64;
+
+  const QJsonObject message{
+    {"request_id", QStringLiteral("req-1")},
+    {"status", QStringLiteral("ok")},
+    {"result", QJsonObject{{"stdout", QString(4096, QLatin1Char('a'))}}},
+  };
+  const QByteArray json = ParaViewMCP::serializeMessage(message);
+
+  ParaViewMCP::CompressionStats sent;
+  quint32 flags = 0;
+  const QByteArray compressed = ParaViewMCP::compressPayload(json, wire, &flags, &sent);
+  QCOMPARE(flags, ParaViewMCP::FrameFlagCompressed);
+  QVERIFY(compressed.size() < json.size());
+  QCOMPARE(sent.Frames, 1u);
+  QCOMPARE(sent.bytesSaved(), static_cast<qint64>(json.size() - compressed.size()));
+
+  quint32 smallFlags = 0;
+  const QByteArray small =
+    ParaViewMCP::serializeMessage(QJsonObject{{"type", QStringLiteral("ping")}});
+  QCOMPARE(ParaViewMCP::compressPayload(small, wire, &smallFlags), small);
+  QCOMPARE(smallFlags, 0u);
+
+  ParaViewMCPReadBuffer buffer;
+  buffer.append(ParaViewMCP::encodeFrame(compressed, flags));
+  buffer.append(ParaViewMCP::encodeFrame(small));
+
+  QList<QJsonObject> messages;
+  QString error;
+  ParaViewMCP::CompressionStats received;
+  QList<ParaViewMCP::ReceiveTiming> timings;
+  QVERIFY(
+    ParaViewMCP::tryExtractMessages(buffer, messages, &error, wire, &received, &timings));
+  QCOMPARE(messages.size(), 2);
+  QCOMPARE(messages.at(0), message);
+  QCOMPARE(received.Frames, 1u);
+  QCOMPARE(received.BytesBefore, static_cast<quint64>(json.size()));
+
+  // Each message is stamped when its own frame has been parsed.
+  QCOMPARE(timings.size(), 2);
+  QVERIFY(timings.at(0).DecodeNs >= 0);
+  QVERIFY(timings.at(1).DecodedAtNs >= timings.at(0).DecodedAtNs);
+  QVERIFY(timings.at(1).DecodedAtNs - timings.at(1).DecodeNs >= timings.at(0).DecodedAtNs);
+}
+
+void TestParaViewMCPProtocol::rejectsCompressedFramesWithoutNegotiation()
+{
+  ParaViewMCP::WireOptions wire;
+  wire.Compression = true;
+  wire.CompressionThreshold = 0;
+
+  quint32 flags = 0;
+  const QByteArray compressed = ParaViewMCP::compressPayload(
+    ParaViewMCP::serializeMessage(QJsonObject{{"padding", QString(512, QLatin1Char('b'))}}),
+    wire,
+    &flags);
+  QByteArray buffer = ParaViewMCP::encodeFrame(compressed, flags);
+
+  QList<QJsonObject> messages;
+  QString error;
+  QVERIFY(!ParaViewMCP::tryExtractMessages(buffer, messages, &error));
+  QVERIFY(messages.isEmpty());
+
+  QByteArray corrupt = ParaViewMCP::encodeFrame(QByteArray::fromHex("00001000") + "garbage",
+                                                ParaViewMCP::FrameFlagCompressed);
+  QVERIFY(!ParaViewMCP::tryExtractMessages(corrupt, messages, &error, wire));
+  QVERIFY(messages.isEmpty());
+}
+
+void TestParaViewMCPProtocol::rejectsCompressedFramesInflatingPastTheFrameLimit()
+{
+  ParaViewMCP::WireOptions wire;
+  wire.Compression = true;
+  wire.CompressionThreshold = 64;
+  wire.MaxFrameBytes = 4096;
+
+  // Well under the frame limit on the wire, but it would inflate to 64 KiB.
+  const QByteArray json = ParaViewMCP::serializeMessage(
+    QJsonObject{{"stdout", QString(64 * 1024, QLatin1Char('z'))}});
+  quint32 flags = 0;
+  const QByteArray compressed = ParaViewMCP::compressPayload(json, wire, &flags);
+  QVERIFY(compressed.size() < 4096);
+
+  ParaViewMCPReadBuffer buffer;
+  buffer.append(ParaViewMCP::encodeFrame(compressed, flags));
+  QList<QJsonObject> messages;
+  QString error;
+  QVERIFY(!ParaViewMCP::tryExtractMessages(buffer, messages, &error, wire));
+  QVERIFY(messages.isEmpty());
+  QVERIFY(!error.isEmpty());
+}
+
+void TestParaViewMCPProtocol::roundTripsCborFrames()
+{
+  ParaViewMCP::WireOptions wire;
+  wire.Cbor = true;
+
+  const QJsonObject message = inspectPipelineResponse(3);
+  quint32 flags = 0;
+  const QByteArray cbor = ParaViewMCP::serializeMessage(message, wire, &flags);
+  QCOMPARE(flags, ParaViewMCP::FrameFlagCbor);
+  QVERIFY(cbor.size() < ParaViewMCP::serializeMessage(message).size());
+
+  QByteArray buffer = ParaViewMCP::encodeFrame(cbor, flags);
+  buffer.append(ParaViewMCP::encodeMessage(QJsonObject{{"type", QStringLiteral("ping")}}));
+
+  QList<QJsonObject> messages;
+  QString error;
+  QVERIFY(ParaViewMCP::tryExtractMessages(buffer, messages, &error, wire));
+  QCOMPARE(messages.size(), 2);
+  QCOMPARE(messages.at(0), message);
+
+  QByteArray unnegotiated = ParaViewMCP::encodeFrame(cbor, flags);
+  messages.clear();
+  QVERIFY(!ParaViewMCP::tryExtractMessages(unnegotiated, messages, &error));
+
+  QByteArray malformed = ParaViewMCP::encodeFrame(QByteArray("\xff"), ParaViewMCP::FrameFlagCbor);
+  QVERIFY(!ParaViewMCP::tryExtractMessages(malformed, messages, &error, wire));
+  QCOMPARE(error, QStringLiteral("Received malformed CBOR payload"));
+}
+
+void TestParaViewMCPProtocol::splicesRawResultsIntoEnvelopes()
+{
+  const QJsonObject envelope{
+    {"request_id", QStringLiteral("inspect")},
+    {"status", QStringLiteral("success")},
+  };
+  const QJsonObject result = inspectPipelineResponse(3).value(QStringLiteral("result")).toObject();
+  const QByteArray rawResult = QJsonDocument(result).toJson(QJsonDocument::Compact);
+  QJsonObject expected = envelope;
+  expected.insert(QStringLiteral("result"), result);
+
+  const QByteArray spliced = ParaViewMCP::serializeEnvelope(envelope, rawResult);
+  QCOMPARE(QJsonDocument::fromJson(spliced).object(), expected);
+  QCOMPARE(spliced.size(), ParaViewMCP::serializeMessage(expected).size());
+  QCOMPARE(QJsonDocument::fromJson(ParaViewMCP::serializeEnvelope(QJsonObject(), "{}")).object(),
+           QJsonObject({{"result", QJsonObject()}}));
+
+  ParaViewMCP::WireOptions wire;
+  wire.Cbor = true;
+  quint32 flags = 0;
+  QByteArray frame = ParaViewMCP::encodeFrame(
+    ParaViewMCP::serializeMessage(envelope, rawResult, wire, &flags), flags);
+  QList<QJsonObject> messages;
+  QString error;
+  QVERIFY(ParaViewMCP::tryExtractMessages(frame, messages, &error, wire));
+  QCOMPARE(messages.value(0), expected);
+}
+
+void TestParaViewMCPProtocol::readBufferDecodesPipelinedFrames()
+{
+  ParaViewMCPReadBuffer buffer;
+  buffer.append(encodePipelinedPings(500));
+
+  QList<QJsonObject> messages;
+  QString error;
+
+  QVERIFY(ParaViewMCP::tryExtractMessages(buffer, messages, &error));
+  QVERIFY(error.isEmpty());
+  QCOMPARE(messages.size(), 500);
+  QCOMPARE(messages.front().value(QStringLiteral("request_id")).toString(), QStringLiteral("0"));
+  QCOMPARE(messages.back().value(QStringLiteral("request_id")).toString(), QStringLiteral("499"));
+  QVERIFY(buffer.isEmpty());
+}
+
+void TestParaViewMCPProtocol::readBufferKeepsPartialTailAcrossAppends()
+{
+  const QByteArray encoded = encodePipelinedPings(3);
+  const qsizetype splitAt = encoded.size() - 3;
+
+  ParaViewMCPReadBuffer buffer;
+  buffer.append(encoded.left(splitAt));
+
+  QList<QJsonObject> messages;
+  QVERIFY(ParaViewMCP::tryExtractMessages(buffer, messages, nullptr));
+  QCOMPARE(messages.size(), 2);
+  QVERIFY(!buffer.isEmpty());
+  QVERIFY(buffer.size() < encoded.size() / 2);
+
+  buffer.append(encoded.mid(splitAt));
+  QVERIFY(ParaViewMCP::tryExtractMessages(buffer, messages, nullptr));
+  QCOMPARE(messages.size(), 3);
+  QCOMPARE(messages.back().value(QStringLiteral("request_id")).toString(), QStringLiteral("2"));
+  QVERIFY(buffer.isEmpty());
+}
+
+void TestParaViewMCPProtocol::readBufferReservesAnnouncedFrames()
+{
+  const QByteArray frame = ParaViewMCP::encodeMessage(QJsonObject{
+    {"request_id", QStringLiteral("big")},
+    {"stdout", QString(4 * 1024 * 1024, QLatin1Char('x'))},
+  });
+
+  ParaViewMCPReadBuffer buffer;
+  buffer.append(encodePipelinedPings(1) + frame.left(1460));
+  QList<QJsonObject> messages;
+  QVERIFY(ParaViewMCP::tryExtractMessages(buffer, messages, nullptr));
+  QCOMPARE(messages.size(), 1);
+
+  // Once the header is known the whole frame fits without further growth.
+  QVERIFY(buffer.capacity() >= frame.size());
+  const char* storage = buffer.constData();
+  for (qsizetype offset = 1460; offset < frame.size(); offset += 64 * 1024)
+  {
+    buffer.append(frame.mid(offset, 64 * 1024));
+    QVERIFY(buffer.constData() == storage);
+  }
+  QVERIFY(ParaViewMCP::tryExtractMessages(buffer, messages, nullptr));
+  QCOMPARE(messages.size(), 2);
+  QVERIFY(buffer.isEmpty());
+  QVERIFY(buffer.capacity() < frame.size());
+}
+
+void TestParaViewMCPProtocol::readBufferDoesNotReserveForOversizedHeaders()
+{
+  ParaViewMCP::WireOptions wire;
+  wire.MaxFrameBytes = 1024;
+
+  ParaViewMCPReadBuffer buffer;
+  buffer.append(QByteArray::fromHex("00ffffff") + QByteArray("{\"request_id\""));
+  QList<QJsonObject> messages;
+  QString error;
+
+  QVERIFY(!ParaViewMCP::tryExtractMessages(buffer, messages, &error, wire));
+  QVERIFY(!error.isEmpty());
+  QVERIFY(buffer.capacity() < 1024);
+}
+
+void TestParaViewMCPProtocol::sharedRegionReusesReleasedSpace()
+{
+  ParaViewMCPSharedRegion region;
+  QString error;
+  QVERIFY2(region.open(1000, &error), qPrintable(error));
+  QCOMPARE(region.size(), ParaViewMCPSharedRegion::HeaderBytes + 1000);
+
+  QFile file(region.path());
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  uchar* client = file.map(0, region.size());
+  QVERIFY(client != nullptr);
+  const char* data = reinterpret_cast<const char*>(client + ParaViewMCPSharedRegion::HeaderBytes);
+  const auto body = [data](qint64 position, qsizetype length)
+  {
+    return QByteArray(data + position % 1000, length);
+  };
+
+  const QByteArray first(600, 'a');
+  const QByteArray second(300, 'b');
+  QCOMPARE(region.write(first), qint64(0));
+  QCOMPARE(region.write(second), qint64(600));
+  QCOMPARE(body(600, second.size()), second);
+
+  // Nothing has been released, and a body larger than the ring never fits.
+  QCOMPARE(region.write(QByteArray(200, 'c')), qint64(-1));
+  QCOMPARE(region.write(QByteArray(1001, 'c')), qint64(-1));
+
+  // A cursor that runs ahead of what was written is ignored.
+  qToLittleEndian<quint64>(5000, client);
+  QCOMPARE(region.write(QByteArray(200, 'c')), qint64(-1));
+
+  // Releasing the first body frees the start of the ring; the next body skips
+  // the 100-byte tail rather than wrapping around it.
+  qToLittleEndian<quint64>(600, client);
+  const QByteArray third(200, 'c');
+  QCOMPARE(region.write(third), qint64(1000));
+  QCOMPARE(body(1000, third.size()), third);
+  QCOMPARE(body(600, second.size()), second);
+
+  const QString path = region.path();
+  region.close();
+  QVERIFY(!region.isOpen());
+  QCOMPARE(region.write(third), qint64(-1));
+  QVERIFY(!QFile::exists(path));
+}
+
+void TestParaViewMCPProtocol::outboundQueuePausesAboveTheHighWatermark()
+{
+  const QByteArray payload(512 * 1024, 'x');
+  ParaViewMCPOutboundQueue queue;
+  queue.setWatermarks(256 * 1024, 64 * 1024);
+  for (int index = 0; index < 3; ++index)
+  {
+    queue.enqueue(payload, 0, ParaViewMCP::MaxFrameBytes);
+  }
+
+  // The device is handed about WriteBytes at a time; the rest waits here.
+  HoldingDevice device;
+  QVERIFY(device.open(QIODevice::WriteOnly | QIODevice::Unbuffered));
+  queue.pump(&device);
+  QCOMPARE(device.Held.size(), 2 * (payload.size() + 4));
+  QCOMPARE(queue.outstandingBytes(&device), qint64(3 * (payload.size() + 4)));
+  QVERIFY(queue.isPaused());
+
+  // Still above the low watermark with the last frame in the device.
+  device.send();
+  queue.pump(&device);
+  QCOMPARE(device.Held.size(), payload.size() + 4);
+  QVERIFY(queue.isPaused());
+
+  device.send();
+  queue.pump(&device);
+  QCOMPARE(queue.outstandingBytes(&device), qint64(0));
+  QVERIFY(!queue.isPaused());
+
+  QBuffer expected;
+  QVERIFY(expected.open(QIODevice::WriteOnly));
+  for (int index = 0; index < 3; ++index)
+  {
+    ParaViewMCP::writeFrames(&expected, payload);
+  }
+  QVERIFY(device.Sent == expected.data());
+}
+
+void TestParaViewMCPProtocol::heartbeatTracksRoundTripsAndSilence()
+{
+  ParaViewMCPHeartbeat heartbeat;
+  const quint64 first = heartbeat.beat();
+  QVERIFY(!heartbeat.acknowledge(first + 1));
+  QVERIFY(heartbeat.acknowledge(first));
+  QVERIFY(!heartbeat.acknowledge(first));
+  QVERIFY(heartbeat.roundTrips().size() == 1);
+  QVERIFY(heartbeat.roundTrips().first() >= 0.0);
+
+  // Silence is timed from the oldest heartbeat still out. A late answer
+  // still counts and settles every heartbeat sent before it.
+  QCOMPARE(heartbeat.unansweredMs(), qint64(0));
+  const quint64 slow = heartbeat.beat();
+  const quint64 overtaken = heartbeat.beat();
+  QThread::msleep(5);
+  QVERIFY(heartbeat.unansweredMs() >= 5);
+  QVERIFY(heartbeat.acknowledge(overtaken));
+  QVERIFY(!heartbeat.acknowledge(slow));
+  QVERIFY(heartbeat.roundTrips().last() >= 5.0);
+  QCOMPARE(heartbeat.unansweredMs(), qint64(0));
+  heartbeat.beat();
+  heartbeat.forgive();
+  QCOMPARE(heartbeat.unansweredMs(), qint64(0));
+
+  for (int index = 0; index < 2 * ParaViewMCPHeartbeat::SampleCount; ++index)
+  {
+    QVERIFY(heartbeat.acknowledge(heartbeat.beat()));
+  }
+  QVERIFY(heartbeat.roundTrips().size() == ParaViewMCPHeartbeat::SampleCount);
+
+  QList<double> samples;
+  for (int value = 100; value >= 1; --value)
+  {
+    samples.append(value);
+  }
+  const ParaViewMCP::LatencyStats stats = ParaViewMCPHeartbeat::summarize(samples);
+  QCOMPARE(stats.Samples, 100);
+  QCOMPARE(stats.LastMs, 1.0);
+  QCOMPARE(stats.P50Ms, 50.0);
+  QCOMPARE(stats.P90Ms, 90.0);
+  QCOMPARE(stats.P99Ms, 99.0);
+  QCOMPARE(ParaViewMCPHeartbeat::summarize({}).Samples, 0);
+}
+
 QTEST_APPLESS_MAIN(TestParaViewMCPProtocol)
 
 #include "TestParaViewMCPProtocol.moc"
@@ -29,13 +29,21 @@ def _array_result(*_args):
     return json.dumps([])
 
 
+class ExecutionCancelled(BaseException):
+    pass
+
+
 bootstrap = _object_result
+select_session = _object_result
+close_session = _object_result
 reset_session = _object_result
 execute_python = _object_result
 inspect_pipeline = _object_result
 capture_screenshot = _object_result
 get_history = _array_result
+history_delta = _object_result
 restore_snapshot = _object_result
+take_timings = _object_result
 )PY");
   module->SetIsPackage(0);
   vtkPVPythonModule::RegisterModule(module);
@@ -4,6 +4,7 @@
 
 #include <QJsonArray>
 #include <QJsonObject>
+#include <QJsonValue>
 #include <QObject>
 #include <QtTest>
 
@@ -17,6 +18,7 @@ class TestParaViewMCPRequestHandler : public QObject
 
 private slots:
   void handshakeSucceeds();
+  void resumedHandshakeKeepsTheSession();
   void handshakeRejectsProtocolMismatch();
   void handshakeRejectsBadToken();
   void requiresHandshakeBeforeCommands();
@@ -24,15 +26,27 @@ private slots:
   void executePythonValidatesParams();
   void executePythonPassesThroughBridgeResults();
   void propagatesBridgeFailures();
+  void cancelledExecutionIsReportedAsCancelled();
   void handlesPipelineAndScreenshotCommands();
   void rejectsUnknownCommands();
+  void registeredCommandsAreDispatchedAndAdvertised();
   void getHistoryReturnsHistoryArray();
   void restoreSnapshotValidatesEntryId();
   void restoreSnapshotPassesThroughResult();
   void restoreSnapshotBridgeFailure();
-  void executePythonAttachesHistoryJson();
-  void inspectPipelineAttachesHistoryJson();
-  void captureScreenshotAttachesHistoryJson();
+  void executePythonAttachesHistoryDelta();
+  void inspectPipelineAttachesHistoryDelta();
+  void inspectPipelineForwardsIfVersion();
+  void captureScreenshotAttachesHistoryDelta();
+  void historyDeltaKeepsThenAppends();
+  void handshakeNegotiatesBinaryAttachments();
+  void handshakeNegotiatesCompression();
+  void handshakeNegotiatesFrameLimit();
+  void handshakeAgreesToSharedMemoryOnlyWhenOffered();
+  void captureScreenshotSendsBinaryAttachment();
+  void batchRunsCommandsInOneTurn();
+  void batchStopsOnError();
+  void timingsAreReportedOnlyWhenNegotiated();
 };
 
 void TestParaViewMCPRequestHandler::handshakeSucceeds()
@@ -62,6 +76,32 @@ void TestParaViewMCPRequestHandler::handshakeSucceeds()
   QVERIFY(handshake.value(QStringLiteral("python_ready")).toBool());
 }
 
+void TestParaViewMCPRequestHandler::resumedHandshakeKeepsTheSession()
+{
+  FakeParaViewMCPPythonBridge bridge;
+  ParaViewMCPRequestHandler handler(bridge);
+
+  auto result = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("hello-1")},
+      {"type", QStringLiteral("hello")},
+      {"protocol_version", ParaViewMCP::ProtocolVersion},
+      {"auth_token", QString()},
+    },
+    false,
+    QString(),
+    ParaViewMCP::WireOptions(),
+    true);
+
+  QVERIFY(result.HandshakeCompleted);
+  QCOMPARE(bridge.ResetCalls, 0);
+
+  ParaViewMCPRequestHandler::addResumeToken(result, QStringLiteral("abc"), true);
+  const QJsonObject handshake = result.Response.value(QStringLiteral("result")).toObject();
+  QCOMPARE(handshake.value(QStringLiteral("resume_token")).toString(), QStringLiteral("abc"));
+  QVERIFY(handshake.value(QStringLiteral("resumed")).toBool());
+}
+
 void TestParaViewMCPRequestHandler::handshakeRejectsProtocolMismatch()
 {
   FakeParaViewMCPPythonBridge bridge;
@@ -129,6 +169,8 @@ void TestParaViewMCPRequestHandler::requiresHandshakeBeforeCommands()
              .value(QStringLiteral("code"))
              .toString(),
            QStringLiteral("HANDSHAKE_REQUIRED"));
+  QCOMPARE(result.Response.value(QStringLiteral("request_id")).toString(),
+           QStringLiteral("ping-1"));
 }
 
 void TestParaViewMCPRequestHandler::pingSucceeds()
@@ -227,6 +269,36 @@ void TestParaViewMCPRequestHandler::propagatesBridgeFailures()
            QStringLiteral("exec failed"));
 }
 
+void TestParaViewMCPRequestHandler::cancelledExecutionIsReportedAsCancelled()
+{
+  FakeParaViewMCPPythonBridge bridge;
+  bridge.ExecutePayload = QJsonObject{
+    {"ok", false},
+    {"cancelled", true},
+    {"stdout", QStringLiteral("step 1\n")},
+    {"stderr", QString()},
+  };
+  bridge.HistoryPayload = QJsonArray{QJsonObject{{"id", 1}}};
+  ParaViewMCPRequestHandler handler(bridge);
+
+  const auto result = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("exec-1")},
+      {"type", QStringLiteral("execute_python")},
+      {"params", QJsonObject{{"code", QStringLiteral("while True: pass")}}},
+    },
+    true,
+    QString());
+
+  QCOMPARE(result.Response.value(QStringLiteral("status")).toString(), QStringLiteral("error"));
+  const QJsonObject error = result.Response.value(QStringLiteral("error")).toObject();
+  QCOMPARE(error.value(QStringLiteral("code")).toString(), QStringLiteral("CANCELLED"));
+  QCOMPARE(
+    error.value(QStringLiteral("details")).toObject().value(QStringLiteral("stdout")).toString(),
+    QStringLiteral("step 1\n"));
+  QVERIFY(result.HistoryChanged);
+}
+
 void TestParaViewMCPRequestHandler::handlesPipelineAndScreenshotCommands()
 {
   FakeParaViewMCPPythonBridge bridge;
@@ -245,7 +317,10 @@ void TestParaViewMCPRequestHandler::handlesPipelineAndScreenshotCommands()
     },
     true,
     QString());
-  QCOMPARE(inspectResult.Response.value(QStringLiteral("result"))
+  QVERIFY(!inspectResult.Response.contains(QStringLiteral("result")));
+  QCOMPARE(inspectResult.RawResult, QByteArray(R"({"count":2})"));
+  QCOMPARE(inspectResult.message()
+             .value(QStringLiteral("result"))
              .toObject()
              .value(QStringLiteral("count"))
              .toInt(),
@@ -290,6 +365,88 @@ void TestParaViewMCPRequestHandler::rejectsUnknownCommands()
            QStringLiteral("UNKNOWN_COMMAND"));
 }
 
+void TestParaViewMCPRequestHandler::registeredCommandsAreDispatchedAndAdvertised()
+{
+  FakeParaViewMCPPythonBridge bridge;
+  bridge.HistoryPayload = QJsonArray{QJsonObject{{"id", 1}}};
+  ParaViewMCPRequestHandler handler(bridge);
+
+  int runs = 0;
+  ParaViewMCPRequestHandler::Command echo;
+  echo.Validate = [](const QJsonObject& params)
+  {
+    return params.contains(QStringLiteral("text")) ? QString() : QStringLiteral("needs text");
+  };
+  echo.Run = [&runs](const ParaViewMCPRequestHandler::Request& request)
+  {
+    ++runs;
+    ParaViewMCPRequestHandler::Result result;
+    result.Response = QJsonObject{
+      {"request_id", request.RequestId},
+      {"status", QStringLiteral("success")},
+      {"result", request.Params},
+    };
+    return result;
+  };
+  echo.RefreshesHistory = true;
+  handler.registerCommand(QStringLiteral("echo"), echo);
+  QVERIFY(handler.command(QStringLiteral("echo")) != nullptr);
+  QVERIFY(handler.command(QStringLiteral("execute_python")) != nullptr);
+  QVERIFY(handler.command(QStringLiteral("cancel")) == nullptr);
+  QCOMPARE(handler.commandNames().last(), QStringLiteral("echo"));
+
+  const auto hello = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("hello-1")},
+      {"type", QStringLiteral("hello")},
+      {"protocol_version", ParaViewMCP::ProtocolVersion},
+      {"auth_token", QString()},
+    },
+    false,
+    QString());
+  const QJsonArray capabilities = hello.Response.value(QStringLiteral("result"))
+                                    .toObject()
+                                    .value(QStringLiteral("capabilities"))
+                                    .toArray();
+  QVERIFY(capabilities.contains(QStringLiteral("echo")));
+  QVERIFY(capabilities.contains(QStringLiteral("restore_snapshot")));
+  QVERIFY(capabilities.contains(QStringLiteral("cancel")));
+
+  // Params are checked before the handler runs.
+  auto result = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("echo-1")},
+      {"type", QStringLiteral("echo")},
+      {"params", QJsonObject()},
+    },
+    true,
+    QString());
+  QCOMPARE(result.Response.value(QStringLiteral("error"))
+             .toObject()
+             .value(QStringLiteral("code"))
+             .toString(),
+           QStringLiteral("INVALID_PARAMS"));
+  QCOMPARE(runs, 0);
+  QVERIFY(!result.HistoryChanged);
+
+  result = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("echo-2")},
+      {"type", QStringLiteral("echo")},
+      {"params", QJsonObject{{"text", QStringLiteral("hi")}}},
+    },
+    true,
+    QString());
+  QCOMPARE(runs, 1);
+  QCOMPARE(result.Response.value(QStringLiteral("result"))
+             .toObject()
+             .value(QStringLiteral("text"))
+             .toString(),
+           QStringLiteral("hi"));
+  QVERIFY(result.HistoryChanged);
+  QCOMPARE(result.HistoryDelta.Appended.size(), 1);
+}
+
 void TestParaViewMCPRequestHandler::getHistoryReturnsHistoryArray()
 {
   FakeParaViewMCPPythonBridge bridge;
@@ -316,7 +473,9 @@ void TestParaViewMCPRequestHandler::getHistoryReturnsHistoryArray()
   QCOMPARE(history.size(), 2);
   QCOMPARE(history[0].toObject().value(QStringLiteral("id")).toInt(), 1);
   QCOMPARE(history[1].toObject().value(QStringLiteral("id")).toInt(), 2);
-  QVERIFY(!result.HistoryJson.isEmpty());
+  // The dock panel is brought up to date along with the reply.
+  QVERIFY(result.HistoryChanged);
+  QVERIFY(result.HistoryDelta.Appended.size() == 2);
 }
 
 void TestParaViewMCPRequestHandler::restoreSnapshotValidatesEntryId()
@@ -393,7 +552,7 @@ void TestParaViewMCPRequestHandler::restoreSnapshotPassesThroughResult()
             .toObject()
             .value(QStringLiteral("ok"))
             .toBool());
-  QVERIFY(!result.HistoryJson.isEmpty());
+  QVERIFY(result.HistoryChanged);
 }
 
 void TestParaViewMCPRequestHandler::restoreSnapshotBridgeFailure()
@@ -424,7 +583,7 @@ void TestParaViewMCPRequestHandler::restoreSnapshotBridgeFailure()
            QStringLiteral("snapshot not found"));
 }
 
-void TestParaViewMCPRequestHandler::executePythonAttachesHistoryJson()
+void TestParaViewMCPRequestHandler::executePythonAttachesHistoryDelta()
 {
   FakeParaViewMCPPythonBridge bridge;
   bridge.HistoryPayload = QJsonArray{QJsonObject{{"id", 1}}};
@@ -440,11 +599,27 @@ void TestParaViewMCPRequestHandler::executePythonAttachesHistoryJson()
     QString());
 
   QCOMPARE(result.Response.value(QStringLiteral("status")).toString(), QStringLiteral("success"));
-  QVERIFY(!result.HistoryJson.isEmpty());
-  QVERIFY(result.HistoryJson.contains(QStringLiteral("\"id\":1")));
+  QVERIFY(result.HistoryChanged);
+  QCOMPARE(result.HistoryDelta.Keep, 0);
+  QCOMPARE(result.HistoryDelta.Appended.size(), 1);
+  QCOMPARE(result.HistoryDelta.Appended.front().value(QStringLiteral("id")).toInt(), 1);
+
+  // The next command reports only its own entry.
+  bridge.HistoryPayload.append(QJsonObject{{"id", 2}});
+  const auto next = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("exec-2")},
+      {"type", QStringLiteral("execute_python")},
+      {"params", QJsonObject{{"code", QStringLiteral("y = 2")}}},
+    },
+    true,
+    QString());
+  QCOMPARE(next.HistoryDelta.Keep, 1);
+  QCOMPARE(next.HistoryDelta.Appended.size(), 1);
+  QCOMPARE(next.HistoryDelta.Appended.front().value(QStringLiteral("id")).toInt(), 2);
 }
 
-void TestParaViewMCPRequestHandler::inspectPipelineAttachesHistoryJson()
+void TestParaViewMCPRequestHandler::inspectPipelineAttachesHistoryDelta()
 {
   FakeParaViewMCPPythonBridge bridge;
   bridge.HistoryPayload = QJsonArray{QJsonObject{{"id", 1}}};
@@ -460,10 +635,29 @@ void TestParaViewMCPRequestHandler::inspectPipelineAttachesHistoryJson()
     QString());
 
   QCOMPARE(result.Response.value(QStringLiteral("status")).toString(), QStringLiteral("success"));
-  QVERIFY(!result.HistoryJson.isEmpty());
+  QVERIFY(result.HistoryChanged);
 }
 
-void TestParaViewMCPRequestHandler::captureScreenshotAttachesHistoryJson()
+void TestParaViewMCPRequestHandler::inspectPipelineForwardsIfVersion()
+{
+  FakeParaViewMCPPythonBridge bridge;
+  bridge.InspectPayload = QJsonObject{{"not_modified", true}, {"version", QStringLiteral("e-3")}};
+  ParaViewMCPRequestHandler handler(bridge);
+
+  const auto result = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("inspect-2")},
+      {"type", QStringLiteral("inspect_pipeline")},
+      {"params", QJsonObject{{"if_version", QStringLiteral("e-3")}}},
+    },
+    true,
+    QString());
+
+  QCOMPARE(bridge.LastIfVersion, QStringLiteral("e-3"));
+  QCOMPARE(result.RawResult, QByteArray(R"({"not_modified":true,"version":"e-3"})"));
+}
+
+void TestParaViewMCPRequestHandler::captureScreenshotAttachesHistoryDelta()
 {
   FakeParaViewMCPPythonBridge bridge;
   bridge.HistoryPayload = QJsonArray{QJsonObject{{"id", 1}}};
@@ -479,7 +673,385 @@ void TestParaViewMCPRequestHandler::captureScreenshotAttachesHistoryJson()
     QString());
 
   QCOMPARE(result.Response.value(QStringLiteral("status")).toString(), QStringLiteral("success"));
-  QVERIFY(!result.HistoryJson.isEmpty());
+  QVERIFY(result.HistoryChanged);
+}
+
+void TestParaViewMCPRequestHandler::historyDeltaKeepsThenAppends()
+{
+  ParaViewMCPHistoryDelta delta;
+  QVERIFY(ParaViewMCPHistoryDelta::fromJson(
+    QJsonObject{
+      {"keep", 1},
+      {"append", QJsonArray{QJsonObject{{"id", 4}}}},
+    },
+    &delta));
+
+  QList<QJsonObject> history{QJsonObject{{"id", 1}}, QJsonObject{{"id", 2}}};
+  QVERIFY(delta.changes(history));
+  delta.applyTo(history);
+  QCOMPARE(history.size(), 2);
+  QCOMPARE(history[1].value(QStringLiteral("id")).toInt(), 4);
+
+  ParaViewMCPHistoryDelta::cleared().applyTo(history);
+  QVERIFY(history.isEmpty());
+  QVERIFY(!ParaViewMCPHistoryDelta::cleared().changes(history));
+
+  QVERIFY(!ParaViewMCPHistoryDelta::fromJson(QJsonObject{{"keep", -1}}, &delta));
+}
+
+void TestParaViewMCPRequestHandler::handshakeNegotiatesBinaryAttachments()
+{
+  FakeParaViewMCPPythonBridge bridge;
+  ParaViewMCPRequestHandler handler(bridge);
+
+  const auto plain = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("hello-1")},
+      {"type", QStringLiteral("hello")},
+      {"protocol_version", ParaViewMCP::ProtocolVersion},
+      {"auth_token", QString()},
+    },
+    false,
+    QString());
+  QVERIFY(!plain.NegotiatedWire.BinaryAttachments);
+  QVERIFY(!plain.NegotiatedWire.ChunkedFrames);
+  QVERIFY(!plain.NegotiatedWire.Cbor);
+  QVERIFY(!plain.NegotiatedWire.Heartbeat);
+  QVERIFY(!plain.NegotiatedWire.Timings);
+
+  const auto negotiated = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("hello-2")},
+      {"type", QStringLiteral("hello")},
+      {"protocol_version", ParaViewMCP::ProtocolVersion},
+      {"auth_token", QString()},
+      {"capabilities",
+       QJsonArray{
+         ParaViewMCP::binaryAttachmentsCapability(),
+         ParaViewMCP::chunkedFramesCapability(),
+         ParaViewMCP::cborCapability(),
+         ParaViewMCP::heartbeatCapability(),
+         ParaViewMCP::timingsCapability(),
+       }},
+    },
+    false,
+    QString());
+  QVERIFY(negotiated.NegotiatedWire.BinaryAttachments);
+  QVERIFY(negotiated.NegotiatedWire.ChunkedFrames);
+  QVERIFY(negotiated.NegotiatedWire.Cbor);
+  QVERIFY(negotiated.NegotiatedWire.Heartbeat);
+  QVERIFY(negotiated.NegotiatedWire.Timings);
+  QVERIFY(negotiated.Response.value(QStringLiteral("result"))
+            .toObject()
+            .value(QStringLiteral("capabilities"))
+            .toArray()
+            .contains(ParaViewMCP::binaryAttachmentsCapability()));
+}
+
+void TestParaViewMCPRequestHandler::handshakeNegotiatesCompression()
+{
+  FakeParaViewMCPPythonBridge bridge;
+  ParaViewMCPRequestHandler handler(bridge);
+
+  const auto unsupported = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("hello-1")},
+      {"type", QStringLiteral("hello")},
+      {"protocol_version", ParaViewMCP::ProtocolVersion},
+      {"auth_token", QString()},
+      {"compression", QJsonObject{{"codecs", QJsonArray{QStringLiteral("brotli")}}}},
+    },
+    false,
+    QString());
+  QVERIFY(!unsupported.NegotiatedWire.Compression);
+  QVERIFY(!unsupported.Response.value(QStringLiteral("result"))
+             .toObject()
+             .contains(QStringLiteral("compression")));
+
+  const auto negotiated = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("hello-2")},
+      {"type", QStringLiteral("hello")},
+      {"protocol_version", ParaViewMCP::ProtocolVersion},
+      {"auth_token", QString()},
+      {"compression",
+       QJsonObject{
+         {"codecs", QJsonArray{QStringLiteral("zstd"), ParaViewMCP::zlibCodecName()}},
+         {"threshold", 256},
+       }},
+    },
+    false,
+    QString());
+  QVERIFY(negotiated.NegotiatedWire.Compression);
+  QCOMPARE(negotiated.NegotiatedWire.CompressionThreshold, 256);
+  const QJsonObject reply = negotiated.Response.value(QStringLiteral("result"))
+                              .toObject()
+                              .value(QStringLiteral("compression"))
+                              .toObject();
+  QCOMPARE(reply.value(QStringLiteral("codec")).toString(), ParaViewMCP::zlibCodecName());
+  QCOMPARE(reply.value(QStringLiteral("threshold")).toInt(), 256);
+}
+
+void TestParaViewMCPRequestHandler::handshakeNegotiatesFrameLimit()
+{
+  FakeParaViewMCPPythonBridge bridge;
+  ParaViewMCPRequestHandler handler(bridge);
+  const auto hello = [&handler](const QJsonValue& maxFrameBytes, quint32 configured)
+  {
+    QJsonObject message{
+      {"request_id", QStringLiteral("hello")},
+      {"type", QStringLiteral("hello")},
+      {"protocol_version", ParaViewMCP::ProtocolVersion},
+      {"auth_token", QString()},
+    };
+    if (!maxFrameBytes.isUndefined())
+    {
+      message.insert(QStringLiteral("max_frame_bytes"), maxFrameBytes);
+    }
+    ParaViewMCP::WireOptions wire;
+    wire.MaxFrameBytes = configured;
+    return handler.handleMessage(message, false, QString(), wire);
+  };
+  const auto replied = [](const ParaViewMCPRequestHandler::Result& result)
+  {
+    return result.Response.value(QStringLiteral("result"))
+      .toObject()
+      .value(QStringLiteral("max_frame_bytes"))
+      .toDouble();
+  };
+
+  const quint32 ceiling = 128u * 1024u * 1024u;
+  const auto legacy = hello(QJsonValue(QJsonValue::Undefined), ceiling);
+  QCOMPARE(legacy.NegotiatedWire.MaxFrameBytes, ParaViewMCP::MaxFrameBytes);
+  QCOMPARE(replied(legacy), static_cast<double>(ParaViewMCP::MaxFrameBytes));
+
+  const auto larger = hello(100.0 * 1024 * 1024, ceiling);
+  QCOMPARE(larger.NegotiatedWire.MaxFrameBytes, 100u * 1024u * 1024u);
+
+  const auto capped = hello(static_cast<double>(ParaViewMCP::FrameLengthMask), ceiling);
+  QCOMPARE(capped.NegotiatedWire.MaxFrameBytes, ceiling);
+  QCOMPARE(replied(capped), static_cast<double>(ceiling));
+
+  const auto tiny = hello(16.0, ceiling);
+  QCOMPARE(tiny.NegotiatedWire.MaxFrameBytes, ParaViewMCP::MinFrameBytes);
+
+  const auto absurd = hello(1e30, ParaViewMCP::FrameLengthMask);
+  QCOMPARE(absurd.NegotiatedWire.MaxFrameBytes, ParaViewMCP::FrameLengthMask);
+}
+
+void TestParaViewMCPRequestHandler::handshakeAgreesToSharedMemoryOnlyWhenOffered()
+{
+  FakeParaViewMCPPythonBridge bridge;
+  ParaViewMCPRequestHandler handler(bridge);
+  const auto hello = [&handler](bool requested, bool offered)
+  {
+    QJsonObject message{
+      {"request_id", QStringLiteral("hello")},
+      {"type", QStringLiteral("hello")},
+      {"protocol_version", ParaViewMCP::ProtocolVersion},
+      {"auth_token", QString()},
+    };
+    if (requested)
+    {
+      message.insert(QStringLiteral("capabilities"),
+                     QJsonArray{ParaViewMCP::sharedMemoryCapability()});
+    }
+    ParaViewMCP::WireOptions wire;
+    wire.SharedMemory = offered;
+    return handler.handleMessage(message, false, QString(), wire);
+  };
+
+  QVERIFY(hello(true, true).NegotiatedWire.SharedMemory);
+  QVERIFY(!hello(true, false).NegotiatedWire.SharedMemory);
+  QVERIFY(!hello(false, true).NegotiatedWire.SharedMemory);
+
+  // The bridge announces the region once it exists, not the handler.
+  const QJsonObject reply =
+    hello(true, true).Response.value(QStringLiteral("result")).toObject();
+  QVERIFY(!reply.value(QStringLiteral("capabilities"))
+             .toArray()
+             .contains(ParaViewMCP::sharedMemoryCapability()));
+  QVERIFY(!reply.contains(QStringLiteral("shared_memory")));
+}
+
+void TestParaViewMCPRequestHandler::captureScreenshotSendsBinaryAttachment()
+{
+  FakeParaViewMCPPythonBridge bridge;
+  bridge.ScreenshotBytes = QByteArrayLiteral("\x89PNG");
+  ParaViewMCPRequestHandler handler(bridge);
+
+  ParaViewMCP::WireOptions wire;
+  wire.BinaryAttachments = true;
+  const auto result = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("shot-1")},
+      {"type", QStringLiteral("capture_screenshot")},
+      {"params", QJsonObject{{"width", 320}, {"height", 200}}},
+    },
+    true,
+    QString(),
+    wire);
+
+  QCOMPARE(bridge.BinaryScreenshotCalls, 1);
+  QCOMPARE(bridge.ScreenshotCalls, 0);
+  QCOMPARE(result.Attachments.size(), 1);
+  QCOMPARE(result.Attachments.front().Key, QStringLiteral("image_data"));
+  QCOMPARE(result.Attachments.front().Data, QByteArrayLiteral("\x89PNG"));
+
+  const QJsonObject payload = result.Response.value(QStringLiteral("result")).toObject();
+  QVERIFY(!payload.contains(QStringLiteral("image_data")));
+  const QJsonArray descriptors = result.Response.value(QStringLiteral("attachments")).toArray();
+  QCOMPARE(descriptors.size(), 1);
+  QCOMPARE(descriptors[0].toObject().value(QStringLiteral("key")).toString(),
+           QStringLiteral("image_data"));
+  QCOMPARE(descriptors[0].toObject().value(QStringLiteral("size")).toInt(), 4);
+}
+
+void TestParaViewMCPRequestHandler::batchRunsCommandsInOneTurn()
+{
+  FakeParaViewMCPPythonBridge bridge;
+  bridge.HistoryPayload = QJsonArray{QJsonObject{{"id", 1}}};
+  bridge.InspectPayload = QJsonObject{{"count", 2}};
+  bool deferredWhileRunning = false;
+  bridge.ExecuteHook = [&]() { deferredWhileRunning = bridge.RendersDeferred; };
+  ParaViewMCPRequestHandler handler(bridge);
+
+  ParaViewMCP::WireOptions wire;
+  wire.BinaryAttachments = true;
+  auto batch = [](const QJsonArray& commands)
+  {
+    return QJsonObject{
+      {"request_id", QStringLiteral("batch-1")},
+      {"type", QStringLiteral("batch")},
+      {"params", QJsonObject{{"commands", commands}}},
+    };
+  };
+
+  const auto result = handler.handleMessage(
+    batch(QJsonArray{
+      QJsonObject{
+        {"type", QStringLiteral("execute_python")},
+        {"params", QJsonObject{{"code", QStringLiteral("x = 1")}}},
+      },
+      QJsonObject{{"type", QStringLiteral("inspect_pipeline")}},
+      QJsonObject{{"type", QStringLiteral("capture_screenshot")}},
+    }),
+    true,
+    QString(),
+    wire);
+
+  QCOMPARE(result.Response.value(QStringLiteral("status")).toString(), QStringLiteral("success"));
+  const QJsonArray results = result.message()
+                               .value(QStringLiteral("result"))
+                               .toObject()
+                               .value(QStringLiteral("results"))
+                               .toArray();
+  QCOMPARE(results.size(), 3);
+  QCOMPARE(results[0].toObject().value(QStringLiteral("type")).toString(),
+           QStringLiteral("execute_python"));
+  QCOMPARE(results[1].toObject().value(QStringLiteral("status")).toString(),
+           QStringLiteral("success"));
+  // inspect_pipeline's raw result is spliced into its entry unchanged.
+  QVERIFY(!result.RawResult.isEmpty());
+  QCOMPARE(results[1]
+             .toObject()
+             .value(QStringLiteral("result"))
+             .toObject()
+             .value(QStringLiteral("count"))
+             .toInt(),
+           2);
+  // Renders are held back for the whole batch and released once at its end.
+  QVERIFY(deferredWhileRunning);
+  QCOMPARE(bridge.DeferralCalls, (QList<bool>{true, false}));
+  QCOMPARE(bridge.ExecuteCalls, 1);
+  QCOMPARE(bridge.InspectCalls, 1);
+  QCOMPARE(bridge.BinaryScreenshotCalls, 1);
+  QCOMPARE(result.Attachments.size(), 1);
+  QCOMPARE(result.Attachments.front().Key, QStringLiteral("results.2.image_data"));
+  QVERIFY(result.HistoryChanged);
+  QCOMPARE(bridge.HistoryDeltaCalls, 1);
+
+  // A bad entry, or a nested batch, is rejected before anything runs.
+  const auto invalid = handler.handleMessage(
+    batch(QJsonArray{
+      QJsonObject{{"type", QStringLiteral("inspect_pipeline")}},
+      QJsonObject{{"type", QStringLiteral("batch")}},
+    }),
+    true,
+    QString());
+  QCOMPARE(invalid.Response.value(QStringLiteral("error"))
+             .toObject()
+             .value(QStringLiteral("code"))
+             .toString(),
+           QStringLiteral("INVALID_PARAMS"));
+  QCOMPARE(bridge.InspectCalls, 1);
+}
+
+void TestParaViewMCPRequestHandler::batchStopsOnError()
+{
+  FakeParaViewMCPPythonBridge bridge;
+  bridge.ExecutePayload = QJsonObject{{"ok", false}, {"error", QStringLiteral("boom")}};
+  ParaViewMCPRequestHandler handler(bridge);
+
+  const QJsonArray commands{
+    QJsonObject{
+      {"type", QStringLiteral("execute_python")},
+      {"params", QJsonObject{{"code", QStringLiteral("raise")}}},
+    },
+    QJsonObject{{"type", QStringLiteral("inspect_pipeline")}},
+  };
+
+  // By default every command runs regardless.
+  auto result = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("batch-1")},
+      {"type", QStringLiteral("batch")},
+      {"params", QJsonObject{{"commands", commands}}},
+    },
+    true,
+    QString());
+  QCOMPARE(bridge.InspectCalls, 1);
+
+  result = handler.handleMessage(
+    QJsonObject{
+      {"request_id", QStringLiteral("batch-2")},
+      {"type", QStringLiteral("batch")},
+      {"params", QJsonObject{{"commands", commands}, {"stop_on_error", true}}},
+    },
+    true,
+    QString());
+  QCOMPARE(bridge.ExecuteCalls, 2);
+  QCOMPARE(bridge.InspectCalls, 1);
+  const QJsonArray results = result.message()
+                               .value(QStringLiteral("result"))
+                               .toObject()
+                               .value(QStringLiteral("results"))
+                               .toArray();
+  QCOMPARE(results.size(), 2);
+  QCOMPARE(results[1].toObject().value(QStringLiteral("status")).toString(),
+           QStringLiteral("skipped"));
+}
+
+void TestParaViewMCPRequestHandler::timingsAreReportedOnlyWhenNegotiated()
+{
+  FakeParaViewMCPPythonBridge bridge;
+  ParaViewMCPRequestHandler handler(bridge);
+  const QJsonObject message{
+    {"request_id", QStringLiteral("exec-1")},
+    {"type", QStringLiteral("execute_python")},
+    {"params", QJsonObject{{"code", QStringLiteral("x = 1")}}},
+  };
+
+  const auto plain = handler.handleMessage(message, true, QString());
+  QVERIFY(!plain.Response.contains(QStringLiteral("timings")));
+
+  ParaViewMCP::WireOptions wire;
+  wire.Timings = true;
+  const auto timed = handler.handleMessage(message, true, QString(), wire);
+  const QJsonObject timings = timed.Response.value(QStringLiteral("timings")).toObject();
+  QCOMPARE(timings.value(QStringLiteral("exec_ms")).toDouble(), 1.5);
+  QVERIFY(timings.contains(QStringLiteral("handler_ms")));
+  QVERIFY(!bridge.TimingsEnabled);
 }
 
 QTEST_APPLESS_MAIN(TestParaViewMCPRequestHandler)
@@ -19,6 +19,7 @@ private slots:
   void rejectsNonLoopbackWithoutToken();
   void acceptsNonLoopbackWithToken();
   void rejectsInvalidHosts();
+  void localSocketSkipsHostValidation();
 };
 
 void TestParaViewMCPServerConfig::initTestCase()
@@ -40,6 +41,14 @@ void TestParaViewMCPServerConfig::loadsDefaults()
 
   QCOMPARE(config.Host, QStringLiteral("127.0.0.1"));
   QCOMPARE(config.Port, ParaViewMCP::DefaultPort);
+  QCOMPARE(config.SharedMemoryBytes, ParaViewMCP::DefaultSharedMemoryBytes);
+  QCOMPARE(config.MaxSessions, ParaViewMCP::DefaultMaxSessions);
+  QCOMPARE(config.OutboundHighWatermark, ParaViewMCP::DefaultOutboundHighWatermark);
+  QCOMPARE(config.HeartbeatIntervalMs, ParaViewMCP::DefaultHeartbeatIntervalMs);
+  QCOMPARE(config.HeartbeatTimeoutMs, ParaViewMCP::DefaultHeartbeatTimeoutMs);
+  QCOMPARE(config.ResumeGraceMs, ParaViewMCP::DefaultResumeGraceMs);
+  QVERIFY(!config.LowLatency);
+  QCOMPARE(config.SocketBufferBytes, ParaViewMCP::DefaultSocketBufferBytes);
 }
 
 void TestParaViewMCPServerConfig::loadsPersistedSettings()
@@ -47,11 +56,30 @@ void TestParaViewMCPServerConfig::loadsPersistedSettings()
   ParaViewMCPServerConfig config;
   config.Host = QStringLiteral("localhost");
   config.Port = 12345;
+  config.SocketPath = QStringLiteral("/tmp/paraview-mcp.sock");
+  config.SharedMemoryBytes = 0;
+  config.MaxSessions = 2;
+  config.OutboundHighWatermark = 4 * 1024 * 1024;
+  config.HeartbeatIntervalMs = 0;
+  config.HeartbeatTimeoutMs = 0;
+  config.ResumeGraceMs = 0;
+  config.LowLatency = true;
+  config.SocketBufferBytes = 0;
   config.save();
 
   const ParaViewMCPServerConfig loaded = ParaViewMCPServerConfig::load();
   QCOMPARE(loaded.Host, QStringLiteral("localhost"));
   QCOMPARE(loaded.Port, static_cast<quint16>(12345));
+  QCOMPARE(loaded.SocketPath, QStringLiteral("/tmp/paraview-mcp.sock"));
+  QVERIFY(loaded.usesLocalSocket());
+  QCOMPARE(loaded.SharedMemoryBytes, qint64(0));
+  QCOMPARE(loaded.MaxSessions, 2);
+  QCOMPARE(loaded.OutboundHighWatermark, qint64(4 * 1024 * 1024));
+  QCOMPARE(loaded.HeartbeatIntervalMs, 0);
+  QCOMPARE(loaded.HeartbeatTimeoutMs, 0);
+  QCOMPARE(loaded.ResumeGraceMs, 0);
+  QVERIFY(loaded.LowLatency);
+  QCOMPARE(loaded.SocketBufferBytes, 0);
 }
 
 void TestParaViewMCPServerConfig::zeroPortFallsBackToDefault()
@@ -111,6 +139,22 @@ void TestParaViewMCPServerConfig::rejectsInvalidHosts()
   QCOMPARE(error, QStringLiteral("Listen host must be 'localhost' or a literal IP address"));
 }
 
+void TestParaViewMCPServerConfig::localSocketSkipsHostValidation()
+{
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("0.0.0.0");
+  config.AuthToken.clear();
+  config.SocketPath = QStringLiteral("  ");
+  QVERIFY(!config.usesLocalSocket());
+  QVERIFY(!config.validateForListen(nullptr, nullptr));
+
+  config.SocketPath = QStringLiteral("/tmp/paraview-mcp.sock");
+  QString error;
+  QVERIFY(config.usesLocalSocket());
+  QVERIFY(config.validateForListen(nullptr, &error));
+  QVERIFY(error.isEmpty());
+}
+
 QTEST_APPLESS_MAIN(TestParaViewMCPServerConfig)
 
 #include "TestParaViewMCPServerConfig.moc"
@@ -1,11 +1,22 @@
 #include "FakeParaViewMCPPythonBridge.h"
+#include "ParaViewMCPReadBuffer.h"
 #include "ParaViewMCPRequestHandler.h"
+#include "ParaViewMCPSharedRegion.h"
 #include "ParaViewMCPSocketBridge.h"
 #include "TestSocketHelpers.h"
 
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
 #include <QJsonObject>
+#include <QLocalSocket>
 #include <QObject>
+#include <QStringList>
 #include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QThread>
 #include <QtTest>
 
 class TestParaViewMCPSocketBridge : public QObject
@@ -18,6 +29,19 @@ private slots:
   void helloCompletesTheHandshake();
   void disconnectResetsSessionState();
   void preservesRequestIdsAcrossResponses();
+  void repliesCarryTimingsWhenNegotiated();
+  void pipelinedCommandsEchoTheirRequestIds();
+  void pingIsAnsweredWhilePythonRuns();
+  void clientsGetSeparateSessions();
+  void clientsTakeTurnsOnTheGuiThread();
+  void localSocketSpeaksTheSameProtocol();
+  void reclaimsStaleLocalSocketFiles();
+  void sharedMemoryCarriesLargeBodies();
+  void slowReaderPausesItsRequests();
+  void heartbeatsMeasureLatencyAndDropSilentClients();
+  void cancelStopsRunningAndQueuedRequests();
+  void statusIsAnsweredWhilePythonRuns();
+  void resumeTokenKeepsTheSessionAcrossReconnects();
 };
 
 void TestParaViewMCPSocketBridge::acceptsOneClientAndRejectsTheSecond()
@@ -29,6 +53,7 @@ void TestParaViewMCPSocketBridge::acceptsOneClientAndRejectsTheSecond()
   ParaViewMCPServerConfig config;
   config.Host = QStringLiteral("127.0.0.1");
   config.Port = 0;
+  config.MaxSessions = 1;
   QString error;
   if (!bridge.start(config, &error))
   {
@@ -128,6 +153,7 @@ void TestParaViewMCPSocketBridge::disconnectResetsSessionState()
   ParaViewMCPServerConfig config;
   config.Host = QStringLiteral("127.0.0.1");
   config.Port = 0;
+  config.ResumeGraceMs = 0;
   QString error;
   if (!bridge.start(config, &error))
   {
@@ -200,6 +226,887 @@ void TestParaViewMCPSocketBridge::preservesRequestIdsAcrossResponses()
   bridge.stop();
 }
 
+void TestParaViewMCPSocketBridge::repliesCarryTimingsWhenNegotiated()
+{
+  FakeParaViewMCPPythonBridge bridgeImpl;
+  ParaViewMCPRequestHandler handler(bridgeImpl);
+  ParaViewMCPSocketBridge bridge(bridgeImpl, handler);
+
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("127.0.0.1");
+  config.Port = 0;
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+
+  QTcpSocket client;
+  QVERIFY(connectClientSocket(client, bridge.serverPort(), &error));
+  writeJsonFrame(client,
+                 QJsonObject{
+                   {"request_id", QStringLiteral("hello-1")},
+                   {"type", QStringLiteral("hello")},
+                   {"protocol_version", ParaViewMCP::ProtocolVersion},
+                   {"auth_token", QString()},
+                   {"capabilities", QJsonArray{ParaViewMCP::timingsCapability()}},
+                 });
+  QJsonObject response;
+  QVERIFY(waitForJsonMessage(client, &response, &error));
+  QVERIFY(!response.contains(QStringLiteral("timings")));
+
+  writeJsonFrame(client,
+                 QJsonObject{
+                   {"request_id", QStringLiteral("exec-1")},
+                   {"type", QStringLiteral("execute_python")},
+                   {"params", QJsonObject{{"code", QStringLiteral("x = 1")}}},
+                 });
+  QVERIFY(waitForJsonMessage(client, &response, &error));
+  const QJsonObject timings = response.value(QStringLiteral("timings")).toObject();
+  for (const char* phase : {"decode_ms", "queue_ms", "handler_ms", "exec_ms"})
+  {
+    QVERIFY2(timings.value(QLatin1String(phase)).toDouble(-1.0) >= 0.0, phase);
+  }
+
+  // Pings are answered on the network thread and are timed there.
+  writeJsonFrame(
+    client,
+    QJsonObject{{"request_id", QStringLiteral("ping-1")}, {"type", QStringLiteral("ping")}});
+  QVERIFY(waitForJsonMessage(client, &response, &error));
+  const QJsonObject pingTimings = response.value(QStringLiteral("timings")).toObject();
+  for (const char* phase : {"decode_ms", "queue_ms", "handler_ms"})
+  {
+    QVERIFY2(pingTimings.value(QLatin1String(phase)).toDouble(-1.0) >= 0.0, phase);
+  }
+
+  bridge.stop();
+}
+
+void TestParaViewMCPSocketBridge::pipelinedCommandsEchoTheirRequestIds()
+{
+  FakeParaViewMCPPythonBridge bridgeImpl;
+  ParaViewMCPRequestHandler handler(bridgeImpl);
+  ParaViewMCPSocketBridge bridge(bridgeImpl, handler);
+
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("127.0.0.1");
+  config.Port = 0;
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+
+  QTcpSocket client;
+  QVERIFY(connectClientSocket(client, bridge.serverPort(), &error));
+
+  // The client does not wait between requests, so every frame after 'hello'
+  // may arrive in the same read; failures must keep their own request_id too.
+  const QList<QJsonObject> requests{
+    QJsonObject{
+      {"request_id", QStringLiteral("hello-1")},
+      {"type", QStringLiteral("hello")},
+      {"protocol_version", ParaViewMCP::ProtocolVersion},
+      {"auth_token", QString()},
+    },
+    QJsonObject{{"request_id", QStringLiteral("exec-1")},
+                {"type", QStringLiteral("execute_python")},
+                {"params", QJsonObject{{"code", QStringLiteral("x = 1")}}}},
+    QJsonObject{{"request_id", QStringLiteral("ping-1")}, {"type", QStringLiteral("ping")}},
+    QJsonObject{{"request_id", QStringLiteral("bad-1")},
+                {"type", QStringLiteral("execute_python")},
+                {"params", QJsonObject()}},
+    QJsonObject{{"request_id", QStringLiteral("inspect-1")},
+                {"type", QStringLiteral("inspect_pipeline")}},
+    QJsonObject{{"request_id", QStringLiteral("unknown-1")}, {"type", QStringLiteral("nope")}},
+    QJsonObject{{"request_id", QStringLiteral("ping-2")}, {"type", QStringLiteral("ping")}},
+  };
+  QByteArray batch;
+  for (const QJsonObject& request : requests)
+  {
+    batch.append(ParaViewMCP::encodeMessage(request));
+  }
+  client.write(batch);
+  client.flush();
+
+  QList<QJsonObject> responses;
+  QVERIFY2(waitForJsonMessages(client, requests.size(), &responses, &error), qPrintable(error));
+  QCOMPARE(responses.size(), requests.size());
+  for (qsizetype index = 0; index < requests.size(); ++index)
+  {
+    QCOMPARE(responses.at(index).value(QStringLiteral("request_id")).toString(),
+             requests.at(index).value(QStringLiteral("request_id")).toString());
+  }
+  QCOMPARE(responses.at(3).value(QStringLiteral("status")).toString(), QStringLiteral("error"));
+
+  bridge.stop();
+}
+
+void TestParaViewMCPSocketBridge::pingIsAnsweredWhilePythonRuns()
+{
+  FakeParaViewMCPPythonBridge bridgeImpl;
+  ParaViewMCPRequestHandler handler(bridgeImpl);
+  ParaViewMCPSocketBridge bridge(bridgeImpl, handler);
+
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("127.0.0.1");
+  config.Port = 0;
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+
+  QTcpSocket client;
+  QVERIFY(connectClientSocket(client, bridge.serverPort(), &error));
+  writeJsonFrame(client,
+                 QJsonObject{
+                   {"request_id", QStringLiteral("hello-1")},
+                   {"type", QStringLiteral("hello")},
+                   {"protocol_version", ParaViewMCP::ProtocolVersion},
+                   {"auth_token", QString()},
+                 });
+  QJsonObject response;
+  QVERIFY(waitForJsonMessage(client, &response, &error));
+  QTRY_VERIFY_WITH_TIMEOUT(bridge.handshakeComplete(), 2000);
+
+  // The hook runs on the GUI thread in the middle of execute_python and
+  // waits without an event loop, so only the network thread can answer.
+  QList<QJsonObject> duringExecute;
+  bridgeImpl.ExecuteHook = [&client, &duringExecute]()
+  {
+    writeJsonFrame(client,
+                   QJsonObject{
+                     {"request_id", QStringLiteral("ping-1")},
+                     {"type", QStringLiteral("ping")},
+                   });
+    ParaViewMCPReadBuffer buffer;
+    while (duringExecute.isEmpty() && client.waitForReadyRead(2000))
+    {
+      buffer.readFrom(&client);
+      ParaViewMCP::tryExtractMessages(buffer, duringExecute, nullptr);
+    }
+  };
+  writeJsonFrame(client,
+                 QJsonObject{
+                   {"request_id", QStringLiteral("exec-1")},
+                   {"type", QStringLiteral("execute_python")},
+                   {"params", QJsonObject{{"code", QStringLiteral("x = 1")}}},
+                 });
+  QVERIFY(waitForJsonMessage(client, &response, &error));
+  QCOMPARE(response.value(QStringLiteral("request_id")).toString(), QStringLiteral("exec-1"));
+
+  QCOMPARE(duringExecute.size(), 1);
+  QCOMPARE(duringExecute.first().value(QStringLiteral("request_id")).toString(),
+           QStringLiteral("ping-1"));
+  QCOMPARE(bridgeImpl.ExecuteCalls, 1);
+
+  bridge.stop();
+}
+
+namespace
+{
+  bool completeHello(QTcpSocket& client, const QString& requestId, QString* error)
+  {
+    writeJsonFrame(client,
+                   QJsonObject{
+                     {"request_id", requestId},
+                     {"type", QStringLiteral("hello")},
+                     {"protocol_version", ParaViewMCP::ProtocolVersion},
+                     {"auth_token", QString()},
+                   });
+    QJsonObject response;
+    return waitForJsonMessage(client, &response, error) &&
+           response.value(QStringLiteral("status")).toString() == QStringLiteral("success");
+  }
+
+  QJsonObject executeRequest(const QString& requestId, const QString& code)
+  {
+    return QJsonObject{
+      {"request_id", requestId},
+      {"type", QStringLiteral("execute_python")},
+      {"params", QJsonObject{{"code", code}}},
+    };
+  }
+} // namespace
+
+void TestParaViewMCPSocketBridge::clientsGetSeparateSessions()
+{
+  FakeParaViewMCPPythonBridge bridgeImpl;
+  ParaViewMCPRequestHandler handler(bridgeImpl);
+  ParaViewMCPSocketBridge bridge(bridgeImpl, handler);
+
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("127.0.0.1");
+  config.Port = 0;
+  config.ResumeGraceMs = 0;
+  config.MaxSessions = 2;
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+
+  QTcpSocket agent;
+  QVERIFY(connectClientSocket(agent, bridge.serverPort(), &error));
+  QVERIFY2(completeHello(agent, QStringLiteral("hello-agent"), &error), qPrintable(error));
+  const quint64 agentSession = bridgeImpl.ActiveSession;
+  QTcpSocket monitor;
+  QVERIFY(connectClientSocket(monitor, bridge.serverPort(), &error));
+  QVERIFY2(completeHello(monitor, QStringLiteral("hello-monitor"), &error), qPrintable(error));
+  const quint64 monitorSession = bridgeImpl.ActiveSession;
+  QVERIFY(agentSession != monitorSession);
+  QCOMPARE(bridge.clientCount(), 2);
+  QCOMPARE(bridgeImpl.ResetCalls, 2);
+
+  // Each command runs in its own client's session and answers that client.
+  writeJsonFrame(agent, executeRequest(QStringLiteral("exec-agent"), QStringLiteral("a = 1")));
+  QJsonObject response;
+  QVERIFY(waitForJsonMessage(agent, &response, &error));
+  QCOMPARE(response.value(QStringLiteral("request_id")).toString(), QStringLiteral("exec-agent"));
+  QCOMPARE(bridgeImpl.ActiveSession, agentSession);
+  writeJsonFrame(monitor, executeRequest(QStringLiteral("exec-monitor"), QStringLiteral("m = 1")));
+  QVERIFY(waitForJsonMessage(monitor, &response, &error));
+  QCOMPARE(response.value(QStringLiteral("request_id")).toString(),
+           QStringLiteral("exec-monitor"));
+  QCOMPARE(bridgeImpl.ActiveSession, monitorSession);
+
+  // A third client is over the cap.
+  QTcpSocket third;
+  QVERIFY(connectClientSocket(third, bridge.serverPort(), &error));
+  QVERIFY(waitForJsonMessage(third, &response, &error));
+  QCOMPARE(
+    response.value(QStringLiteral("error")).toObject().value(QStringLiteral("code")).toString(),
+    QStringLiteral("CLIENT_BUSY"));
+
+  // One client leaving drops only its namespace; the shared state is reset
+  // once the last one is gone.
+  agent.disconnectFromHost();
+  QTRY_COMPARE_WITH_TIMEOUT(bridge.clientCount(), 1, 2000);
+  QVERIFY(bridgeImpl.ClosedSessions.contains(agentSession));
+  QCOMPARE(bridgeImpl.ResetCalls, 2);
+  monitor.disconnectFromHost();
+  QTRY_VERIFY_WITH_TIMEOUT(!bridge.hasClient(), 2000);
+  QCOMPARE(bridgeImpl.ResetCalls, 3);
+
+  bridge.stop();
+}
+
+void TestParaViewMCPSocketBridge::clientsTakeTurnsOnTheGuiThread()
+{
+  FakeParaViewMCPPythonBridge bridgeImpl;
+  ParaViewMCPRequestHandler handler(bridgeImpl);
+  ParaViewMCPSocketBridge bridge(bridgeImpl, handler);
+
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("127.0.0.1");
+  config.Port = 0;
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+
+  QTcpSocket busy;
+  QVERIFY(connectClientSocket(busy, bridge.serverPort(), &error));
+  QVERIFY2(completeHello(busy, QStringLiteral("hello-busy"), &error), qPrintable(error));
+  QTcpSocket other;
+  QVERIFY(connectClientSocket(other, bridge.serverPort(), &error));
+  QVERIFY2(completeHello(other, QStringLiteral("hello-other"), &error), qPrintable(error));
+
+  // While the first of the busy client's commands runs, the other client asks
+  // for one of its own. It must not wait behind the whole backlog.
+  QStringList order;
+  bridgeImpl.ExecuteHook = [&]()
+  {
+    order.append(bridgeImpl.LastCode);
+    if (order.size() == 1)
+    {
+      writeJsonFrame(other, executeRequest(QStringLiteral("exec-other"), QStringLiteral("o")));
+      QThread::msleep(200);
+    }
+  };
+  QByteArray batch;
+  for (int index = 0; index < 5; ++index)
+  {
+    batch.append(ParaViewMCP::encodeMessage(
+      executeRequest(QStringLiteral("exec-%1").arg(index), QStringLiteral("b%1").arg(index))));
+  }
+  busy.write(batch);
+  busy.flush();
+
+  QList<QJsonObject> responses;
+  QVERIFY2(waitForJsonMessages(busy, 5, &responses, &error), qPrintable(error));
+  QJsonObject response;
+  QVERIFY(waitForJsonMessage(other, &response, &error));
+  QCOMPARE(response.value(QStringLiteral("request_id")).toString(), QStringLiteral("exec-other"));
+
+  QCOMPARE(order.size(), 6);
+  QCOMPARE(order.first(), QStringLiteral("b0"));
+  QVERIFY(order.indexOf(QStringLiteral("o")) < order.size() - 1);
+
+  bridge.stop();
+}
+
+void TestParaViewMCPSocketBridge::localSocketSpeaksTheSameProtocol()
+{
+  FakeParaViewMCPPythonBridge bridgeImpl;
+  ParaViewMCPRequestHandler handler(bridgeImpl);
+  ParaViewMCPSocketBridge bridge(bridgeImpl, handler);
+
+  QTemporaryDir directory;
+  QVERIFY(directory.isValid());
+  ParaViewMCPServerConfig config;
+  config.SocketPath = directory.filePath(QStringLiteral("bridge.sock"));
+  config.MaxSessions = 1;
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+  QVERIFY(bridge.isListening());
+  QVERIFY(!bridge.socketPath().isEmpty());
+  QCOMPARE(bridge.serverPort(), static_cast<quint16>(0));
+
+  QLocalSocket client;
+  QVERIFY2(connectLocalSocket(client, bridge.socketPath(), &error), qPrintable(error));
+  QTRY_VERIFY_WITH_TIMEOUT(bridge.hasClient(), 2000);
+
+  writeJsonFrame(client,
+                 QJsonObject{
+                   {"request_id", QStringLiteral("hello-1")},
+                   {"type", QStringLiteral("hello")},
+                   {"protocol_version", ParaViewMCP::ProtocolVersion},
+                   {"auth_token", QString()},
+                 });
+  QJsonObject response;
+  QVERIFY(waitForJsonMessage(client, &response, &error));
+  QCOMPARE(response.value(QStringLiteral("status")).toString(), QStringLiteral("success"));
+  QTRY_VERIFY_WITH_TIMEOUT(bridge.handshakeComplete(), 2000);
+
+  writeJsonFrame(client,
+                 QJsonObject{
+                   {"request_id", QStringLiteral("ping-1")},
+                   {"type", QStringLiteral("ping")},
+                   {"params", QJsonObject()},
+                 });
+  QVERIFY(waitForJsonMessage(client, &response, &error));
+  QCOMPARE(response.value(QStringLiteral("request_id")).toString(), QStringLiteral("ping-1"));
+
+  QLocalSocket secondClient;
+  QVERIFY(connectLocalSocket(secondClient, bridge.socketPath(), &error));
+  QVERIFY(waitForJsonMessage(secondClient, &response, &error));
+  QCOMPARE(
+    response.value(QStringLiteral("error")).toObject().value(QStringLiteral("code")).toString(),
+    QStringLiteral("CLIENT_BUSY"));
+
+  client.disconnectFromServer();
+  QTRY_VERIFY_WITH_TIMEOUT(!bridge.hasClient(), 2000);
+  QVERIFY(!bridge.handshakeComplete());
+
+  bridge.stop();
+  QVERIFY(!bridge.isListening());
+}
+
+void TestParaViewMCPSocketBridge::reclaimsStaleLocalSocketFiles()
+{
+#ifdef Q_OS_WIN
+  QSKIP("Named pipes leave no file behind");
+#else
+  FakeParaViewMCPPythonBridge bridgeImpl;
+  ParaViewMCPRequestHandler handler(bridgeImpl);
+  ParaViewMCPSocketBridge bridge(bridgeImpl, handler);
+
+  // What a crashed ParaView leaves behind: the path exists, nobody listens.
+  QTemporaryDir directory;
+  QVERIFY(directory.isValid());
+  const QString path = directory.filePath(QStringLiteral("stale.sock"));
+  QFile stale(path);
+  QVERIFY(stale.open(QIODevice::WriteOnly));
+  stale.close();
+
+  ParaViewMCPServerConfig config;
+  config.SocketPath = path;
+  QString error;
+  QVERIFY2(bridge.start(config, &error), qPrintable(error));
+
+  // A live listener on the same path must not be taken over.
+  FakeParaViewMCPPythonBridge otherImpl;
+  ParaViewMCPRequestHandler otherHandler(otherImpl);
+  ParaViewMCPSocketBridge other(otherImpl, otherHandler);
+  QVERIFY(!other.start(config, &error));
+  QVERIFY(bridge.isListening());
+
+  QLocalSocket client;
+  QVERIFY(connectLocalSocket(client, path, &error));
+  QTRY_VERIFY_WITH_TIMEOUT(bridge.hasClient(), 2000);
+
+  bridge.stop();
+#endif
+}
+
+void TestParaViewMCPSocketBridge::sharedMemoryCarriesLargeBodies()
+{
+  FakeParaViewMCPPythonBridge bridgeImpl;
+  bridgeImpl.ScreenshotBytes = QByteArray(128 * 1024, 'p');
+  bridgeImpl.ExecutePayload = QJsonObject{{"stdout", QString(96 * 1024, QLatin1Char('x'))}};
+  ParaViewMCPRequestHandler handler(bridgeImpl);
+  ParaViewMCPSocketBridge bridge(bridgeImpl, handler);
+
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("127.0.0.1");
+  config.Port = 0;
+  config.SharedMemoryBytes = 1024 * 1024;
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+
+  QTcpSocket client;
+  QVERIFY(connectClientSocket(client, bridge.serverPort(), &error));
+  writeJsonFrame(client,
+                 QJsonObject{
+                   {"request_id", QStringLiteral("hello-1")},
+                   {"type", QStringLiteral("hello")},
+                   {"protocol_version", ParaViewMCP::ProtocolVersion},
+                   {"auth_token", QString()},
+                   {"capabilities",
+                    QJsonArray{
+                      ParaViewMCP::binaryAttachmentsCapability(),
+                      ParaViewMCP::sharedMemoryCapability(),
+                    }},
+                 });
+  QJsonObject response;
+  QVERIFY(waitForJsonMessage(client, &response, &error));
+  const QJsonObject hello = response.value(QStringLiteral("result")).toObject();
+  QVERIFY(hello.value(QStringLiteral("capabilities"))
+            .toArray()
+            .contains(ParaViewMCP::sharedMemoryCapability()));
+  const QJsonObject shared = hello.value(QStringLiteral("shared_memory")).toObject();
+  QCOMPARE(shared.value(QStringLiteral("size")).toDouble(),
+           static_cast<double>(ParaViewMCPSharedRegion::HeaderBytes + 1024 * 1024));
+
+  QFile file(shared.value(QStringLiteral("path")).toString());
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  uchar* mapped = file.map(0, file.size());
+  QVERIFY(mapped != nullptr);
+  const auto body = [mapped](const QJsonObject& spec, const QString& lengthKey)
+  {
+    const auto position = static_cast<qint64>(spec.value(QStringLiteral("position")).toDouble());
+    const auto length = static_cast<qsizetype>(spec.value(lengthKey).toDouble());
+    return QByteArray(reinterpret_cast<const char*>(mapped) +
+                        ParaViewMCPSharedRegion::HeaderBytes + position,
+                      length);
+  };
+
+  // The screenshot bytes stay out of the socket; its descriptor says where
+  // they are and no binary frame follows the envelope.
+  writeJsonFrame(client,
+                 QJsonObject{
+                   {"request_id", QStringLiteral("shot-1")},
+                   {"type", QStringLiteral("capture_screenshot")},
+                   {"params", QJsonObject()},
+                 });
+  QVERIFY2(waitForJsonMessage(client, &response, &error), qPrintable(error));
+  const QJsonObject descriptor =
+    response.value(QStringLiteral("attachments")).toArray().first().toObject();
+  QCOMPARE(descriptor.value(QStringLiteral("position")).toDouble(), 0.0);
+  QCOMPARE(body(descriptor, QStringLiteral("size")), bridgeImpl.ScreenshotBytes);
+
+  // A large envelope is replaced by a frame pointing at it.
+  writeJsonFrame(client,
+                 QJsonObject{
+                   {"request_id", QStringLiteral("exec-1")},
+                   {"type", QStringLiteral("execute_python")},
+                   {"params", QJsonObject{{"code", QStringLiteral("print(1)")}}},
+                 });
+  QVERIFY2(waitForJsonMessage(client, &response, &error), qPrintable(error));
+  QCOMPARE(response.value(QStringLiteral("request_id")).toString(), QStringLiteral("exec-1"));
+  const QJsonObject pointer = response.value(QStringLiteral("shared_payload")).toObject();
+  QCOMPARE(pointer.value(QStringLiteral("position")).toDouble(), 128.0 * 1024);
+  const QJsonObject envelope =
+    QJsonDocument::fromJson(body(pointer, QStringLiteral("length"))).object();
+  QCOMPARE(envelope.value(QStringLiteral("request_id")).toString(), QStringLiteral("exec-1"));
+  QCOMPARE(envelope.value(QStringLiteral("result")).toObject(), bridgeImpl.ExecutePayload);
+
+  // Small replies are still sent inline.
+  writeJsonFrame(client,
+                 QJsonObject{
+                   {"request_id", QStringLiteral("ping-1")},
+                   {"type", QStringLiteral("ping")},
+                   {"params", QJsonObject()},
+                 });
+  QVERIFY(waitForJsonMessage(client, &response, &error));
+  QCOMPARE(response.value(QStringLiteral("status")).toString(), QStringLiteral("success"));
+
+  // The region belongs to the connection and goes away with it.
+  file.unmap(mapped);
+  file.close();
+  client.disconnectFromHost();
+  QTRY_VERIFY_WITH_TIMEOUT(!bridge.hasClient(), 2000);
+  QVERIFY(!QFile::exists(file.fileName()));
+
+  bridge.stop();
+}
+
+void TestParaViewMCPSocketBridge::slowReaderPausesItsRequests()
+{
+  FakeParaViewMCPPythonBridge bridgeImpl;
+  bridgeImpl.ExecutePayload = QJsonObject{{"output", QString(1024 * 1024, QLatin1Char('x'))}};
+  ParaViewMCPRequestHandler handler(bridgeImpl);
+  ParaViewMCPSocketBridge bridge(bridgeImpl, handler);
+
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("127.0.0.1");
+  config.Port = 0;
+  config.OutboundHighWatermark = 1024 * 1024;
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+
+  QTcpSocket client;
+  QVERIFY(connectClientSocket(client, bridge.serverPort(), &error));
+  QVERIFY2(completeHello(client, QStringLiteral("hello-1"), &error), qPrintable(error));
+
+  // More replies than the loopback buffers hold, and a client that stops
+  // taking them: the backlog builds up in the bridge and crosses the mark.
+  client.setReadBufferSize(64 * 1024);
+  const int firstBatch = 32;
+  for (int index = 0; index < firstBatch; ++index)
+  {
+    writeJsonFrame(client,
+                   executeRequest(QStringLiteral("exec-%1").arg(index), QStringLiteral("pass")));
+  }
+  QTRY_VERIFY_WITH_TIMEOUT(bridge.outboundStats().PausedConnections == 1, 10000);
+  QTRY_COMPARE_WITH_TIMEOUT(bridgeImpl.ExecuteCalls, firstBatch, 10000);
+
+  // Requests sent while paused are left unread.
+  const int secondBatch = 3;
+  for (int index = firstBatch; index < firstBatch + secondBatch; ++index)
+  {
+    writeJsonFrame(client,
+                   executeRequest(QStringLiteral("exec-%1").arg(index), QStringLiteral("pass")));
+  }
+  QTest::qWait(300);
+  QCOMPARE(bridgeImpl.ExecuteCalls, firstBatch);
+
+  // Once the client catches up, reading resumes and every request is
+  // answered in order.
+  client.setReadBufferSize(0);
+  QList<QJsonObject> responses;
+  QVERIFY2(waitForJsonMessages(client, firstBatch + secondBatch, &responses, &error, 30000),
+           qPrintable(error));
+  for (int index = 0; index < firstBatch + secondBatch; ++index)
+  {
+    QCOMPARE(responses.at(index).value(QStringLiteral("request_id")).toString(),
+             QStringLiteral("exec-%1").arg(index));
+  }
+  QCOMPARE(bridgeImpl.ExecuteCalls, firstBatch + secondBatch);
+
+  const ParaViewMCP::OutboundStats stats = bridge.outboundStats();
+  QCOMPARE(stats.PausedConnections, 0);
+  QVERIFY(stats.Pauses >= 1);
+  QVERIFY(stats.PeakQueuedBytes > config.OutboundHighWatermark);
+
+  bridge.stop();
+}
+
+void TestParaViewMCPSocketBridge::heartbeatsMeasureLatencyAndDropSilentClients()
+{
+  FakeParaViewMCPPythonBridge bridgeImpl;
+  ParaViewMCPRequestHandler handler(bridgeImpl);
+  ParaViewMCPSocketBridge bridge(bridgeImpl, handler);
+  QSignalSpy latencySpy(&bridge, &ParaViewMCPSocketBridge::latencyChanged);
+
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("127.0.0.1");
+  config.Port = 0;
+  config.ResumeGraceMs = 0;
+  config.HeartbeatIntervalMs = 50;
+  config.HeartbeatTimeoutMs = 200;
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+
+  QTcpSocket client;
+  QVERIFY(connectClientSocket(client, bridge.serverPort(), &error));
+  writeJsonFrame(client,
+                 QJsonObject{
+                   {"request_id", QStringLiteral("hello-1")},
+                   {"type", QStringLiteral("hello")},
+                   {"protocol_version", ParaViewMCP::ProtocolVersion},
+                   {"auth_token", QString()},
+                   {"capabilities", QJsonArray{ParaViewMCP::heartbeatCapability()}},
+                 });
+  QJsonObject response;
+  QVERIFY(waitForJsonMessage(client, &response, &error));
+  QVERIFY(response.value(QStringLiteral("result"))
+            .toObject()
+            .value(QStringLiteral("capabilities"))
+            .toArray()
+            .contains(ParaViewMCP::heartbeatCapability()));
+
+  // Answered heartbeats become round-trip samples.
+  for (int beat = 0; beat < 3; ++beat)
+  {
+    QJsonObject heartbeat;
+    QVERIFY2(waitForJsonMessage(client, &heartbeat, &error), qPrintable(error));
+    QCOMPARE(heartbeat.value(QStringLiteral("type")).toString(), QStringLiteral("heartbeat"));
+    writeJsonFrame(client,
+                   QJsonObject{
+                     {"type", QStringLiteral("heartbeat_ack")},
+                     {"heartbeat_id", heartbeat.value(QStringLiteral("heartbeat_id"))},
+                   });
+  }
+  QTRY_VERIFY_WITH_TIMEOUT(bridge.latencyStats().Samples >= 3, 2000);
+  const ParaViewMCP::LatencyStats stats = bridge.latencyStats();
+  QVERIFY(stats.P50Ms <= stats.P90Ms && stats.P90Ms <= stats.P99Ms);
+  QVERIFY(latencySpy.count() >= 3);
+  QCOMPARE(bridgeImpl.ExecuteCalls, 0);
+
+  // A client that stops answering is dropped, and its samples with it.
+  QTRY_VERIFY_WITH_TIMEOUT(!bridge.hasClient(), 2000);
+  QTRY_COMPARE_WITH_TIMEOUT(bridge.latencyStats().Samples, 0, 2000);
+  QCOMPARE(bridgeImpl.ResetCalls, 2);
+
+  bridge.stop();
+}
+
+void TestParaViewMCPSocketBridge::cancelStopsRunningAndQueuedRequests()
+{
+  FakeParaViewMCPPythonBridge bridgeImpl;
+  ParaViewMCPRequestHandler handler(bridgeImpl);
+  ParaViewMCPSocketBridge bridge(bridgeImpl, handler);
+
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("127.0.0.1");
+  config.Port = 0;
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+
+  QTcpSocket client;
+  QVERIFY(connectClientSocket(client, bridge.serverPort(), &error));
+  QVERIFY2(completeHello(client, QStringLiteral("hello-1"), &error), qPrintable(error));
+
+  const auto cancelRequest = [](const QString& requestId, const QString& targetId)
+  {
+    return QJsonObject{
+      {"request_id", requestId},
+      {"type", QStringLiteral("cancel")},
+      {"params", QJsonObject{{"request_id", targetId}}},
+    };
+  };
+
+  // While exec-1 runs, the client cancels the exec-2 it queued behind it and
+  // then exec-1 itself. The hook holds the GUI thread until the network
+  // thread has interrupted it.
+  bridgeImpl.ExecuteHook = [&]()
+  {
+    writeJsonFrame(client, cancelRequest(QStringLiteral("cancel-2"), QStringLiteral("exec-2")));
+    writeJsonFrame(client, cancelRequest(QStringLiteral("cancel-1"), QStringLiteral("exec-1")));
+    QElapsedTimer timer;
+    timer.start();
+    while (!bridgeImpl.Interrupted && timer.elapsed() < 2000)
+    {
+      QThread::msleep(10);
+    }
+  };
+  QByteArray batch;
+  batch.append(
+    ParaViewMCP::encodeMessage(executeRequest(QStringLiteral("exec-1"), QStringLiteral("a"))));
+  batch.append(
+    ParaViewMCP::encodeMessage(executeRequest(QStringLiteral("exec-2"), QStringLiteral("b"))));
+  client.write(batch);
+  client.flush();
+
+  QList<QJsonObject> responses;
+  QVERIFY2(waitForJsonMessages(client, 4, &responses, &error), qPrintable(error));
+  QHash<QString, QJsonObject> byId;
+  for (const QJsonObject& response : responses)
+  {
+    byId.insert(response.value(QStringLiteral("request_id")).toString(), response);
+  }
+  for (const QString& requestId : {QStringLiteral("exec-1"), QStringLiteral("exec-2")})
+  {
+    QCOMPARE(byId.value(requestId)
+               .value(QStringLiteral("error"))
+               .toObject()
+               .value(QStringLiteral("code"))
+               .toString(),
+             QStringLiteral("CANCELLED"));
+  }
+  for (const QString& requestId : {QStringLiteral("cancel-1"), QStringLiteral("cancel-2")})
+  {
+    QVERIFY(byId.value(requestId)
+              .value(QStringLiteral("result"))
+              .toObject()
+              .value(QStringLiteral("cancelled"))
+              .toBool());
+  }
+  QCOMPARE(bridgeImpl.ExecuteCalls, 1);
+
+  // Nothing left to cancel.
+  bridgeImpl.ExecuteHook = nullptr;
+  writeJsonFrame(client, cancelRequest(QStringLiteral("cancel-3"), QStringLiteral("exec-1")));
+  QJsonObject response;
+  QVERIFY(waitForJsonMessage(client, &response, &error));
+  QCOMPARE(response.value(QStringLiteral("status")).toString(), QStringLiteral("success"));
+  const QJsonObject result = response.value(QStringLiteral("result")).toObject();
+  QVERIFY(!result.value(QStringLiteral("cancelled")).toBool());
+
+  bridge.stop();
+}
+
+void TestParaViewMCPSocketBridge::statusIsAnsweredWhilePythonRuns()
+{
+  FakeParaViewMCPPythonBridge bridgeImpl;
+  ParaViewMCPRequestHandler handler(bridgeImpl);
+  ParaViewMCPSocketBridge bridge(bridgeImpl, handler);
+
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("127.0.0.1");
+  config.Port = 0;
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+
+  QTcpSocket client;
+  QVERIFY(connectClientSocket(client, bridge.serverPort(), &error));
+  QVERIFY2(completeHello(client, QStringLiteral("hello-1"), &error), qPrintable(error));
+
+  const QJsonObject statusRequest{
+    {"request_id", QStringLiteral("status-1")},
+    {"type", QStringLiteral("status")},
+  };
+  QList<QJsonObject> duringExecute;
+  bridgeImpl.ExecuteHook = [&]()
+  {
+    QThread::msleep(20);
+    writeJsonFrame(client, statusRequest);
+    ParaViewMCPReadBuffer buffer;
+    while (duringExecute.isEmpty() && client.waitForReadyRead(2000))
+    {
+      buffer.readFrom(&client);
+      ParaViewMCP::tryExtractMessages(buffer, duringExecute, nullptr);
+    }
+  };
+  writeJsonFrame(client, executeRequest(QStringLiteral("exec-1"), QStringLiteral("x = 1")));
+  QJsonObject response;
+  QVERIFY(waitForJsonMessage(client, &response, &error));
+  QCOMPARE(response.value(QStringLiteral("request_id")).toString(), QStringLiteral("exec-1"));
+
+  QCOMPARE(duringExecute.size(), 1);
+  QJsonObject status = duringExecute.first().value(QStringLiteral("result")).toObject();
+  QVERIFY(status.value(QStringLiteral("busy")).toBool());
+  QVERIFY(status.value(QStringLiteral("busy_ms")).toDouble() >= 20.0);
+  QCOMPARE(status.value(QStringLiteral("running_request_id")).toString(),
+           QStringLiteral("exec-1"));
+  QCOMPARE(status.value(QStringLiteral("pending")).toInt(), 1);
+  QCOMPARE(status.value(QStringLiteral("sessions")).toInt(), 1);
+  QVERIFY(status.value(QStringLiteral("outbound")).isObject());
+  QVERIFY(status.value(QStringLiteral("latency")).isObject());
+  QVERIFY(status.value(QStringLiteral("compression")).isObject());
+
+  bridgeImpl.ExecuteHook = nullptr;
+  writeJsonFrame(client, statusRequest);
+  QVERIFY(waitForJsonMessage(client, &response, &error));
+  status = response.value(QStringLiteral("result")).toObject();
+  QVERIFY(!status.value(QStringLiteral("busy")).toBool());
+  QVERIFY(!status.contains(QStringLiteral("running_request_id")));
+  QCOMPARE(status.value(QStringLiteral("pending")).toInt(), 0);
+
+  bridge.stop();
+}
+
+void TestParaViewMCPSocketBridge::resumeTokenKeepsTheSessionAcrossReconnects()
+{
+  FakeParaViewMCPPythonBridge bridgeImpl;
+  ParaViewMCPRequestHandler handler(bridgeImpl);
+  ParaViewMCPSocketBridge bridge(bridgeImpl, handler);
+
+  ParaViewMCPServerConfig config;
+  config.Host = QStringLiteral("127.0.0.1");
+  config.Port = 0;
+  config.ResumeGraceMs = 300;
+  QString error;
+  if (!bridge.start(config, &error))
+  {
+    QSKIP(qPrintable(error));
+  }
+
+  auto hello = [](const QString& resumeToken)
+  {
+    return QJsonObject{
+      {"request_id", QStringLiteral("hello-1")},
+      {"type", QStringLiteral("hello")},
+      {"protocol_version", ParaViewMCP::ProtocolVersion},
+      {"auth_token", QString()},
+      {"resume_token", resumeToken},
+    };
+  };
+
+  QTcpSocket first;
+  QVERIFY(connectClientSocket(first, bridge.serverPort(), &error));
+  writeJsonFrame(first, hello(QString()));
+  QJsonObject response;
+  QVERIFY(waitForJsonMessage(first, &response, &error));
+  QJsonObject result = response.value(QStringLiteral("result")).toObject();
+  const QString token = result.value(QStringLiteral("resume_token")).toString();
+  QVERIFY(!token.isEmpty());
+  QVERIFY(!result.value(QStringLiteral("resumed")).toBool());
+  const quint64 session = bridgeImpl.ActiveSession;
+  QCOMPARE(bridgeImpl.ResetCalls, 1);
+
+  // A dropped client's session outlives the connection...
+  first.disconnectFromHost();
+  QTRY_VERIFY_WITH_TIMEOUT(!bridge.hasClient(), 2000);
+  QVERIFY(bridgeImpl.ClosedSessions.isEmpty());
+  QCOMPARE(bridgeImpl.ResetCalls, 1);
+
+  // ...and a reconnect presenting the token carries on in it.
+  QTcpSocket second;
+  QVERIFY(connectClientSocket(second, bridge.serverPort(), &error));
+  writeJsonFrame(second, hello(token));
+  QVERIFY(waitForJsonMessage(second, &response, &error));
+  result = response.value(QStringLiteral("result")).toObject();
+  QVERIFY(result.value(QStringLiteral("resumed")).toBool());
+  const QString nextToken = result.value(QStringLiteral("resume_token")).toString();
+  QVERIFY(!nextToken.isEmpty() && nextToken != token);
+  QCOMPARE(bridgeImpl.ResetCalls, 1);
+  writeJsonFrame(second, executeRequest(QStringLiteral("exec-1"), QStringLiteral("x = 1")));
+  QVERIFY(waitForJsonMessage(second, &response, &error));
+  QCOMPARE(bridgeImpl.ActiveSession, session);
+
+  // Tokens are single use.
+  QTcpSocket stale;
+  QVERIFY(connectClientSocket(stale, bridge.serverPort(), &error));
+  writeJsonFrame(stale, hello(token));
+  QVERIFY(waitForJsonMessage(stale, &response, &error));
+  QVERIFY(!response.value(QStringLiteral("result"))
+             .toObject()
+             .value(QStringLiteral("resumed"))
+             .toBool());
+  stale.disconnectFromHost();
+
+  // Nobody comes back this time, so the grace period ends in a reset.
+  second.disconnectFromHost();
+  QTRY_VERIFY_WITH_TIMEOUT(!bridge.hasClient(), 2000);
+  QTRY_VERIFY_WITH_TIMEOUT(bridgeImpl.ClosedSessions.contains(session), 2000);
+  QTRY_COMPARE_WITH_TIMEOUT(bridgeImpl.ResetCalls, 3, 2000);
+
+  bridge.stop();
+}
+
 QTEST_MAIN(TestParaViewMCPSocketBridge)
 
 #include "TestParaViewMCPSocketBridge.moc"
@@ -3,15 +3,56 @@
 from __future__ import annotations
 
 import json
+import mmap
 import socket
 import struct
+import zlib
+from collections.abc import Iterator
+from contextlib import contextmanager
+from dataclasses import dataclass
 from typing import Any
 
+try:
+    import cbor2
+except ImportError:  # pragma: no cover - optional dependency
+    cbor2 = None
+
 DEFAULT_HOST = "127.0.0.1"
 DEFAULT_PORT = 9877
 DEFAULT_TIMEOUT_SECONDS = 180.0
 MAX_FRAME_BYTES = 25 * 1024 * 1024
+# Bounds for a frame limit requested in 'hello'; the plugin clamps to these.
+MIN_FRAME_BYTES = 64 * 1024
+MAX_MESSAGE_BYTES = 1024 * 1024 * 1024
 PROTOCOL_VERSION = 2
+# SO_SNDBUF/SO_RCVBUF for TCP connections, the same as the plugin's default.
+DEFAULT_SOCKET_BUFFER_BYTES = 1024 * 1024
+
+# The top four bits of a frame header are flags for negotiated extensions.
+FRAME_LENGTH_MASK = 0x0FFFFFFF
+FRAME_FLAG_COMPRESSED = 0x80000000
+FRAME_FLAG_CONTINUED = 0x40000000
+FRAME_FLAG_BINARY = 0x20000000
+FRAME_FLAG_CBOR = 0x10000000
+
+CAPABILITY_BINARY_ATTACHMENTS = "binary_attachments"
+CAPABILITY_CHUNKED_FRAMES = "chunked_frames"
+CAPABILITY_CBOR = "cbor"
+CAPABILITY_SHARED_MEMORY = "shared_memory"
+# The plugin sends {"type": "heartbeat", "heartbeat_id": n} and expects the id
+# echoed back in a "heartbeat_ack"; a client that stops answering is dropped.
+CAPABILITY_HEARTBEAT = "heartbeat"
+# Listed by plugins that accept {"type": "cancel", "params": {"request_id": id}}.
+CAPABILITY_CANCEL = "cancel"
+# Replies to commands carry a "timings" object: milliseconds per phase.
+CAPABILITY_TIMINGS = "timings"
+
+# The plugin's shared region starts with this header; its first 8 bytes hold
+# the little-endian ring position the client has finished reading up to.
+SHARED_HEADER_BYTES = 64
+
+COMPRESSION_ZLIB = "zlib"
+DEFAULT_COMPRESSION_THRESHOLD = 1024
 
 
 class ProtocolError(RuntimeError):
@@ -26,26 +67,237 @@ class ConnectionClosedError(ProtocolError):
     """Raised when the socket closes mid-frame."""
 
 
+@dataclass
+class CompressionStats:
+    """Byte counters for payloads that were actually sent or received compressed."""
+
+    frames: int = 0
+    bytes_before: int = 0
+    bytes_after: int = 0
+
+    @property
+    def bytes_saved(self) -> int:
+        return self.bytes_before - self.bytes_after
+
+    def record(self, before: int, after: int) -> None:
+        self.frames += 1
+        self.bytes_before += before
+        self.bytes_after += after
+
+
+class SharedRegion:
+    """Client side of the plugin's file-backed result ring.
+
+    Bodies are addressed by ring position, a monotonic byte count whose data
+    lives at ``SHARED_HEADER_BYTES + position % capacity`` and never wraps.
+    Writing the release cursor hands everything before it back to the plugin,
+    so it only moves once a whole message, attachments included, has been read.
+    """
+
+    def __init__(self, path: str, size: int) -> None:
+        with open(path, "r+b") as handle:
+            self._map = mmap.mmap(handle.fileno(), size)
+        self.capacity = size - SHARED_HEADER_BYTES
+        self._released = 0
+        self._read_up_to = 0
+        if self.capacity <= 0:
+            self._map.close()
+            raise ProtocolError("Shared memory region is too small")
+
+    @contextmanager
+    def body(self, position: int, length: int) -> Iterator[memoryview]:
+        """Yield a zero-copy view of one body; ``release()`` hands it back."""
+        offset = position % self.capacity if position >= 0 else -1
+        if position < self._released or length < 0 or offset < 0 or offset + length > self.capacity:
+            raise ProtocolError(f"Shared body at {position} (+{length}) is outside the region")
+        start = SHARED_HEADER_BYTES + offset
+        with memoryview(self._map) as whole, whole[start : start + length] as view:
+            yield view
+        self._read_up_to = max(self._read_up_to, position + length)
+
+    def release(self) -> None:
+        """Let the plugin reuse every body read so far."""
+        if self._read_up_to > self._released:
+            self._released = self._read_up_to
+            struct.pack_into("<Q", self._map, 0, self._released)
+
+    def close(self) -> None:
+        try:
+            self._map.close()
+        except BufferError:
+            # A caller still holds a view; the mapping goes when it is collected.
+            pass
+
+
+def cbor_available() -> bool:
+    """Return True when the optional ``cbor2`` package can be used."""
+    return cbor2 is not None
+
+
+def clamp_frame_bytes(frame_bytes: int) -> int:
+    """Bound a frame limit to what the plugin accepts and a header can carry."""
+    return max(MIN_FRAME_BYTES, min(frame_bytes, FRAME_LENGTH_MASK))
+
+
 def is_loopback_host(host: str) -> bool:
     """Return True when the host points to loopback."""
     normalized = host.strip().lower()
     return normalized in {"127.0.0.1", "localhost", "::1"}
 
 
-def encode_message(message: dict[str, Any], *, max_frame_bytes: int = MAX_FRAME_BYTES) -> bytes:
-    """Encode a message into a length-prefixed frame."""
-    payload = json.dumps(message, ensure_ascii=True, separators=(",", ":")).encode("utf-8")
+def compress_payload(
+    payload: bytes, *, threshold: int, stats: CompressionStats | None = None
+) -> tuple[int, bytes]:
+    """Return ``(flags, payload)``, compressing in the plugin's qCompress layout.
+
+    The compressed form is a 4-byte big-endian original size followed by a zlib
+    stream, and is only used when it is actually smaller than the input.
+    """
+    if len(payload) < threshold:
+        return 0, payload
+    compressed = struct.pack(">I", len(payload)) + zlib.compress(payload)
+    if len(compressed) >= len(payload):
+        return 0, payload
+    if stats is not None:
+        stats.record(len(payload), len(compressed))
+    return FRAME_FLAG_COMPRESSED, compressed
+
+
+def decompress_payload(
+    payload: bytes | bytearray,
+    *,
+    max_inflated_bytes: int = MAX_FRAME_BYTES,
+    stats: CompressionStats | None = None,
+) -> bytes:
+    """Inflate a payload produced by ``compress_payload`` or the plugin's qCompress.
+
+    The declared size is checked against ``max_inflated_bytes`` before anything
+    is inflated, so a small frame cannot expand past what the peer could have
+    sent uncompressed.
+    """
+    if len(payload) < 4:
+        raise ProtocolError("Received a compressed payload with an invalid size")
+    declared_size = struct.unpack_from(">I", payload)[0]
+    if declared_size > max_inflated_bytes:
+        raise FrameTooLargeError(
+            f"Compressed payload expands to {declared_size} bytes, "
+            f"exceeding the limit of {max_inflated_bytes} bytes"
+        )
+    inflater = zlib.decompressobj()
+    try:
+        inflated = inflater.decompress(memoryview(payload)[4:], declared_size)
+    except zlib.error as exc:
+        raise ProtocolError("Received a corrupt compressed payload") from exc
+    if len(inflated) != declared_size or inflater.unconsumed_tail:
+        raise ProtocolError("Received a corrupt compressed payload")
+    if stats is not None:
+        stats.record(declared_size, len(payload))
+    return inflated
+
+
+def encode_message(
+    message: dict[str, Any],
+    *,
+    max_frame_bytes: int = MAX_FRAME_BYTES,
+    cbor: bool = False,
+    compression_threshold: int | None = None,
+    stats: CompressionStats | None = None,
+) -> bytes:
+    """Encode a message into a length-prefixed frame.
+
+    ``cbor`` and ``compression_threshold`` are only set once negotiated.
+    """
+    if cbor:
+        if cbor2 is None:
+            raise ProtocolError("CBOR framing requires the 'cbor2' package")
+        flags = FRAME_FLAG_CBOR
+        payload = cbor2.dumps(message)
+    else:
+        flags = 0
+        payload = json.dumps(message, ensure_ascii=True, separators=(",", ":")).encode("utf-8")
+    if compression_threshold is not None:
+        compressed, payload = compress_payload(
+            payload, threshold=compression_threshold, stats=stats
+        )
+        flags |= compressed
     if len(payload) > max_frame_bytes:
         raise FrameTooLargeError(
             f"Frame payload is {len(payload)} bytes, exceeding the limit of {max_frame_bytes} bytes"
         )
-    return struct.pack(">I", len(payload)) + payload
+    return struct.pack(">I", len(payload) | flags) + payload
+
+
+def encode_frame(payload: bytes, *, flags: int = 0) -> bytes:
+    """Prefix raw payload bytes with a (possibly flagged) frame header."""
+    return struct.pack(">I", len(payload) | flags) + payload
+
+
+def split_header(header: bytes, *, max_frame_bytes: int) -> tuple[int, int]:
+    """Return ``(flags, length)`` for a 4-byte frame header."""
+    value = struct.unpack(">I", header)[0]
+    frame_length = value & FRAME_LENGTH_MASK
+    if frame_length > max_frame_bytes:
+        raise FrameTooLargeError(
+            f"Incoming frame length {frame_length} exceeds limit {max_frame_bytes}"
+        )
+    return value & ~FRAME_LENGTH_MASK, frame_length
+
+
+def attachment_count(message: dict[str, Any]) -> int:
+    """Return how many binary frames follow this envelope."""
+    specs = message.get("attachments")
+    if specs is None:
+        return 0
+    if not isinstance(specs, list) or not all(isinstance(spec, dict) for spec in specs):
+        raise ProtocolError("Envelope 'attachments' must be a list of objects")
+    # Attachments placed in the shared region carry a position instead of a frame.
+    return sum(1 for spec in specs if "position" not in spec)
 
 
-def decode_payload(payload: bytes) -> dict[str, Any]:
+def bind_attachments(
+    message: dict[str, Any],
+    payloads: list[bytes | bytearray],
+    shared: SharedRegion | None = None,
+) -> dict[str, Any]:
+    """Move attachment payloads into ``message['result']`` under their keys."""
+    specs = message.pop("attachments", None) or []
+    result = message.get("result")
+    if not isinstance(result, dict):
+        raise ProtocolError("Attachments require an object 'result'")
+    inline = iter(payloads)
+    for spec in specs:
+        key = spec.get("key")
+        if not isinstance(key, str) or not key:
+            raise ProtocolError("Attachment descriptor is missing a key")
+        size = spec.get("size")
+        if "position" in spec:
+            payload = _read_shared(shared, spec.get("position"), size)
+        else:
+            payload = next(inline, None)
+            if payload is None:
+                raise ProtocolError("Envelope lists more attachments than were sent")
+        if size != len(payload):
+            raise ProtocolError(f"Attachment '{key}' size does not match its descriptor")
+        result[key] = payload
+    if next(inline, None) is not None:
+        raise ProtocolError("Received more attachments than the envelope lists")
+    return message
+
+
+def _read_shared(shared: SharedRegion | None, position: Any, size: Any) -> bytes:
+    if shared is None:
+        raise ProtocolError("Received a shared memory body without a negotiated region")
+    if not isinstance(position, int) or not isinstance(size, int):
+        raise ProtocolError("Shared memory descriptors need integer position and size")
+    # The one copy out of the mapping: results outlive the ring slot they came from.
+    with shared.body(position, size) as view:
+        return bytes(view)
+
+
+def decode_payload(payload: bytes | bytearray | memoryview) -> dict[str, Any]:
     """Decode a UTF-8 JSON payload."""
     try:
-        message = json.loads(payload.decode("utf-8"))
+        message = json.loads(str(payload, "utf-8"))
     except UnicodeDecodeError as exc:
         raise ProtocolError("Received a non-UTF-8 payload") from exc
     except json.JSONDecodeError as exc:
@@ -56,12 +308,86 @@ def decode_payload(payload: bytes) -> dict[str, Any]:
     return message
 
 
+def decode_cbor_payload(payload: bytes | bytearray | memoryview) -> dict[str, Any]:
+    """Decode a CBOR map payload."""
+    if cbor2 is None:
+        raise ProtocolError("Received a CBOR payload but 'cbor2' is not installed")
+    try:
+        message = cbor2.loads(payload)
+    except (cbor2.CBORDecodeError, ValueError) as exc:
+        raise ProtocolError(f"Received invalid CBOR: {exc}") from exc
+
+    if not isinstance(message, dict):
+        raise ProtocolError("Protocol message must decode to a CBOR map")
+    return message
+
+
+def decode_envelope(
+    flags: int,
+    payload: bytes | bytearray | memoryview,
+    *,
+    compression: bool = False,
+    cbor: bool = False,
+    chunked: bool = False,
+    max_frame_bytes: int = MAX_FRAME_BYTES,
+    max_message_bytes: int = MAX_MESSAGE_BYTES,
+    stats: CompressionStats | None = None,
+) -> dict[str, Any]:
+    """Decode an envelope frame with whichever negotiated encoding it is flagged with.
+
+    A compressed envelope may inflate to one frame, or to a whole message once
+    chunked frames are negotiated.
+    """
+    allowed = (FRAME_FLAG_COMPRESSED if compression else 0) | (FRAME_FLAG_CBOR if cbor else 0)
+    if flags & ~allowed:
+        raise ProtocolError(f"Unexpected frame flags 0x{flags:08x}")
+    if flags & FRAME_FLAG_COMPRESSED:
+        limit = max_message_bytes if chunked else max_frame_bytes
+        payload = decompress_payload(payload, max_inflated_bytes=limit, stats=stats)
+    if flags & FRAME_FLAG_CBOR:
+        return decode_cbor_payload(payload)
+    return decode_payload(payload)
+
+
+def decode_shared_envelope(
+    pointer: dict[str, Any], shared: SharedRegion, **options: Any
+) -> dict[str, Any]:
+    """Decode an envelope the plugin placed in the shared region, straight from the mapping."""
+    spec = pointer.get("shared_payload")
+    if not isinstance(spec, dict):
+        raise ProtocolError("Malformed shared_payload descriptor")
+    position, length, flags = (spec.get(name) for name in ("position", "length", "flags"))
+    if not all(isinstance(value, int) for value in (position, length, flags)):
+        raise ProtocolError("Malformed shared_payload descriptor")
+    with shared.body(position, length) as view:
+        return decode_envelope(flags, view, **options)
+
+
 class FrameBuffer:
     """Incrementally decodes length-prefixed JSON frames."""
 
-    def __init__(self, *, max_frame_bytes: int = MAX_FRAME_BYTES) -> None:
+    def __init__(
+        self,
+        *,
+        max_frame_bytes: int = MAX_FRAME_BYTES,
+        max_message_bytes: int = MAX_MESSAGE_BYTES,
+        compression: bool = False,
+        cbor: bool = False,
+        chunked: bool = False,
+        stats: CompressionStats | None = None,
+    ) -> None:
         self._buffer = bytearray()
         self._max_frame_bytes = max_frame_bytes
+        self._max_message_bytes = max_message_bytes
+        self._compression = compression
+        self._cbor = cbor
+        self._chunked = chunked
+        self._stats = stats
+        self._pending: dict[str, Any] | None = None
+        self._pending_payloads: list[bytes | bytearray] = []
+        self._pending_remaining = 0
+        self._chunk_flags: int | None = None
+        self._chunks = bytearray()
 
     def feed(self, data: bytes) -> list[dict[str, Any]]:
         """Add bytes and return any fully decoded messages."""
@@ -75,11 +401,9 @@ class FrameBuffer:
             if len(self._buffer) < 4:
                 return messages
 
-            frame_length = struct.unpack(">I", self._buffer[:4])[0]
-            if frame_length > self._max_frame_bytes:
-                raise FrameTooLargeError(
-                    f"Incoming frame length {frame_length} exceeds limit {self._max_frame_bytes}"
-                )
+            flags, frame_length = split_header(
+                bytes(self._buffer[:4]), max_frame_bytes=self._max_frame_bytes
+            )
 
             total_length = 4 + frame_length
             if len(self._buffer) < total_length:
@@ -87,7 +411,64 @@ class FrameBuffer:
 
             payload = bytes(self._buffer[4:total_length])
             del self._buffer[:total_length]
-            messages.append(decode_payload(payload))
+            reassembled = self._accept_chunk(flags, payload)
+            if reassembled is None:
+                continue
+            message = self._accept_frame(*reassembled)
+            if message is not None:
+                messages.append(message)
+
+    def _accept_chunk(self, flags: int, payload: bytes) -> tuple[int, bytes | bytearray] | None:
+        kind = flags & ~FRAME_FLAG_CONTINUED
+        if self._chunk_flags is None:
+            if not flags & FRAME_FLAG_CONTINUED:
+                return kind, payload
+            self._chunk_flags = kind
+        elif kind != self._chunk_flags:
+            raise ProtocolError("Chunk flags changed in the middle of a message")
+
+        if len(self._chunks) + len(payload) > self._max_message_bytes:
+            raise FrameTooLargeError(
+                f"Chunked message exceeds the limit of {self._max_message_bytes} bytes"
+            )
+        self._chunks.extend(payload)
+        if flags & FRAME_FLAG_CONTINUED:
+            return None
+
+        body = self._chunks
+        self._chunk_flags = None
+        self._chunks = bytearray()
+        return kind, body
+
+    def _accept_frame(self, flags: int, payload: bytes | bytearray) -> dict[str, Any] | None:
+        if self._pending is not None:
+            if flags != FRAME_FLAG_BINARY:
+                raise ProtocolError("Expected a binary attachment frame")
+            self._pending_payloads.append(payload)
+            self._pending_remaining -= 1
+            if self._pending_remaining > 0:
+                return None
+            message = bind_attachments(self._pending, self._pending_payloads)
+            self._pending = None
+            self._pending_payloads = []
+            return message
+
+        message = decode_envelope(
+            flags,
+            payload,
+            compression=self._compression,
+            cbor=self._cbor,
+            chunked=self._chunked,
+            max_frame_bytes=self._max_frame_bytes,
+            max_message_bytes=self._max_message_bytes,
+            stats=self._stats,
+        )
+        count = attachment_count(message)
+        if count == 0:
+            return message
+        self._pending = message
+        self._pending_remaining = count
+        return None
 
 
 def recv_exactly(sock: socket.socket, size: int) -> bytes:
@@ -103,17 +484,86 @@ def recv_exactly(sock: socket.socket, size: int) -> bytes:
     return b"".join(chunks)
 
 
+def recv_into_exactly(sock: socket.socket, buffer: bytearray, size: int) -> None:
+    """Append exactly `size` bytes from the socket to `buffer` without temporaries."""
+    offset = len(buffer)
+    buffer.extend(bytes(size))
+    view = memoryview(buffer)
+    try:
+        while offset < len(buffer):
+            received = sock.recv_into(view[offset:])
+            if received == 0:
+                raise ConnectionClosedError("Socket closed while receiving a framed message")
+            offset += received
+    finally:
+        view.release()
+
+
+def recv_frame(
+    sock: socket.socket,
+    *,
+    max_frame_bytes: int = MAX_FRAME_BYTES,
+    max_message_bytes: int = MAX_MESSAGE_BYTES,
+) -> tuple[int, bytes | bytearray]:
+    """Receive one logical frame, reassembling chunked continuations in place."""
+    flags, frame_length = split_header(recv_exactly(sock, 4), max_frame_bytes=max_frame_bytes)
+    if not flags & FRAME_FLAG_CONTINUED:
+        return flags, recv_exactly(sock, frame_length)
+
+    kind = flags & ~FRAME_FLAG_CONTINUED
+    body = bytearray()
+    while True:
+        if len(body) + frame_length > max_message_bytes:
+            raise FrameTooLargeError(
+                f"Chunked message exceeds the limit of {max_message_bytes} bytes"
+            )
+        recv_into_exactly(sock, body, frame_length)
+        if not flags & FRAME_FLAG_CONTINUED:
+            return kind, body
+        flags, frame_length = split_header(recv_exactly(sock, 4), max_frame_bytes=max_frame_bytes)
+        if flags & ~FRAME_FLAG_CONTINUED != kind:
+            raise ProtocolError("Chunk flags changed in the middle of a message")
+
+
 def recv_message(
     sock: socket.socket,
     *,
     max_frame_bytes: int = MAX_FRAME_BYTES,
+    max_message_bytes: int = MAX_MESSAGE_BYTES,
+    compression: bool = False,
+    cbor: bool = False,
+    chunked: bool = False,
+    stats: CompressionStats | None = None,
+    shared: SharedRegion | None = None,
 ) -> dict[str, Any]:
-    """Receive one framed message from a blocking socket."""
-    header = recv_exactly(sock, 4)
-    frame_length = struct.unpack(">I", header)[0]
-    if frame_length > max_frame_bytes:
-        raise FrameTooLargeError(
-            f"Incoming frame length {frame_length} exceeds limit {max_frame_bytes}"
-        )
-    payload = recv_exactly(sock, frame_length)
-    return decode_payload(payload)
+    """Receive one framed message (plus any attachments) from a blocking socket.
+
+    With a negotiated ``shared`` region, bodies the plugin placed there are read
+    from the mapping instead of the socket.
+    """
+    limits = {"max_frame_bytes": max_frame_bytes, "max_message_bytes": max_message_bytes}
+    options = {
+        "compression": compression,
+        "cbor": cbor,
+        "chunked": chunked,
+        **limits,
+        "stats": stats,
+    }
+    flags, payload = recv_frame(sock, **limits)
+    message = decode_envelope(flags, payload, **options)
+    if "shared_payload" in message:
+        if shared is None:
+            raise ProtocolError("Received a shared memory body without a negotiated region")
+        message = decode_shared_envelope(message, shared, **options)
+
+    payloads: list[bytes | bytearray] = []
+    for _ in range(attachment_count(message)):
+        flags, payload = recv_frame(sock, **limits)
+        if flags != FRAME_FLAG_BINARY:
+            raise ProtocolError("Expected a binary attachment frame")
+        payloads.append(payload)
+    if "attachments" in message:
+        message = bind_attachments(message, payloads, shared)
+    if shared is not None:
+        shared.release()
+    return message
@@ -8,8 +8,11 @@ import logging
 import os
 import socket
 import threading
+import time
 import uuid
+from collections import deque
 from collections.abc import AsyncIterator
+from concurrent.futures import Future
 from contextlib import asynccontextmanager
 from dataclasses import dataclass, field
 from typing import Any
@@ -19,11 +22,27 @@ from fastmcp.utilities.types import Image
 
 from . import __version__
 from .protocol import (
+    CAPABILITY_BINARY_ATTACHMENTS,
+    CAPABILITY_CANCEL,
+    CAPABILITY_CBOR,
+    CAPABILITY_CHUNKED_FRAMES,
+    CAPABILITY_HEARTBEAT,
+    CAPABILITY_SHARED_MEMORY,
+    CAPABILITY_TIMINGS,
+    COMPRESSION_ZLIB,
+    DEFAULT_COMPRESSION_THRESHOLD,
     DEFAULT_HOST,
     DEFAULT_PORT,
+    DEFAULT_SOCKET_BUFFER_BYTES,
     DEFAULT_TIMEOUT_SECONDS,
     MAX_FRAME_BYTES,
     PROTOCOL_VERSION,
+    CompressionStats,
+    ConnectionClosedError,
+    ProtocolError,
+    SharedRegion,
+    cbor_available,
+    clamp_frame_bytes,
     encode_message,
     is_loopback_host,
     recv_message,
@@ -45,34 +64,138 @@ class ParaViewCommandError(RuntimeError):
         self.traceback_text = traceback_text
 
 
+class _ResponseRouter:
+    """Matches responses read from one socket to the futures waiting on them."""
+
+    def __init__(self) -> None:
+        self._lock = threading.Lock()
+        self._pending: dict[str, Future[dict[str, Any]]] = {}
+        self.closed = False
+
+    def register(self, request_id: str) -> Future[dict[str, Any]]:
+        future: Future[dict[str, Any]] = Future()
+        with self._lock:
+            if self.closed:
+                raise ConnectionClosedError("ParaView bridge connection closed")
+            self._pending[request_id] = future
+        return future
+
+    def forget(self, request_id: str) -> None:
+        with self._lock:
+            self._pending.pop(request_id, None)
+
+    def resolve(self, response: dict[str, Any]) -> None:
+        request_id = response.get("request_id")
+        with self._lock:
+            future = self._pending.pop(request_id, None)
+        if future is None:
+            logger.warning("Dropping response for unknown request_id %r", request_id)
+            return
+        future.set_result(response)
+
+    def close(self, error: Exception) -> None:
+        with self._lock:
+            self.closed = True
+            orphaned = list(self._pending.values())
+            self._pending.clear()
+        for future in orphaned:
+            future.set_exception(error)
+
+
 @dataclass
 class ParaViewConnection:
-    """Persistent TCP client for the ParaView-side socket bridge."""
+    """Persistent TCP client for the ParaView-side socket bridge.
+
+    After the handshake a reader thread owns the receiving side of the socket,
+    so several commands can be in flight at once. Responses are matched to
+    their callers by ``request_id`` and may arrive in any order.
+    """
 
     host: str
     port: int
     auth_token: str = ""
     timeout_seconds: float = DEFAULT_TIMEOUT_SECONDS
     max_frame_bytes: int = MAX_FRAME_BYTES
+    # Unix domain socket the plugin listens on; when set, host and port are unused.
+    socket_path: str | None = None
+    # Ask a plugin on the same machine to hand large bodies over through a
+    # shared memory region instead of the socket.
+    shared_memory: bool = False
+    # Opt-in low-latency TCP profile: disables Nagle's algorithm, enables
+    # keep-alive and applies socket_buffer_bytes.
+    low_latency: bool = False
+    # SO_SNDBUF/SO_RCVBUF under the low-latency profile; 0 keeps the system's.
+    socket_buffer_bytes: int = DEFAULT_SOCKET_BUFFER_BYTES
+    # Token from the last 'hello'; presenting it again after a reconnect keeps
+    # the plugin-side namespace, history and snapshots.
+    resume_token: str | None = None
+    # Ask the plugin to report where each command's time went; results then
+    # carry a "timings" object.
+    timings: bool = False
     sock: socket.socket | None = field(default=None, init=False)
+    # Per-connection limit agreed in 'hello'; never above max_frame_bytes.
+    frame_limit: int = field(default=MAX_FRAME_BYTES, init=False)
+    capabilities: frozenset[str] = field(default=frozenset(), init=False)
+    compression_threshold: int | None = field(default=None, init=False)
+    compression_stats: CompressionStats = field(default_factory=CompressionStats, init=False)
+    shared_region: SharedRegion | None = field(default=None, init=False)
+    # Whether the last 'hello' carried on an earlier session.
+    resumed: bool = field(default=False, init=False)
     _lock: threading.Lock = field(default_factory=threading.Lock, init=False, repr=False)
+    _router: _ResponseRouter | None = field(default=None, init=False, repr=False)
+    # Heartbeat acks waiting for the socket's writer, with the socket they answer.
+    _acks: deque[tuple[socket.socket, bytes]] = field(
+        default_factory=deque, init=False, repr=False
+    )
+    # Last inspect_pipeline result and its version; the plugin answers
+    # not_modified instead of resending it while the pipeline is unchanged.
+    _pipeline_cache: tuple[str, dict[str, Any]] | None = field(
+        default=None, init=False, repr=False
+    )
+
+    def __post_init__(self) -> None:
+        # The plugin raises a smaller limit to its minimum, and replies may be
+        # that large, so the reader must accept the same bound hello offers.
+        self.max_frame_bytes = clamp_frame_bytes(self.max_frame_bytes)
 
     def connect(self) -> bool:
         """Connect and complete the authenticated handshake."""
         if self.sock is not None:
             return True
 
-        if not self.auth_token and not is_loopback_host(self.host):
+        if not self.socket_path and not self.auth_token and not is_loopback_host(self.host):
             raise RuntimeError(
                 "PARAVIEW_AUTH_TOKEN is required when connecting to a non-loopback host"
             )
 
         sock: socket.socket | None = None
         try:
-            sock = socket.create_connection((self.host, self.port), self.timeout_seconds)
+            if self.socket_path:
+                sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+                sock.settimeout(self.timeout_seconds)
+                sock.connect(self.socket_path)
+            else:
+                sock = self._open_tcp()
             sock.settimeout(self.timeout_seconds)
             self.sock = sock
             self._hello()
+            # Per-command deadlines are enforced on the futures instead; an idle
+            # connection must not time out the reader.
+            sock.settimeout(None)
+            self._router = _ResponseRouter()
+            threading.Thread(
+                target=self._read_responses,
+                args=(
+                    sock,
+                    self._router,
+                    self.compression_threshold is not None,
+                    CAPABILITY_CBOR in self.capabilities,
+                    CAPABILITY_CHUNKED_FRAMES in self.capabilities,
+                    self.shared_region,
+                ),
+                name="paraview-mcp-reader",
+                daemon=True,
+            ).start()
         except Exception:
             if sock is not None:
                 try:
@@ -82,55 +205,176 @@ class ParaViewConnection:
             self.sock = None
             raise
 
-        logger.info("Connected to ParaView bridge at %s:%s", self.host, self.port)
+        logger.info("Connected to ParaView bridge at %s", self.endpoint)
         return True
 
+    def _open_tcp(self) -> socket.socket:
+        """Connect to host:port, tuning each candidate socket before it connects."""
+        error: OSError = OSError(f"Could not resolve {self.host}")
+        for family, kind, proto, _, address in socket.getaddrinfo(
+            self.host, self.port, type=socket.SOCK_STREAM
+        ):
+            sock = socket.socket(family, kind, proto)
+            try:
+                sock.settimeout(self.timeout_seconds)
+                self._tune_socket(sock)
+                sock.connect(address)
+                return sock
+            except OSError as exc:
+                sock.close()
+                error = exc
+        raise error
+
+    def _tune_socket(self, sock: socket.socket) -> None:
+        """Apply the low-latency profile to a TCP socket that is not connected yet.
+
+        The receive buffer has to be set before connecting for the window scale
+        offered in the handshake to take it into account.
+        """
+        if not self.low_latency:
+            return
+        # Requests are small and each waits for its reply, which is the
+        # pattern where Nagle and delayed ACKs add a round trip of delay.
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_KEEPALIVE, 1)
+        if self.socket_buffer_bytes > 0:
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF, self.socket_buffer_bytes)
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, self.socket_buffer_bytes)
+
+    @property
+    def endpoint(self) -> str:
+        """Human-readable address of the bridge this connection targets."""
+        return self.socket_path or f"{self.host}:{self.port}"
+
     def disconnect(self) -> None:
         """Close the current socket."""
         if self.sock is None:
             return
 
+        sock = self.sock
         try:
-            self.sock.close()
+            # shutdown() wakes the reader thread blocked in recv(); close() alone may not.
+            sock.shutdown(socket.SHUT_RDWR)
+        except Exception:
+            pass
+        try:
+            sock.close()
         except Exception:
             pass
         finally:
             self.sock = None
+            self._router = None
+            if self.shared_region is not None:
+                self.shared_region.close()
+                self.shared_region = None
+            self.capabilities = frozenset()
+            self.compression_threshold = None
+            self.frame_limit = MAX_FRAME_BYTES
 
     def send_command(
         self, command_type: str, params: dict[str, Any] | None = None
     ) -> dict[str, Any]:
         """Send a command and return its result payload."""
-        with self._lock:
-            self._ensure_connected()
-            request_id = uuid.uuid4().hex
-            message = {
-                "request_id": request_id,
-                "type": command_type,
-                "params": params or {},
-            }
-            response = self._round_trip(message)
-            self._validate_response_id(response, request_id)
-            return self._unwrap_result(response)
+        started = time.perf_counter()
+        router, request_id, future = self._submit(command_type, params)
+        try:
+            response = future.result(timeout=self.timeout_seconds)
+        except TimeoutError:
+            router.forget(request_id)
+            self._cancel(router, request_id)
+            raise TimeoutError(
+                f"ParaView did not answer '{command_type}' within {self.timeout_seconds} seconds"
+            ) from None
+        result = self._unwrap_result(response)
+        timings = response.get("timings")
+        if isinstance(timings, dict):
+            # The plugin's phases plus the whole round trip as seen from here;
+            # what the plugin does not account for was spent on the wire.
+            round_trip_ms = round((time.perf_counter() - started) * 1000.0, 3)
+            result["timings"] = {**timings, "round_trip_ms": round_trip_ms}
+            logger.info("%s timings: %s", command_type, json.dumps(result["timings"]))
+        return result
+
+    def _cancel(self, router: _ResponseRouter, request_id: str) -> None:
+        """Ask the plugin to stop a request nobody waits for any more."""
+        if CAPABILITY_CANCEL not in self.capabilities or router.closed:
+            return
+        try:
+            # The acknowledgement resolves a future nobody waits on.
+            self._submit("cancel", {"request_id": request_id})
+        except (OSError, RuntimeError) as exc:
+            logger.warning("Could not cancel request %s: %s", request_id, exc)
 
     def ping(self) -> None:
         """Verify the bridge is still reachable."""
         self.send_command("ping")
 
+    def status(self) -> dict[str, Any]:
+        """Return the plugin's load as seen by this connection, even while Python runs."""
+        return self.send_command("status")
+
+    def inspect_pipeline(self) -> dict[str, Any]:
+        """Return the pipeline description, reusing the last one if it is unchanged."""
+        cached = self._pipeline_cache
+        params = {"if_version": cached[0]} if cached is not None else None
+        result = self.send_command("inspect_pipeline", params)
+        timings = result.pop("timings", None)
+        if cached is not None and result.get("not_modified"):
+            result = cached[1]
+        else:
+            version = result.get("version")
+            # Plugins that predate versioning send none; nothing to revalidate against.
+            self._pipeline_cache = (version, result) if isinstance(version, str) else None
+        return result if timings is None else {**result, "timings": timings}
+
+    def batch(
+        self, commands: list[dict[str, Any]], *, stop_on_error: bool = False
+    ) -> list[dict[str, Any]]:
+        """Run several commands in one round trip and return one entry per command.
+
+        Each command is ``{"type": ..., "params": {...}}``. Entries have the
+        command's ``type`` and ``status`` (``success``, ``error`` or
+        ``skipped``) plus its ``result`` or ``error``.
+        """
+        return self.batch_reply(commands, stop_on_error=stop_on_error)["results"]
+
+    def batch_reply(
+        self, commands: list[dict[str, Any]], *, stop_on_error: bool = False
+    ) -> dict[str, Any]:
+        """Like batch(), but return the whole reply: ``results`` and any ``timings``."""
+        result = self.send_command("batch", {"commands": commands, "stop_on_error": stop_on_error})
+        entries = result.get("results")
+        if not isinstance(entries, list):
+            raise RuntimeError("Bridge batch reply did not include a results list")
+        # Binary attachments arrive keyed as results.<index>.<key>.
+        for key in [key for key in result if key.startswith("results.")]:
+            _, index, name = key.split(".", 2)
+            entry = entries[int(index)]
+            if isinstance(entry.get("result"), dict):
+                entry["result"][name] = result.pop(key)
+        return result
+
     def _ensure_connected(self) -> None:
         if self.sock is None:
             self.connect()
 
     def _hello(self) -> None:
         request_id = uuid.uuid4().hex
-        response = self._round_trip(
-            {
-                "request_id": request_id,
-                "type": "hello",
-                "protocol_version": PROTOCOL_VERSION,
-                "auth_token": self.auth_token,
-            }
-        )
+        hello: dict[str, Any] = {
+            "request_id": request_id,
+            "type": "hello",
+            "protocol_version": PROTOCOL_VERSION,
+            "auth_token": self.auth_token,
+            "capabilities": self._requested_capabilities(),
+            "max_frame_bytes": self.max_frame_bytes,
+            "compression": {
+                "codecs": [COMPRESSION_ZLIB],
+                "threshold": DEFAULT_COMPRESSION_THRESHOLD,
+            },
+        }
+        if self.resume_token:
+            hello["resume_token"] = self.resume_token
+        response = self._round_trip(hello)
         self._validate_response_id(response, request_id)
         result = self._unwrap_result(response)
         protocol_version = result.get("protocol_version")
@@ -146,14 +390,172 @@ class ParaViewConnection:
             raise RuntimeError("Bridge handshake did not include a valid python_ready flag")
         if not python_ready:
             logger.warning("ParaView MCP plugin connected but embedded Python is not ready")
+        # Tokens are single use; plugins without resume support send none.
+        resume_token = result.get("resume_token")
+        self.resume_token = resume_token if isinstance(resume_token, str) and resume_token else None
+        self.resumed = result.get("resumed") is True
+        if self.resumed:
+            logger.info("Resumed the previous ParaView MCP session")
+        capabilities = result.get("capabilities")
+        if isinstance(capabilities, list):
+            self.capabilities = frozenset(item for item in capabilities if isinstance(item, str))
+        compression = result.get("compression")
+        if isinstance(compression, dict) and compression.get("codec") == COMPRESSION_ZLIB:
+            threshold = compression.get("threshold")
+            self.compression_threshold = (
+                threshold if isinstance(threshold, int) else DEFAULT_COMPRESSION_THRESHOLD
+            )
+        # Plugins that predate the negotiation keep the protocol default.
+        frame_limit = result.get("max_frame_bytes")
+        if not isinstance(frame_limit, int) or isinstance(frame_limit, bool):
+            frame_limit = MAX_FRAME_BYTES
+        self.frame_limit = min(frame_limit, self.max_frame_bytes)
+        shared = result.get("shared_memory")
+        if CAPABILITY_SHARED_MEMORY in self.capabilities and isinstance(shared, dict):
+            # From here on the plugin writes large bodies into the region rather
+            # than the socket, so a region that cannot be mapped fails the handshake.
+            try:
+                self.shared_region = SharedRegion(str(shared.get("path")), int(shared["size"]))
+            except (KeyError, TypeError, ValueError, OSError, ProtocolError) as exc:
+                raise RuntimeError(f"Could not map the bridge's shared memory: {exc}") from exc
+
+    def _requested_capabilities(self) -> list[str]:
+        capabilities = [
+            CAPABILITY_BINARY_ATTACHMENTS,
+            CAPABILITY_CHUNKED_FRAMES,
+            CAPABILITY_HEARTBEAT,
+        ]
+        if cbor_available():
+            capabilities.append(CAPABILITY_CBOR)
+        if self.shared_memory:
+            capabilities.append(CAPABILITY_SHARED_MEMORY)
+        if self.timings:
+            capabilities.append(CAPABILITY_TIMINGS)
+        return capabilities
+
+    def _submit(
+        self, command_type: str, params: dict[str, Any] | None
+    ) -> tuple[_ResponseRouter, str, Future[dict[str, Any]]]:
+        """Register a future for a new request and write the request to the socket."""
+        with self._lock:
+            if self._router is None or self._router.closed:
+                # The reader stopped (peer closed, protocol error): start over.
+                self.disconnect()
+            self._ensure_connected()
+            sock, router = self.sock, self._router
+            if sock is None or router is None:
+                raise RuntimeError("Socket is not connected")
+            request_id = uuid.uuid4().hex
+            future = router.register(request_id)
+            try:
+                sock.sendall(
+                    encode_message(
+                        {"request_id": request_id, "type": command_type, "params": params or {}},
+                        max_frame_bytes=self.frame_limit,
+                        cbor=CAPABILITY_CBOR in self.capabilities,
+                        compression_threshold=self.compression_threshold,
+                        stats=self.compression_stats,
+                    )
+                )
+            except Exception:
+                router.forget(request_id)
+                self.disconnect()
+                raise
+        self._flush_acks()
+        return router, request_id, future
+
+    def _read_responses(
+        self,
+        sock: socket.socket,
+        router: _ResponseRouter,
+        compression: bool,
+        cbor: bool,
+        chunked: bool,
+        shared: SharedRegion | None,
+    ) -> None:
+        """Dispatch responses to waiting futures until the socket fails or closes."""
+        error: Exception = ConnectionClosedError("ParaView bridge connection closed")
+        try:
+            while True:
+                response = recv_message(
+                    sock,
+                    max_frame_bytes=self.frame_limit,
+                    compression=compression,
+                    cbor=cbor,
+                    chunked=chunked,
+                    stats=self.compression_stats,
+                    shared=shared,
+                )
+                if response.get("type") == "heartbeat":
+                    self._answer_heartbeat(sock, response, cbor)
+                    continue
+                if not response.get("request_id"):
+                    # Connection-level errors (e.g. PROTOCOL_ERROR) carry no
+                    # request_id and precede the bridge closing the socket;
+                    # every caller still waiting should see them.
+                    self._unwrap_result(response)
+                router.resolve(response)
+        except Exception as exc:
+            error = exc
+        finally:
+            router.close(error)
+
+    def _answer_heartbeat(self, sock: socket.socket, heartbeat: dict[str, Any], cbor: bool) -> None:
+        """Echo a plugin heartbeat so it can time the round trip."""
+        ack = encode_message(
+            {"type": "heartbeat_ack", "heartbeat_id": heartbeat.get("heartbeat_id")},
+            max_frame_bytes=self.frame_limit,
+            cbor=cbor,
+            compression_threshold=self.compression_threshold,
+            stats=self.compression_stats,
+        )
+        self._acks.append((sock, ack))
+        self._flush_acks()
+
+    def _flush_acks(self) -> None:
+        """Send queued heartbeat acks if no command is being written.
+
+        A command being written holds the lock, and that write may itself be
+        waiting for the reader thread to drain replies, so the reader never
+        blocks on it. Whoever holds the lock calls this again after releasing
+        it, which sends anything queued in the meantime.
+        """
+        while self._acks:
+            if not self._lock.acquire(blocking=False):
+                return
+            try:
+                while self._acks:
+                    sock, ack = self._acks.popleft()
+                    if self.sock is sock:
+                        sock.sendall(ack)
+            except OSError:
+                # The reader sees the broken socket on its next receive.
+                return
+            finally:
+                self._lock.release()
 
     def _round_trip(self, message: dict[str, Any]) -> dict[str, Any]:
         if self.sock is None:
             raise RuntimeError("Socket is not connected")
 
+        cbor = CAPABILITY_CBOR in self.capabilities
         try:
-            self.sock.sendall(encode_message(message, max_frame_bytes=self.max_frame_bytes))
-            return recv_message(self.sock, max_frame_bytes=self.max_frame_bytes)
+            self.sock.sendall(
+                encode_message(
+                    message,
+                    max_frame_bytes=self.max_frame_bytes,
+                    cbor=cbor,
+                    compression_threshold=self.compression_threshold,
+                    stats=self.compression_stats,
+                )
+            )
+            return recv_message(
+                self.sock,
+                max_frame_bytes=self.max_frame_bytes,
+                compression=self.compression_threshold is not None,
+                cbor=cbor,
+                stats=self.compression_stats,
+            )
         except Exception:
             self.disconnect()
             raise
@@ -200,6 +602,7 @@ def get_paraview_connection() -> ParaViewConnection:
     """Return a validated singleton connection."""
     global _connection
 
+    resume_token = None
     if _connection is not None:
         try:
             _connection.ping()
@@ -207,19 +610,40 @@ def get_paraview_connection() -> ParaViewConnection:
         except Exception as exc:
             logger.warning("Dropping stale ParaView connection: %s", exc)
             _connection.disconnect()
+            resume_token = _connection.resume_token
             _connection = None
 
     host = os.getenv("PARAVIEW_HOST", DEFAULT_HOST)
     port = int(os.getenv("PARAVIEW_PORT", str(DEFAULT_PORT)))
     auth_token = os.getenv("PARAVIEW_AUTH_TOKEN", "")
+    max_frame_bytes = int(os.getenv("PARAVIEW_MAX_FRAME_BYTES", str(MAX_FRAME_BYTES)))
+    socket_path = os.getenv("PARAVIEW_SOCKET") or None
+    shared_memory = os.getenv("PARAVIEW_SHARED_MEMORY", "") not in ("", "0")
+    timings = os.getenv("PARAVIEW_TIMINGS", "") not in ("", "0")
+    low_latency = os.getenv("PARAVIEW_LOW_LATENCY", "") not in ("", "0")
+    socket_buffer_bytes = int(
+        os.getenv("PARAVIEW_SOCKET_BUFFER_BYTES", str(DEFAULT_SOCKET_BUFFER_BYTES))
+    )
 
-    _connection = ParaViewConnection(host=host, port=port, auth_token=auth_token)
+    _connection = ParaViewConnection(
+        host=host,
+        port=port,
+        auth_token=auth_token,
+        max_frame_bytes=max_frame_bytes,
+        socket_path=socket_path,
+        shared_memory=shared_memory,
+        timings=timings,
+        low_latency=low_latency,
+        socket_buffer_bytes=socket_buffer_bytes,
+        resume_token=resume_token,
+    )
+    endpoint = _connection.endpoint
     try:
         _connection.connect()
     except OSError as exc:
         _connection = None
         raise ConnectionError(
-            f"Could not connect to the ParaView MCP bridge at {host}:{port}: {exc}\n\n{_SETUP_HINT}"
+            f"Could not connect to the ParaView MCP bridge at {endpoint}: {exc}\n\n{_SETUP_HINT}"
         ) from exc
     return _connection
 
@@ -230,7 +654,7 @@ async def server_lifespan(server: FastMCP) -> AsyncIterator[dict[str, Any]]:
     logger.info("ParaView MCP server starting")
     host = os.getenv("PARAVIEW_HOST", DEFAULT_HOST)
     auth_token = os.getenv("PARAVIEW_AUTH_TOKEN", "")
-    if not auth_token and not is_loopback_host(host):
+    if not os.getenv("PARAVIEW_SOCKET") and not auth_token and not is_loopback_host(host):
         raise RuntimeError("PARAVIEW_AUTH_TOKEN is required when connecting to a non-loopback host")
 
     try:
@@ -256,6 +680,13 @@ def _to_pretty_json(payload: dict[str, Any]) -> str:
     return json.dumps(payload, indent=2, sort_keys=True)
 
 
+def _with_timings(payload: dict[str, object], result: dict[str, Any]) -> dict[str, object]:
+    """Pass the plugin's timing breakdown, if it sent one, on to the tool result."""
+    if "timings" in result:
+        payload["timings"] = result["timings"]
+    return payload
+
+
 @mcp.tool()
 def execute_paraview_code(ctx: Context, code: str) -> dict[str, object]:
     """Execute Python code in ParaView. Break complex tasks into small steps.
@@ -275,21 +706,23 @@ def execute_paraview_code(ctx: Context, code: str) -> dict[str, object]:
     if error:
         tb = result.get("traceback")
         msg = f"{error}\n{tb}" if tb else error
-        return {"success": False, "message": msg}
+        return _with_timings({"success": False, "message": msg}, result)
 
     stdout = (result.get("stdout") or "").rstrip()
-    return {"success": True, "message": stdout}
+    return _with_timings({"success": True, "message": stdout}, result)
 
 
 @mcp.tool()
 def get_pipeline_info(ctx: Context) -> str:
     """Return a JSON snapshot of the current ParaView pipeline."""
-    result = get_paraview_connection().send_command("inspect_pipeline")
+    result = get_paraview_connection().inspect_pipeline()
     return _to_pretty_json(result)
 
 
 @mcp.tool()
-def get_screenshot(ctx: Context, width: int = 1600, height: int = 900) -> Image:
+def get_screenshot(
+    ctx: Context, width: int = 1600, height: int = 900
+) -> Image | list[str | Image]:
     """Capture the active render view as a PNG image."""
     result = get_paraview_connection().send_command(
         "capture_screenshot",
@@ -297,9 +730,45 @@ def get_screenshot(ctx: Context, width: int = 1600, height: int = 900) -> Image:
     )
     image_data = result.get("image_data")
     image_format = result.get("format", "png")
-    if not isinstance(image_data, str) or not image_data:
+    if isinstance(image_data, (bytes, bytearray)) and image_data:
+        image = Image(data=bytes(image_data), format=image_format)
+    elif isinstance(image_data, str) and image_data:
+        image = Image(data=base64.b64decode(image_data), format=image_format)
+    else:
         raise RuntimeError("Bridge did not return screenshot bytes")
-    return Image(data=base64.b64decode(image_data), format=image_format)
+    # The timings follow the image as text, where render_ms is the one to watch.
+    if "timings" in result:
+        return [image, _to_pretty_json({"timings": result["timings"]})]
+    return image
+
+
+@mcp.tool()
+def run_batch(
+    ctx: Context, commands: list[dict[str, Any]], stop_on_error: bool = False
+) -> list[str | Image]:
+    """Run several ParaView commands in order in a single round trip.
+
+    Each command is ``{"type": ..., "params": {...}}`` where ``type`` is
+    ``execute_python`` (params ``code``), ``inspect_pipeline`` or
+    ``capture_screenshot`` (params ``width``, ``height``). Prefer this over
+    separate calls for execute, inspect and screenshot sequences. With
+    ``stop_on_error`` the commands after a failure are skipped. Returns a JSON
+    summary followed by any screenshots, in order.
+    """
+    reply = get_paraview_connection().batch_reply(commands, stop_on_error=stop_on_error)
+    entries = reply["results"]
+    images: list[Image] = []
+    for entry in entries:
+        result = entry.get("result")
+        if not isinstance(result, dict) or "image_data" not in result:
+            continue
+        image_data = result.pop("image_data")
+        if isinstance(image_data, str):
+            image_data = base64.b64decode(image_data)
+        result["image"] = len(images)
+        images.append(Image(data=bytes(image_data), format=result.get("format", "png")))
+    summary = {key: value for key, value in reply.items() if key in ("results", "timings")}
+    return [_to_pretty_json(summary), *images]
 
 
 def main() -> None:
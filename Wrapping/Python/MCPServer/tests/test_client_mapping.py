@@ -16,9 +16,11 @@ from support import install_fastmcp_stub
 install_fastmcp_stub()
 
 from paraview_mcp.server import (  # noqa: E402
+    ParaViewConnection,
     execute_paraview_code,
     get_pipeline_info,
     get_screenshot,
+    run_batch,
 )
 
 
@@ -37,6 +39,9 @@ class RecordingConnection:
             return {"count": 1, "sources": [{"name": "Wavelet"}]}
         return {"ok": True, "stdout": "42\n"}
 
+    def inspect_pipeline(self):
+        return self.send_command("inspect_pipeline")
+
 
 class ClientMappingTests(unittest.TestCase):
     def test_execute_paraview_code_maps_to_execute_python(self) -> None:
@@ -55,6 +60,18 @@ class ClientMappingTests(unittest.TestCase):
         self.assertEqual(connection.calls, [("inspect_pipeline", None)])
         self.assertEqual(json.loads(payload)["count"], 1)
 
+    def test_execute_paraview_code_passes_timings_on(self) -> None:
+        connection = RecordingConnection()
+        timings = {"exec_ms": 2.5, "round_trip_ms": 4.0}
+        reply = {"stdout": "", "timings": timings}
+        with (
+            patch.object(connection, "send_command", return_value=reply),
+            patch("paraview_mcp.server.get_paraview_connection", return_value=connection),
+        ):
+            payload = execute_paraview_code(None, "x = 1")
+
+        self.assertEqual(payload, {"success": True, "message": "", "timings": timings})
+
     def test_get_screenshot_maps_to_capture_screenshot(self) -> None:
         connection = RecordingConnection()
         with patch("paraview_mcp.server.get_paraview_connection", return_value=connection):
@@ -80,6 +97,75 @@ class ClientMappingTests(unittest.TestCase):
             with self.assertRaisesRegex(RuntimeError, "did not return screenshot bytes"):
                 get_screenshot(None)
 
+    def test_get_screenshot_accepts_binary_attachment(self) -> None:
+        class BinaryConnection(RecordingConnection):
+            def send_command(self, command_type: str, params: dict[str, object] | None = None):
+                self.calls.append((command_type, params))
+                return {"format": "png", "image_data": b"raw-image"}
+
+        connection = BinaryConnection()
+        with patch("paraview_mcp.server.get_paraview_connection", return_value=connection):
+            image = get_screenshot(None)
+
+        self.assertEqual(image.data, b"raw-image")
+
+    def test_get_screenshot_passes_timings_on(self) -> None:
+        connection = RecordingConnection()
+        timings = {"render_ms": 12.5, "round_trip_ms": 20.0}
+        reply = {"format": "png", "image_data": b"raw-image", "timings": timings}
+        with (
+            patch.object(connection, "send_command", return_value=reply),
+            patch("paraview_mcp.server.get_paraview_connection", return_value=connection),
+        ):
+            image, text = get_screenshot(None)
+
+        self.assertEqual(image.data, b"raw-image")
+        self.assertEqual(json.loads(text), {"timings": timings})
+
+    def test_run_batch_sends_one_batch_command(self) -> None:
+        connection = ParaViewConnection(host="127.0.0.1", port=0)
+        reply = {
+            "results": [
+                {"type": "execute_python", "status": "success", "result": {"ok": True}},
+                {"type": "capture_screenshot", "status": "success", "result": {"format": "png"}},
+            ],
+            "results.1.image_data": b"raw-image",
+        }
+        commands = [
+            {"type": "execute_python", "params": {"code": "x = 1"}},
+            {"type": "capture_screenshot"},
+        ]
+        with (
+            patch.object(connection, "send_command", return_value=reply) as send_command,
+            patch("paraview_mcp.server.get_paraview_connection", return_value=connection),
+        ):
+            summary, image = run_batch(None, commands, stop_on_error=True)
+
+        send_command.assert_called_once_with("batch", {"commands": commands, "stop_on_error": True})
+        self.assertEqual(image.data, b"raw-image")
+        results = json.loads(summary)["results"]
+        self.assertEqual(results[1]["result"], {"format": "png", "image": 0})
+
+    def test_get_pipeline_info_reuses_an_unchanged_pipeline(self) -> None:
+        connection = ParaViewConnection(host="127.0.0.1", port=0)
+        replies = [
+            {"count": 1, "sources": [{"name": "Wavelet"}], "version": "e-1"},
+            {"not_modified": True, "version": "e-1"},
+        ]
+        with (
+            patch.object(connection, "send_command", side_effect=replies) as send_command,
+            patch("paraview_mcp.server.get_paraview_connection", return_value=connection),
+        ):
+            first = get_pipeline_info(None)
+            second = get_pipeline_info(None)
+
+        self.assertEqual(send_command.call_args_list[0].args, ("inspect_pipeline", None))
+        self.assertEqual(
+            send_command.call_args_list[1].args, ("inspect_pipeline", {"if_version": "e-1"})
+        )
+        self.assertEqual(second, first)
+        self.assertEqual(json.loads(second)["sources"], [{"name": "Wavelet"}])
+
 
 if __name__ == "__main__":
     unittest.main()
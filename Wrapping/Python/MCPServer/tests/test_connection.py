@@ -2,10 +2,14 @@
 
 from __future__ import annotations
 
+import json
 import os
 import socket
+import struct
 import sys
+import tempfile
 import threading
+import time
 import unittest
 from collections.abc import Callable
 from pathlib import Path
@@ -18,23 +22,42 @@ from support import install_fastmcp_stub
 install_fastmcp_stub()
 
 import paraview_mcp.server as server_module  # noqa: E402
-from paraview_mcp.protocol import encode_message, recv_message  # noqa: E402
+from paraview_mcp.protocol import (  # noqa: E402
+    MAX_FRAME_BYTES,
+    MIN_FRAME_BYTES,
+    SHARED_HEADER_BYTES,
+    FrameTooLargeError,
+    encode_message,
+    recv_message,
+)
 from paraview_mcp.server import ParaViewCommandError, ParaViewConnection  # noqa: E402
 
 
 class BridgeStubServer:
-    def __init__(self, handler: Callable[[dict[str, Any]], dict[str, Any] | None]) -> None:
+    def __init__(
+        self,
+        handler: Callable[[dict[str, Any]], dict[str, Any] | None],
+        *,
+        compression_threshold: int | None = None,
+        socket_path: str | None = None,
+    ) -> None:
         self._handler = handler
+        self._compression_threshold = compression_threshold
+        self.socket_path = socket_path
         self.requests: list[dict[str, Any]] = []
-        self._listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        family = socket.AF_UNIX if socket_path else socket.AF_INET
+        self._listener = socket.socket(family, socket.SOCK_STREAM)
         try:
-            self._listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
-            self._listener.bind(("127.0.0.1", 0))
+            if socket_path:
+                self._listener.bind(socket_path)
+            else:
+                self._listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+                self._listener.bind(("127.0.0.1", 0))
             self._listener.listen()
         except Exception:
             self._listener.close()
             raise
-        self.port = self._listener.getsockname()[1]
+        self.port = 0 if socket_path else self._listener.getsockname()[1]
         self._stop_event = threading.Event()
         self._thread = threading.Thread(target=self._serve, daemon=True)
 
@@ -44,8 +67,13 @@ class BridgeStubServer:
     def close(self) -> None:
         self._stop_event.set()
         try:
-            with socket.create_connection(("127.0.0.1", self.port), timeout=0.2):
-                pass
+            if self.socket_path:
+                with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as wake:
+                    wake.settimeout(0.2)
+                    wake.connect(self.socket_path)
+            else:
+                with socket.create_connection(("127.0.0.1", self.port), timeout=0.2):
+                    pass
         except OSError:
             pass
         self._thread.join(timeout=2)
@@ -59,21 +87,86 @@ class BridgeStubServer:
                 return
             with conn:
                 conn.settimeout(1.0)
+                negotiated = False
                 while not self._stop_event.is_set():
                     try:
-                        request = recv_message(conn)
+                        request = recv_message(conn, compression=negotiated)
                     except Exception:
                         break
                     self.requests.append(request)
                     response = self._handler(request)
                     if response is None:
                         break
-                    conn.sendall(encode_message(response))
+                    # Like the plugin, only compress frames sent after the hello reply.
+                    threshold = self._compression_threshold if negotiated else None
+                    conn.sendall(encode_message(response, compression_threshold=threshold))
+                    negotiated = self._compression_threshold is not None
+
+
+class ConcurrentBridgeStub:
+    """Answers each request from its own timer so replies complete out of order."""
+
+    def __init__(self, delay_for: Callable[[dict[str, Any]], float]) -> None:
+        self._delay_for = delay_for
+        self._send_lock = threading.Lock()
+        self._listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        try:
+            self._listener.bind(("127.0.0.1", 0))
+            self._listener.listen()
+        except Exception:
+            self._listener.close()
+            raise
+        self.port = self._listener.getsockname()[1]
+        self._thread = threading.Thread(target=self._serve, daemon=True)
+
+    def start(self) -> None:
+        self._thread.start()
+
+    def close(self) -> None:
+        self._listener.close()
+        self._thread.join(timeout=2)
+
+    def _serve(self) -> None:
+        try:
+            conn, _ = self._listener.accept()
+        except OSError:
+            return
+        with conn:
+            while True:
+                try:
+                    request = recv_message(conn)
+                except Exception:
+                    return
+                if request["type"] == "hello":
+                    result: dict[str, Any] = {
+                        "protocol_version": 2,
+                        "plugin_version": "0.1.0",
+                        "python_ready": True,
+                    }
+                else:
+                    result = {"echo": request["params"]}
+                response = {
+                    "request_id": request["request_id"],
+                    "status": "success",
+                    "result": result,
+                }
+                timer = threading.Timer(self._delay_for(request), self._reply, (conn, response))
+                timer.start()
+                if request["type"] == "hello":
+                    timer.join()
+
+    def _reply(self, conn: socket.socket, response: dict[str, Any]) -> None:
+        with self._send_lock:
+            try:
+                conn.sendall(encode_message(response))
+            except OSError:
+                pass
 
 
 class StaleConnection:
     def __init__(self) -> None:
         self.disconnected = False
+        self.resume_token = "stale-token"
 
     def ping(self) -> None:
         raise RuntimeError("stale")
@@ -93,6 +186,7 @@ class ConnectionTests(unittest.TestCase):
         os.environ.pop("PARAVIEW_HOST", None)
         os.environ.pop("PARAVIEW_PORT", None)
         os.environ.pop("PARAVIEW_AUTH_TOKEN", None)
+        os.environ.pop("PARAVIEW_SOCKET", None)
 
     def test_connects_and_round_trips_commands(self) -> None:
         def handler(request: dict[str, Any]) -> dict[str, Any]:
@@ -127,6 +221,202 @@ class ConnectionTests(unittest.TestCase):
 
         self.assertEqual([request["type"] for request in bridge.requests], ["hello", "ping"])
 
+    def test_tcp_sockets_use_the_low_latency_profile(self) -> None:
+        def handler(request: dict[str, Any]) -> dict[str, Any]:
+            result = {"protocol_version": 2, "plugin_version": "0.1.0", "python_ready": True}
+            return {"request_id": request["request_id"], "status": "success", "result": result}
+
+        try:
+            bridge = BridgeStubServer(handler)
+        except PermissionError as exc:
+            self.skipTest(str(exc))
+        bridge.start()
+        self.addCleanup(bridge.close)
+
+        default = ParaViewConnection(host="127.0.0.1", port=bridge.port)
+        self.assertFalse(default.low_latency)
+        for low_latency in (True, False):
+            connection = ParaViewConnection(
+                host="127.0.0.1", port=bridge.port, low_latency=low_latency
+            )
+            connection.connect()
+            sock = connection.sock
+            assert sock is not None
+            nodelay = sock.getsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY)
+            keepalive = sock.getsockopt(socket.SOL_SOCKET, socket.SO_KEEPALIVE)
+            self.assertEqual(bool(nodelay), low_latency)
+            self.assertEqual(bool(keepalive), low_latency)
+            connection.disconnect()
+
+    def test_status_reports_the_plugin_load(self) -> None:
+        status = {"busy": True, "busy_ms": 1200, "running_request_id": "abc", "pending": 2}
+
+        def handler(request: dict[str, Any]) -> dict[str, Any]:
+            if request["type"] == "hello":
+                result = {"protocol_version": 2, "plugin_version": "0.1.0", "python_ready": True}
+                return {"request_id": request["request_id"], "status": "success", "result": result}
+            return {"request_id": request["request_id"], "status": "success", "result": status}
+
+        try:
+            bridge = BridgeStubServer(handler)
+        except PermissionError as exc:
+            self.skipTest(str(exc))
+        bridge.start()
+        self.addCleanup(bridge.close)
+
+        connection = ParaViewConnection(host="127.0.0.1", port=bridge.port)
+        self.addCleanup(connection.disconnect)
+        self.assertEqual(connection.status(), status)
+        self.assertEqual(bridge.requests[-1]["type"], "status")
+
+    def test_timings_are_requested_and_passed_on(self) -> None:
+        def handler(request: dict[str, Any]) -> dict[str, Any]:
+            if request["type"] == "hello":
+                result = {"protocol_version": 2, "plugin_version": "0.1.0", "python_ready": True}
+                return {"request_id": request["request_id"], "status": "success", "result": result}
+            return {
+                "request_id": request["request_id"],
+                "status": "success",
+                "result": {"ok": True},
+                "timings": {"exec_ms": 2.5, "queue_ms": 0.1},
+            }
+
+        try:
+            bridge = BridgeStubServer(handler)
+        except PermissionError as exc:
+            self.skipTest(str(exc))
+        bridge.start()
+        self.addCleanup(bridge.close)
+
+        connection = ParaViewConnection(host="127.0.0.1", port=bridge.port, timings=True)
+        self.addCleanup(connection.disconnect)
+        result = connection.send_command("execute_python", {"code": "x = 1"})
+
+        self.assertIn("timings", bridge.requests[0]["capabilities"])
+        self.assertTrue(result["ok"])
+        self.assertEqual(result["timings"]["exec_ms"], 2.5)
+        self.assertGreaterEqual(result["timings"]["round_trip_ms"], 0)
+
+    def test_negotiates_compression_and_counts_savings(self) -> None:
+        def handler(request: dict[str, Any]) -> dict[str, Any]:
+            if request["type"] == "hello":
+                self.assertEqual(request["compression"]["codecs"], ["zlib"])
+                return {
+                    "request_id": request["request_id"],
+                    "status": "success",
+                    "result": {
+                        "protocol_version": 2,
+                        "plugin_version": "0.1.0",
+                        "python_ready": True,
+                        "compression": {"codec": "zlib", "threshold": 64},
+                    },
+                }
+            return {
+                "request_id": request["request_id"],
+                "status": "success",
+                "result": {"stdout": "x" * 4096, "code": request["params"]["code"]},
+            }
+
+        try:
+            bridge = BridgeStubServer(handler, compression_threshold=64)
+        except PermissionError as exc:
+            self.skipTest(str(exc))
+        bridge.start()
+        self.addCleanup(bridge.close)
+
+        connection = ParaViewConnection(host="127.0.0.1", port=bridge.port)
+        connection.connect()
+        self.assertEqual(connection.compression_threshold, 64)
+        code = "print('y')\n" * 200
+        result = connection.send_command("execute_python", {"code": code})
+        connection.disconnect()
+
+        self.assertEqual(result, {"stdout": "x" * 4096, "code": code})
+        self.assertEqual(connection.compression_stats.frames, 2)
+        self.assertGreater(connection.compression_stats.bytes_saved, 4096)
+
+    def test_negotiates_frame_limit(self) -> None:
+        hello_limits: list[Any] = []
+
+        def handler(request: dict[str, Any]) -> dict[str, Any]:
+            if request["type"] == "hello":
+                hello_limits.append(request.get("max_frame_bytes"))
+                return {
+                    "request_id": request["request_id"],
+                    "status": "success",
+                    "result": {
+                        "protocol_version": 2,
+                        "plugin_version": "0.1.0",
+                        "python_ready": True,
+                        "max_frame_bytes": 128 * 1024,
+                    },
+                }
+            return {
+                "request_id": request["request_id"],
+                "status": "success",
+                "result": {"stdout": "x" * request["params"]["size"]},
+            }
+
+        try:
+            bridge = BridgeStubServer(handler)
+        except PermissionError as exc:
+            self.skipTest(str(exc))
+        bridge.start()
+        self.addCleanup(bridge.close)
+
+        connection = ParaViewConnection(
+            host="127.0.0.1", port=bridge.port, max_frame_bytes=64 * 1024 * 1024
+        )
+        connection.connect()
+        self.addCleanup(connection.disconnect)
+        self.assertEqual(hello_limits, [64 * 1024 * 1024])
+        self.assertEqual(connection.frame_limit, 128 * 1024)
+
+        self.assertEqual(connection.send_command("ping", {"size": 1024}), {"stdout": "x" * 1024})
+        with self.assertRaises(FrameTooLargeError):
+            connection.send_command("ping", {"size": 256 * 1024})
+
+        connection.disconnect()
+        self.assertEqual(connection.frame_limit, MAX_FRAME_BYTES)
+
+    def test_frame_limit_below_the_minimum_is_raised_to_it(self) -> None:
+        hello_limits: list[Any] = []
+
+        def handler(request: dict[str, Any]) -> dict[str, Any]:
+            if request["type"] == "hello":
+                hello_limits.append(request.get("max_frame_bytes"))
+                return {
+                    "request_id": request["request_id"],
+                    "status": "success",
+                    "result": {
+                        "protocol_version": 2,
+                        "plugin_version": "0.1.0",
+                        "python_ready": True,
+                        "max_frame_bytes": MIN_FRAME_BYTES,
+                    },
+                }
+            return {
+                "request_id": request["request_id"],
+                "status": "success",
+                "result": {"stdout": "x" * 32 * 1024},
+            }
+
+        try:
+            bridge = BridgeStubServer(handler)
+        except PermissionError as exc:
+            self.skipTest(str(exc))
+        bridge.start()
+        self.addCleanup(bridge.close)
+
+        connection = ParaViewConnection(host="127.0.0.1", port=bridge.port, max_frame_bytes=1024)
+        self.assertEqual(connection.max_frame_bytes, MIN_FRAME_BYTES)
+        connection.connect()
+        self.addCleanup(connection.disconnect)
+        self.assertEqual(hello_limits, [MIN_FRAME_BYTES])
+        self.assertEqual(connection.frame_limit, MIN_FRAME_BYTES)
+        # A reply above the configured 1 KiB but within the agreed limit.
+        self.assertEqual(connection.send_command("ping", {})["stdout"], "x" * 32 * 1024)
+
     def test_handshake_requires_plugin_metadata(self) -> None:
         def handler(request: dict[str, Any]) -> dict[str, Any]:
             return {
@@ -225,6 +515,363 @@ class ConnectionTests(unittest.TestCase):
         fresh.ping()
 
         self.assertEqual([request["type"] for request in bridge.requests], ["hello", "ping"])
+        self.assertEqual(bridge.requests[0]["resume_token"], "stale-token")
+
+    def test_reconnects_resume_the_session(self) -> None:
+        tokens = iter(["token-1", "token-2"])
+
+        def handler(request: dict[str, Any]) -> dict[str, Any]:
+            if request["type"] == "hello":
+                result = {
+                    "protocol_version": 2,
+                    "plugin_version": "0.1.0",
+                    "python_ready": True,
+                    "resume_token": next(tokens),
+                    "resumed": "resume_token" in request,
+                }
+                return {"request_id": request["request_id"], "status": "success", "result": result}
+            return {"request_id": request["request_id"], "status": "success", "result": {}}
+
+        try:
+            bridge = BridgeStubServer(handler)
+        except PermissionError as exc:
+            self.skipTest(str(exc))
+        bridge.start()
+        self.addCleanup(bridge.close)
+
+        connection = ParaViewConnection(host="127.0.0.1", port=bridge.port)
+        self.addCleanup(connection.disconnect)
+        connection.connect()
+        self.assertNotIn("resume_token", bridge.requests[0])
+        self.assertFalse(connection.resumed)
+
+        connection.disconnect()
+        connection.connect()
+        self.assertEqual(bridge.requests[-1]["resume_token"], "token-1")
+        self.assertTrue(connection.resumed)
+        self.assertEqual(connection.resume_token, "token-2")
+
+    @unittest.skipUnless(hasattr(socket, "AF_UNIX"), "AF_UNIX sockets are not available")
+    def test_connects_over_unix_socket(self) -> None:
+        def handler(request: dict[str, Any]) -> dict[str, Any]:
+            if request["type"] == "hello":
+                return {
+                    "request_id": request["request_id"],
+                    "status": "success",
+                    "result": {
+                        "protocol_version": 2,
+                        "plugin_version": "0.1.0",
+                        "python_ready": True,
+                    },
+                }
+            return {"request_id": request["request_id"], "status": "success", "result": {}}
+
+        directory = tempfile.TemporaryDirectory()
+        self.addCleanup(directory.cleanup)
+        path = os.path.join(directory.name, "bridge.sock")
+        try:
+            bridge = BridgeStubServer(handler, socket_path=path)
+        except PermissionError as exc:
+            self.skipTest(str(exc))
+        bridge.start()
+        self.addCleanup(bridge.close)
+
+        # Host-side token checks do not apply to a socket that never leaves the machine.
+        os.environ["PARAVIEW_HOST"] = "203.0.113.10"
+        os.environ["PARAVIEW_SOCKET"] = path
+        os.environ.pop("PARAVIEW_AUTH_TOKEN", None)
+        connection = server_module.get_paraview_connection()
+        self.assertEqual(connection.endpoint, path)
+        self.assertEqual(connection.sock.family, socket.AF_UNIX)
+        connection.ping()
+
+        self.assertEqual([request["type"] for request in bridge.requests], ["hello", "ping"])
+
+    def test_reads_large_bodies_from_shared_memory(self) -> None:
+        backing = tempfile.NamedTemporaryFile()
+        self.addCleanup(backing.close)
+        capacity = 4096
+        backing.truncate(SHARED_HEADER_BYTES + capacity)
+        image = b"\x89PNG" * 256
+        hello_capabilities: list[Any] = []
+
+        def place(position: int, body: bytes) -> None:
+            backing.seek(SHARED_HEADER_BYTES + position % capacity)
+            backing.write(body)
+            backing.flush()
+
+        def handler(request: dict[str, Any]) -> dict[str, Any]:
+            request_id = request["request_id"]
+            if request["type"] == "hello":
+                hello_capabilities.append(request["capabilities"])
+                return {
+                    "request_id": request_id,
+                    "status": "success",
+                    "result": {
+                        "protocol_version": 2,
+                        "plugin_version": "0.1.0",
+                        "python_ready": True,
+                        "capabilities": ["shared_memory"],
+                        "shared_memory": {
+                            "path": backing.name,
+                            "size": SHARED_HEADER_BYTES + capacity,
+                        },
+                    },
+                }
+            if request["type"] == "capture_screenshot":
+                place(0, image)
+                return {
+                    "request_id": request_id,
+                    "status": "success",
+                    "result": {"format": "png"},
+                    "attachments": [{"key": "image_data", "size": len(image), "position": 0}],
+                }
+            envelope = json.dumps(
+                {"request_id": request_id, "status": "success", "result": {"stdout": "x" * 2000}}
+            ).encode("utf-8")
+            place(len(image), envelope)
+            return {
+                "request_id": request_id,
+                "shared_payload": {"position": len(image), "length": len(envelope), "flags": 0},
+            }
+
+        try:
+            bridge = BridgeStubServer(handler)
+        except PermissionError as exc:
+            self.skipTest(str(exc))
+        bridge.start()
+        self.addCleanup(bridge.close)
+
+        connection = ParaViewConnection(host="127.0.0.1", port=bridge.port, shared_memory=True)
+        connection.connect()
+        self.addCleanup(connection.disconnect)
+        self.assertIn("shared_memory", hello_capabilities[0])
+        self.assertIsNotNone(connection.shared_region)
+
+        def released() -> int:
+            backing.seek(0)
+            return struct.unpack("<Q", backing.read(8))[0]
+
+        result = connection.send_command("capture_screenshot", {})
+        self.assertEqual(result, {"format": "png", "image_data": image})
+        self.assertEqual(released(), len(image))
+
+        result = connection.send_command("execute_python", {"code": "print()"})
+        self.assertEqual(result, {"stdout": "x" * 2000})
+        self.assertGreater(released(), len(image) + 2000)
+
+        connection.disconnect()
+        self.assertIsNone(connection.shared_region)
+
+    def test_connection_level_errors_fail_waiting_commands(self) -> None:
+        def handler(request: dict[str, Any]) -> dict[str, Any]:
+            if request["type"] == "hello":
+                return {
+                    "request_id": request["request_id"],
+                    "status": "success",
+                    "result": {
+                        "protocol_version": 2,
+                        "plugin_version": "0.1.0",
+                        "python_ready": True,
+                    },
+                }
+            return {
+                "request_id": "",
+                "status": "error",
+                "error": {"code": "PROTOCOL_ERROR", "message": "Received malformed JSON payload"},
+            }
+
+        try:
+            bridge = BridgeStubServer(handler)
+        except PermissionError as exc:
+            self.skipTest(str(exc))
+        bridge.start()
+        self.addCleanup(bridge.close)
+
+        connection = ParaViewConnection(host="127.0.0.1", port=bridge.port)
+        connection.connect()
+        self.addCleanup(connection.disconnect)
+        with self.assertRaises(ParaViewCommandError) as ctx:
+            connection.send_command("ping")
+        self.assertEqual(ctx.exception.code, "PROTOCOL_ERROR")
+
+    def test_answers_plugin_heartbeats(self) -> None:
+        listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        try:
+            listener.bind(("127.0.0.1", 0))
+            listener.listen()
+        except PermissionError as exc:
+            listener.close()
+            self.skipTest(str(exc))
+        self.addCleanup(listener.close)
+        acks: list[dict[str, Any]] = []
+
+        def serve() -> None:
+            conn, _ = listener.accept()
+            with conn:
+                conn.settimeout(5.0)
+                hello = recv_message(conn)
+                self.assertIn("heartbeat", hello["capabilities"])
+                result = {"protocol_version": 2, "plugin_version": "0.1.0", "python_ready": True}
+                result["capabilities"] = ["heartbeat"]
+                reply = {"request_id": hello["request_id"], "status": "success", "result": result}
+                conn.sendall(encode_message(reply))
+                # Unsolicited: it carries no request_id and must not reach a caller.
+                conn.sendall(encode_message({"type": "heartbeat", "heartbeat_id": 7}))
+                acks.append(recv_message(conn))
+                ping = recv_message(conn)
+                reply = {"request_id": ping["request_id"], "status": "success", "result": {}}
+                conn.sendall(encode_message(reply))
+
+        thread = threading.Thread(target=serve, daemon=True)
+        thread.start()
+
+        connection = ParaViewConnection(host="127.0.0.1", port=listener.getsockname()[1])
+        connection.connect()
+        self.addCleanup(connection.disconnect)
+        deadline = time.monotonic() + 5
+        while not acks and time.monotonic() < deadline:
+            time.sleep(0.01)
+        self.assertEqual(acks, [{"type": "heartbeat_ack", "heartbeat_id": 7}])
+        self.assertEqual(connection.send_command("ping"), {})
+        thread.join(timeout=5)
+
+    def test_heartbeat_acks_wait_for_a_busy_writer(self) -> None:
+        listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        try:
+            listener.bind(("127.0.0.1", 0))
+            listener.listen()
+        except PermissionError as exc:
+            listener.close()
+            self.skipTest(str(exc))
+        self.addCleanup(listener.close)
+        received: list[dict[str, Any]] = []
+        writing = threading.Event()
+
+        def serve() -> None:
+            conn, _ = listener.accept()
+            with conn:
+                conn.settimeout(5.0)
+                hello = recv_message(conn)
+                result = {"protocol_version": 2, "plugin_version": "0.1.0", "python_ready": True}
+                result["capabilities"] = ["heartbeat"]
+                reply = {"request_id": hello["request_id"], "status": "success", "result": result}
+                conn.sendall(encode_message(reply))
+                writing.wait(5)
+                conn.sendall(encode_message({"type": "heartbeat", "heartbeat_id": 3}))
+                ping = recv_message(conn)
+                received.append(ping)
+                reply = {"request_id": ping["request_id"], "status": "success", "result": {}}
+                conn.sendall(encode_message(reply))
+                received.append(recv_message(conn))
+
+        thread = threading.Thread(target=serve, daemon=True)
+        thread.start()
+
+        connection = ParaViewConnection(host="127.0.0.1", port=listener.getsockname()[1])
+        connection.connect()
+        self.addCleanup(connection.disconnect)
+        # Stand in for a command that is still being written when the beat comes in.
+        with connection._lock:
+            writing.set()
+            deadline = time.monotonic() + 5
+            while not connection._acks and time.monotonic() < deadline:
+                time.sleep(0.01)
+            self.assertEqual(received, [])
+        self.assertEqual(connection.send_command("ping"), {})
+        thread.join(timeout=5)
+        # The queued ack goes out right behind the command that held the socket.
+        self.assertEqual(received[0]["type"], "ping")
+        self.assertEqual(received[1], {"type": "heartbeat_ack", "heartbeat_id": 3})
+
+    def test_cancels_commands_that_time_out(self) -> None:
+        listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        try:
+            listener.bind(("127.0.0.1", 0))
+            listener.listen()
+        except PermissionError as exc:
+            listener.close()
+            self.skipTest(str(exc))
+        self.addCleanup(listener.close)
+        received: list[dict[str, Any]] = []
+
+        def serve() -> None:
+            conn, _ = listener.accept()
+            with conn:
+                conn.settimeout(5.0)
+                hello = recv_message(conn)
+                result = {"protocol_version": 2, "plugin_version": "0.1.0", "python_ready": True}
+                result["capabilities"] = ["ping", "cancel", "execute_python"]
+                reply = {"request_id": hello["request_id"], "status": "success", "result": result}
+                conn.sendall(encode_message(reply))
+                # The script never finishes on its own.
+                received.append(recv_message(conn))
+                cancel = recv_message(conn)
+                received.append(cancel)
+                target = cancel["params"]["request_id"]
+                error = {"code": "CANCELLED", "message": "execute_python was cancelled"}
+                reply = {"request_id": target, "status": "error", "error": error}
+                conn.sendall(encode_message(reply))
+                result = {"request_id": target, "cancelled": True}
+                reply = {"request_id": cancel["request_id"], "status": "success", "result": result}
+                conn.sendall(encode_message(reply))
+
+        thread = threading.Thread(target=serve, daemon=True)
+        thread.start()
+
+        connection = ParaViewConnection(
+            host="127.0.0.1", port=listener.getsockname()[1], timeout_seconds=0.2
+        )
+        connection.connect()
+        self.addCleanup(connection.disconnect)
+        with self.assertRaises(TimeoutError):
+            connection.send_command("execute_python", {"code": "while True: pass"})
+        thread.join(timeout=5)
+        self.assertEqual([request["type"] for request in received], ["execute_python", "cancel"])
+        self.assertEqual(received[1]["params"], {"request_id": received[0]["request_id"]})
+
+    def test_pipelined_commands_complete_out_of_order(self) -> None:
+        slow_seconds = 0.5
+
+        def delay_for(request: dict[str, Any]) -> float:
+            return slow_seconds if request["type"] == "execute_python" else 0.0
+
+        try:
+            bridge = ConcurrentBridgeStub(delay_for)
+        except PermissionError as exc:
+            self.skipTest(str(exc))
+        bridge.start()
+        self.addCleanup(bridge.close)
+
+        connection = ParaViewConnection(host="127.0.0.1", port=bridge.port)
+        connection.connect()
+        self.addCleanup(connection.disconnect)
+
+        finished: list[str] = []
+        results: dict[str, dict[str, Any]] = {}
+
+        def call(name: str, command_type: str) -> None:
+            results[name] = connection.send_command(command_type, {"name": name})
+            finished.append(name)
+
+        started = time.perf_counter()
+        threads = [threading.Thread(target=call, args=("slow", "execute_python"))]
+        threads[0].start()
+        time.sleep(0.05)
+        for index in range(50):
+            threads.append(threading.Thread(target=call, args=(f"ping-{index}", "ping")))
+            threads[-1].start()
+        for thread in threads:
+            thread.join(timeout=5)
+        elapsed = time.perf_counter() - started
+
+        # All cheap calls overtake the slow one instead of queueing behind it,
+        # and the whole batch costs about one slow round trip.
+        self.assertEqual(finished[-1], "slow")
+        self.assertEqual(len(finished), 51)
+        self.assertLess(elapsed, 2 * slow_seconds)
+        for name, result in results.items():
+            self.assertEqual(result, {"echo": {"name": name}})
 
 
 if __name__ == "__main__":
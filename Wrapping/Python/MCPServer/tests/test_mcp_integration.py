@@ -96,6 +96,9 @@ class _MockConnection:
             }
         return {}
 
+    def inspect_pipeline(self):
+        return self.send_command("inspect_pipeline")
+
 
 def _get_tool_globals(mcp_server):
     """Return the ``__globals__`` dict of the first registered tool function.
@@ -148,14 +151,16 @@ class MCPIntegrationTests(unittest.IsolatedAsyncioTestCase):
             sys.modules.pop(k, None)
         sys.modules.update(self._stub_snapshot)
 
-    async def test_list_tools_returns_three_tools(self):
-        """Client lists tools and finds exactly three with the expected names."""
+    async def test_list_tools_returns_four_tools(self):
+        """Client lists tools and finds exactly four with the expected names."""
         async with _Client(self.server) as client:
             tools = await client.list_tools()
 
-        self.assertEqual(len(tools), 3)
+        self.assertEqual(len(tools), 4)
         names = {t.name for t in tools}
-        self.assertEqual(names, {"execute_paraview_code", "get_pipeline_info", "get_screenshot"})
+        self.assertEqual(
+            names, {"execute_paraview_code", "get_pipeline_info", "get_screenshot", "run_batch"}
+        )
 
     async def test_initialize_reports_package_version(self):
         async with _Client(self.server) as client:
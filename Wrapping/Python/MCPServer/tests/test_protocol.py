@@ -2,23 +2,56 @@
 
 from __future__ import annotations
 
+import json
 import socket
+import struct
 import sys
+import tempfile
 import threading
 import unittest
+import zlib
 from pathlib import Path
 
 sys.path.insert(0, str(Path(__file__).resolve().parents[1] / "src"))
 
 from paraview_mcp.protocol import (
+    FRAME_FLAG_BINARY,
+    FRAME_FLAG_CBOR,
+    FRAME_FLAG_COMPRESSED,
+    FRAME_FLAG_CONTINUED,
     MAX_FRAME_BYTES,
+    SHARED_HEADER_BYTES,
+    CompressionStats,
     FrameBuffer,
     FrameTooLargeError,
+    ProtocolError,
+    SharedRegion,
+    cbor_available,
+    compress_payload,
+    decompress_payload,
+    encode_frame,
     encode_message,
     recv_message,
 )
 
 
+def _screenshot_response(image: bytes) -> bytes:
+    envelope = {
+        "request_id": "shot",
+        "status": "success",
+        "result": {"format": "png"},
+        "attachments": [{"key": "image_data", "size": len(image)}],
+    }
+    return encode_message(envelope) + encode_frame(image, flags=FRAME_FLAG_BINARY)
+
+
+def _chunked(payload: bytes, chunk_bytes: int, *, flags: int = 0) -> bytes:
+    chunks = [payload[i : i + chunk_bytes] for i in range(0, len(payload), chunk_bytes)]
+    frames = [encode_frame(chunk, flags=flags | FRAME_FLAG_CONTINUED) for chunk in chunks[:-1]]
+    frames.append(encode_frame(chunks[-1], flags=flags))
+    return b"".join(frames)
+
+
 class ProtocolTests(unittest.TestCase):
     def test_round_trip_small_frame(self) -> None:
         payload = {"request_id": "1", "type": "ping"}
@@ -60,6 +93,225 @@ class ProtocolTests(unittest.TestCase):
             left.close()
             right.close()
 
+    def test_frame_buffer_binds_binary_attachments(self) -> None:
+        encoded = _screenshot_response(b"\x89PNG-bytes")
+        buffer = FrameBuffer()
+        self.assertEqual(buffer.feed(encoded[:-3]), [])
+        messages = buffer.feed(encoded[-3:])
+        self.assertEqual(len(messages), 1)
+        self.assertNotIn("attachments", messages[0])
+        self.assertEqual(messages[0]["result"], {"format": "png", "image_data": b"\x89PNG-bytes"})
+
+    def test_frame_buffer_rejects_json_frame_in_place_of_attachment(self) -> None:
+        envelope = {
+            "request_id": "shot",
+            "status": "success",
+            "result": {},
+            "attachments": [{"key": "image_data", "size": 2}],
+        }
+        buffer = FrameBuffer()
+        with self.assertRaises(ProtocolError):
+            buffer.feed(encode_message(envelope) + encode_message({"ok": True}))
+
+    def test_recv_message_reads_attachment_frames(self) -> None:
+        left, right = socket.socketpair()
+        try:
+            thread = threading.Thread(target=left.sendall, args=(_screenshot_response(b"image"),))
+            thread.start()
+            decoded = recv_message(right)
+            thread.join(timeout=2)
+            self.assertEqual(decoded["result"]["image_data"], b"image")
+        finally:
+            left.close()
+            right.close()
+
+    def test_frame_buffer_reassembles_chunked_messages(self) -> None:
+        payload = {"request_id": "big", "status": "success", "result": {"stdout": "x" * 200}}
+        encoded = _chunked(encode_message(payload)[4:], 64)
+        buffer = FrameBuffer(max_frame_bytes=64)
+        messages = []
+        for offset in range(0, len(encoded), 7):
+            messages.extend(buffer.feed(encoded[offset : offset + 7]))
+        self.assertEqual(messages, [payload])
+
+    def test_frame_buffer_limits_reassembled_size(self) -> None:
+        buffer = FrameBuffer(max_frame_bytes=64, max_message_bytes=100)
+        with self.assertRaises(FrameTooLargeError):
+            buffer.feed(_chunked(b"x" * 200, 64))
+
+    def test_recv_message_reassembles_chunked_attachment(self) -> None:
+        image = bytes(range(256)) * 3
+        envelope = {
+            "request_id": "shot",
+            "status": "success",
+            "result": {"format": "png"},
+            "attachments": [{"key": "image_data", "size": len(image)}],
+        }
+        wire = encode_message(envelope) + _chunked(image, 100, flags=FRAME_FLAG_BINARY)
+        left, right = socket.socketpair()
+        try:
+            thread = threading.Thread(target=left.sendall, args=(wire,))
+            thread.start()
+            decoded = recv_message(right, max_frame_bytes=128)
+            thread.join(timeout=2)
+            self.assertEqual(bytes(decoded["result"]["image_data"]), image)
+        finally:
+            left.close()
+            right.close()
+
+    def test_recv_message_rejects_changed_chunk_flags(self) -> None:
+        wire = encode_frame(b'{"a":', flags=FRAME_FLAG_CONTINUED) + encode_frame(
+            b"1}", flags=FRAME_FLAG_BINARY
+        )
+        left, right = socket.socketpair()
+        try:
+            left.sendall(wire)
+            with self.assertRaises(ProtocolError):
+                recv_message(right)
+        finally:
+            left.close()
+            right.close()
+
+    def test_compressed_frames_round_trip_and_count_savings(self) -> None:
+        payload = {"request_id": "big", "status": "success", "result": {"stdout": "a" * 4096}}
+        sent = CompressionStats()
+        encoded = encode_message(payload, compression_threshold=64, stats=sent)
+        self.assertTrue(struct.unpack(">I", encoded[:4])[0] & FRAME_FLAG_COMPRESSED)
+        self.assertEqual(sent.frames, 1)
+        self.assertGreater(sent.bytes_saved, 0)
+
+        small = {"request_id": "1", "type": "ping"}
+        self.assertEqual(encode_message(small, compression_threshold=64), encode_message(small))
+
+        received = CompressionStats()
+        buffer = FrameBuffer(compression=True, stats=received)
+        self.assertEqual(buffer.feed(encoded + encode_message(small)), [payload, small])
+        self.assertEqual(received.bytes_before, sent.bytes_before)
+        self.assertEqual(received.bytes_saved, sent.bytes_saved)
+
+    def test_compressed_payload_matches_qcompress_layout(self) -> None:
+        raw = b'{"stdout":"' + b"b" * 2048 + b'"}'
+        flags, compressed = compress_payload(raw, threshold=0)
+        self.assertEqual(flags, FRAME_FLAG_COMPRESSED)
+        self.assertEqual(struct.unpack(">I", compressed[:4])[0], len(raw))
+        self.assertEqual(zlib.decompress(compressed[4:]), raw)
+        self.assertEqual(decompress_payload(struct.pack(">I", len(raw)) + zlib.compress(raw)), raw)
+
+    def test_rejects_compressed_frames_without_negotiation(self) -> None:
+        encoded = encode_message({"stdout": "c" * 4096}, compression_threshold=0)
+        with self.assertRaises(ProtocolError):
+            FrameBuffer().feed(encoded)
+
+    def test_rejects_corrupt_or_oversized_compressed_payloads(self) -> None:
+        with self.assertRaises(ProtocolError):
+            decompress_payload(struct.pack(">I", 4096) + b"garbage")
+        bomb = struct.pack(">I", 1 << 20) + zlib.compress(b"\0" * (1 << 20))
+        with self.assertRaises(FrameTooLargeError):
+            decompress_payload(bomb, max_inflated_bytes=1024)
+
+    def test_compressed_frame_may_not_inflate_past_the_frame_limit(self) -> None:
+        encoded = encode_message({"stdout": "e" * 8192}, compression_threshold=0)
+        self.assertLess(len(encoded), 256)
+        with self.assertRaises(FrameTooLargeError):
+            FrameBuffer(max_frame_bytes=256, compression=True).feed(encoded)
+        buffer = FrameBuffer(max_frame_bytes=256, compression=True, chunked=True)
+        self.assertEqual(buffer.feed(encoded), [{"stdout": "e" * 8192}])
+
+    def test_recv_message_inflates_chunked_compressed_envelope(self) -> None:
+        payload = {"request_id": "big", "status": "success", "result": {"stdout": "d" * 8192}}
+        encoded = encode_message(payload, compression_threshold=0)
+        wire = _chunked(encoded[4:], 16, flags=FRAME_FLAG_COMPRESSED)
+        left, right = socket.socketpair()
+        try:
+            left.sendall(wire)
+            self.assertEqual(
+                recv_message(right, max_frame_bytes=16, compression=True, chunked=True), payload
+            )
+        finally:
+            left.close()
+            right.close()
+
+    def test_rejects_cbor_frames_without_negotiation(self) -> None:
+        frame = encode_frame(b"\xa1dtypedping", flags=FRAME_FLAG_CBOR)
+        with self.assertRaises(ProtocolError):
+            FrameBuffer().feed(frame)
+
+    @unittest.skipUnless(cbor_available(), "cbor2 is not installed")
+    def test_cbor_frames_round_trip(self) -> None:
+        payload = {"request_id": "1", "status": "success", "result": {"count": 2, "ok": True}}
+        encoded = encode_message(payload, cbor=True)
+        self.assertEqual(struct.unpack(">I", encoded[:4])[0] & ~0x0FFFFFFF, FRAME_FLAG_CBOR)
+
+        buffer = FrameBuffer(cbor=True)
+        self.assertEqual(buffer.feed(encoded + encode_message(payload)), [payload, payload])
+
+    @unittest.skipUnless(cbor_available(), "cbor2 is not installed")
+    def test_decodes_compressed_cbor_written_by_the_plugin(self) -> None:
+        # {"type": "ping"} as QCborMap::toCbor() writes it.
+        frame = encode_frame(b"\xa1dtypedping", flags=FRAME_FLAG_CBOR)
+        self.assertEqual(FrameBuffer(cbor=True).feed(frame), [{"type": "ping"}])
+
+        payload = {"request_id": "big", "status": "success", "result": {"stdout": "e" * 4096}}
+        encoded = encode_message(payload, cbor=True, compression_threshold=0)
+        flags = struct.unpack(">I", encoded[:4])[0] & ~0x0FFFFFFF
+        self.assertEqual(flags, FRAME_FLAG_CBOR | FRAME_FLAG_COMPRESSED)
+        left, right = socket.socketpair()
+        try:
+            left.sendall(encoded)
+            self.assertEqual(recv_message(right, compression=True, cbor=True), payload)
+        finally:
+            left.close()
+            right.close()
+
+
+    def test_recv_message_reads_shared_memory_bodies(self) -> None:
+        capacity = 1024
+        image = b"\x89PNG" * 100
+        envelope = json.dumps(
+            {
+                "request_id": "shot",
+                "status": "success",
+                "result": {"format": "png"},
+                "attachments": [{"key": "image_data", "size": len(image), "position": 1024}],
+            }
+        ).encode("utf-8")
+        pointer = {
+            "request_id": "shot",
+            "shared_payload": {"position": 1024 + len(image), "length": len(envelope), "flags": 0},
+        }
+        # Laid out as the plugin would on its second lap of the ring: the
+        # attachment first, then the envelope that describes it.
+        contents = bytearray(SHARED_HEADER_BYTES + capacity)
+        contents[SHARED_HEADER_BYTES : SHARED_HEADER_BYTES + len(image)] = image
+        start = SHARED_HEADER_BYTES + len(image)
+        contents[start : start + len(envelope)] = envelope
+        with tempfile.NamedTemporaryFile() as backing:
+            backing.write(contents)
+            backing.flush()
+            region = SharedRegion(backing.name, len(contents))
+            self.addCleanup(region.close)
+            # Positions below the last release are from an earlier lap.
+            region._released = 1024
+
+            left, right = socket.socketpair()
+            try:
+                left.sendall(encode_message(pointer) + encode_message(pointer))
+                decoded = recv_message(right, shared=region)
+                with self.assertRaises(ProtocolError):
+                    recv_message(right)
+            finally:
+                left.close()
+                right.close()
+
+            self.assertEqual(decoded["result"], {"format": "png", "image_data": image})
+            self.assertNotIn("attachments", decoded)
+            backing.seek(0)
+            released = struct.unpack("<Q", backing.read(8))[0]
+            self.assertEqual(released, 1024 + len(image) + len(envelope))
+            with self.assertRaises(ProtocolError):
+                with region.body(0, 16):
+                    pass
+
 
 if __name__ == "__main__":
     unittest.main()